@@ -28,6 +28,22 @@
 #define ERROR_DRAW_TEXTURE (0xC)
 #define ERROR_DESTROYED_TEXTURE (0xD)
 #define ERROR_SET_RENDER_SCALE (0xE)
+#define ERROR_TRACE (0xF)
+#define ERROR_SET_BLEND_MODE (0x10)
+#define ERROR_RENDER_QUEUE (0x11)
+#define ERROR_DRAW_GEOMETRY (0x12)
+#define ERROR_MOUNT_PACK (0x13)
+#define ERROR_TEXTURE_CACHE (0x14)
+#define ERROR_COMMAND_LIST (0x15)
+#define ERROR_RENDER_THREAD (0x16)
+#define ERROR_PROFILER (0x17)
+#define ERROR_WAKE_EVENT_LOOP (0x18)
+#define ERROR_DRAW_FIELD (0x19)
+#define ERROR_INPUT_RECORDING (0x1A)
+#define ERROR_IMAGE_COMPARE (0x1B)
+#define ERROR_IMAGE_MISMATCH (0x1C)
+#define ERROR_BLIT (0x1D)
+#define ERROR_INTERNAL_RESOLUTION (0x1E)
 
 
 
@@ -42,6 +58,45 @@ typedef enum {FALSE, TRUE} bool;
 typedef enum {RELEASED, PRESSED} keyState;
 typedef enum keyState BtnState;
 
+// Blend modes for drawing primitives
+typedef enum {BLEND_NONE, BLEND_ALPHA, BLEND_ADD, BLEND_MOD} BlendMode;
+
+// Joint styles between the segments of thick polylines
+typedef enum {JOIN_MITER, JOIN_BEVEL, JOIN_ROUND} LineJoin;
+
+// Filters upscaling the internal resolution to the window, INTEGER is nearest at the largest whole factor
+typedef enum {UPSCALE_NEAREST, UPSCALE_LINEAR, UPSCALE_INTEGER} UpscaleFilter;
+
+// Texture flip flags, can be combined
+typedef enum {FLIP_NONE = 0x0, FLIP_HORIZONTAL = 0x1, FLIP_VERTICAL = 0x2} FlipMode;
+
+// Pixel formats of caller provided pixel memory, RGBA32 is the internal texture format
+// A8 is alpha only, it converts to white with that alpha
+typedef enum {
+    PIXEL_FORMAT_RGBA32,
+    PIXEL_FORMAT_BGRA32,
+    PIXEL_FORMAT_ARGB8888,
+    PIXEL_FORMAT_RGB24,
+    PIXEL_FORMAT_RGB565,
+    PIXEL_FORMAT_A8
+} PixelFormat;
+
+// Texture creation flags
+#define TEXTURE_BORROWED (0x1)
+
+/*
+    Storage formats of texture pixel memory
+    STORAGE_A8 keeps only the alpha channel, the color comes from the texture tint.
+    STORAGE_INDEX8 keeps one byte palette indices into the palette set with S2D_setTexturePalette.
+*/
+typedef enum {
+    STORAGE_RGBA32,
+    STORAGE_RGB565,
+    STORAGE_ARGB4444,
+    STORAGE_A8,
+    STORAGE_INDEX8
+} TextureStorage;
+
 // Mouse event types
 typedef enum  {BUTTON, MOVEMENT, WHEEL} MouseEventType;
 
@@ -193,7 +248,8 @@ typedef struct {
 
 /*
     Texture structure
-    formatcode: the format of the texture
+    formatcode: the SDL pixel format of the pixel memory, SDL_PIXELFORMAT_UNKNOWN for STORAGE_A8
+    storage: the storage format of the pixel memory
     width: the width of the texture
     height: the height of the texture
     bytes_per_pixel: the number of bytes per pixel
@@ -203,6 +259,7 @@ typedef struct {
 */
 typedef struct {
     Uint32 formatcode;
+    TextureStorage storage;
     int width;
     int height;
     Uint8 bytes_per_pixel;
@@ -234,11 +291,13 @@ typedef struct {
     draw_w: the width of the drawing area
     draw_h: the height of the drawing area
     draw_color: the current draw color
+    blend_mode: the current blend mode for drawing primitives
 */
 typedef struct {
     int draw_w;
     int draw_h;
     Uint32 draw_color;
+    BlendMode blend_mode;
 } Drawstate;
 
 /*
@@ -331,7 +390,7 @@ typedef struct {
 int S2D_initialize();
 
 /*
-    Create a window with the specified title, width and height
+    Create a window with the specified title, width and height for the current context
     Returns 0 on success, error code ERROR_CREATE_WINDOW on failure
 */
 int S2D_createWindow(const char *title, int w, int h);
@@ -346,6 +405,12 @@ void S2D_delay(int ms);
 */
 int S2D_setDrawColor(Uint32 rgba);
 
+/*
+    Set the blend mode used when drawing points, lines and rectangles
+    Any subsequent drawing function calls will use this blend mode, textures keep their own blending
+    Returns 0 on success, error code ERROR_SET_BLEND_MODE on failure
+*/
+int S2D_setBlendMode(BlendMode mode);
 
 /*
     Set the render scale to the specified scale
@@ -355,6 +420,38 @@ int S2D_setDrawColor(Uint32 rgba);
 */
 int S2D_setRenderScale(float x_scale, float y_scale);
 
+/*
+    Draw at a fixed internal resolution, independent of the window size
+    Drawing goes to an offscreen target of that size, which S2D_presentRender upscales into the window,
+    centered at the largest size keeping the aspect ratio with black borders. Fill rate bound scenes get
+    cheaper with a reduced size, unlike S2D_setRenderScale which still rasterizes at the window size.
+    The draw state size, the camera view and the positions of mouse events are those of the internal resolution.
+    Setting it again replaces the target and turns dynamic resolution off.
+    w: the internal width, 0 together with h to draw into the window again
+    h: the internal height
+    filter: how the target is upscaled, UPSCALE_INTEGER falls back to nearest when the window is smaller
+    Returns 0 on success, error code ERROR_INTERNAL_RESOLUTION on failure, in which case drawing goes to the window
+*/
+int S2D_setInternalResolution(int w, int h, UpscaleFilter filter);
+
+/*
+    Lower the internal resolution automatically while frames take longer than a budget
+    The time between presents is smoothed over a few frames, when it exceeds the budget the drawn part of the
+    internal target shrinks to the size expected to fit, and it grows back once frames are fast again.
+    Draw coordinates stay those of S2D_setInternalResolution, only the pixels drawn change. Best used with
+    UPSCALE_LINEAR, without vsync or with a budget above the refresh interval.
+    budget_ns: the frame time budget in nanoseconds, 0 to turn dynamic resolution off and draw at the full internal size
+    min_scale: the smallest fraction of the internal width and height drawn, 0 for the default of 0.5
+    Returns 0 on success, error code ERROR_INTERNAL_RESOLUTION when no internal resolution is set
+*/
+int S2D_setDynamicResolution(Uint64 budget_ns, float min_scale);
+
+/*
+    Get the size in pixels drawn for a frame, the internal resolution as lowered by dynamic resolution,
+    or the draw size without an internal resolution
+*/
+void S2D_getInternalResolution(int *w, int *h);
+
 /*
     Get the current draw state
     Returns the current draw state
@@ -452,7 +549,153 @@ int S2D_drawFillRectangle(const Rectangle *rect);
 */
 int S2D_drawFillRectangleF(const fRectangle *rect);
 
+/*
+    Fill a set of rectangles with a single SDL call
+    rects: the rectangles to fill
+    count: the number of rectangles
+    colors: rgba color per rectangle, or NULL to fill all with the current draw color
+    Returns 0 on success, error code ERROR_RECT_FILL on failure
+*/
+int S2D_fillRectangles(const Rectangle *rects, int count, const Uint32 *colors);
+
+/*
+    Fill a set of rectangles using float coordinates, see S2D_fillRectangles
+    Returns 0 on success, error code ERROR_RECT_FILL on failure
+*/
+int S2D_fillRectanglesF(const fRectangle *rects, int count, const Uint32 *colors);
+
+/*
+    Draw a set of rectangle outlines
+    rects: the rectangles to draw
+    count: the number of rectangles
+    colors: rgba color per rectangle, or NULL to draw all with the current draw color
+    Consecutive rectangles of equal color are drawn with a single SDL call
+    Returns 0 on success, error code ERROR_DRAW_RECT on failure
+*/
+int S2D_drawRectangles(const Rectangle *rects, int count, const Uint32 *colors);
+
+/*
+    Draw a set of rectangle outlines using float coordinates, see S2D_drawRectangles
+    Returns 0 on success, error code ERROR_DRAW_RECT on failure
+*/
+int S2D_drawRectanglesF(const fRectangle *rects, int count, const Uint32 *colors);
+
+/*
+    Draw connected lines through a set of points
+    points: the points, count-1 line segments are drawn
+    count: the number of points
+    colors: rgba color per segment (count-1 entries), or NULL to draw all with the current draw color
+    Consecutive segments of equal color are drawn with a single SDL call
+    Returns 0 on success, error code ERROR_DRAW_LINE on failure
+*/
+int S2D_drawLines(const Vector *points, int count, const Uint32 *colors);
+
+/*
+    Draw connected lines using float coordinates, see S2D_drawLines
+    Returns 0 on success, error code ERROR_DRAW_LINE on failure
+*/
+int S2D_drawLinesF(const fVector *points, int count, const Uint32 *colors);
+
+
+/*
+    Fill a circle with the current draw color
+    Shapes are tessellated into triangles on the CPU and drawn with a single SDL call
+    center: the center of the circle
+    radius: the radius of the circle
+    Returns 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_fillCircle(fVector center, float radius);
+
+/*
+    Draw a circle outline with the current draw color
+    thickness: the outline width in pixels, centered on the radius
+    Returns 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_drawCircle(fVector center, float radius, float thickness);
+
+/*
+    Fill an axis aligned ellipse with the current draw color
+    rx: the horizontal radius
+    ry: the vertical radius
+    Returns 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_fillEllipse(fVector center, float rx, float ry);
+
+/*
+    Draw an axis aligned ellipse outline with the current draw color
+    Returns 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_drawEllipse(fVector center, float rx, float ry, float thickness);
+
+/*
+    Fill a simple polygon with the current draw color, convex and concave polygons are supported
+    points: the polygon corners in order, either winding direction
+    count: the number of corners
+    Returns 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_fillPolygon(const fVector *points, int count);
+
+/*
+    Draw a thick line through a set of points with the current draw color
+    points: the line points
+    count: the number of points
+    thickness: the line width in pixels
+    join: how consecutive segments are joined
+    closed: if TRUE the last point is connected back to the first
+    Returns 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_drawPolyline(const fVector *points, int count, float thickness, LineJoin join, bool closed);
+
+/*
+    Mesh of tessellated shapes
+    Shapes added to a mesh are tessellated once and kept, drawing the mesh submits all of them
+    with a single SDL call, so static scenes should be built into meshes instead of drawn shape by shape.
+    Every shape has its own color, so a mesh is independent of the current draw color.
+*/
+typedef struct S2D_Mesh S2D_Mesh;
+
+/*
+    Create an empty mesh
+    Returns the mesh on success, NULL on failure
+*/
+S2D_Mesh* S2D_createMesh();
+
+/*
+    Destroy a mesh
+*/
+void S2D_destroyMesh(S2D_Mesh *mesh);
+
+/*
+    Remove all shapes from a mesh, the memory is kept for reuse
+*/
+void S2D_clearMesh(S2D_Mesh *mesh);
 
+/*
+    Add shapes to a mesh, parameters are the same as for the immediate functions with an explicit rgba color
+    Return 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_meshFillCircle(S2D_Mesh *mesh, fVector center, float radius, Uint32 rgba);
+int S2D_meshDrawCircle(S2D_Mesh *mesh, fVector center, float radius, float thickness, Uint32 rgba);
+int S2D_meshFillEllipse(S2D_Mesh *mesh, fVector center, float rx, float ry, Uint32 rgba);
+int S2D_meshDrawEllipse(S2D_Mesh *mesh, fVector center, float rx, float ry, float thickness, Uint32 rgba);
+int S2D_meshFillPolygon(S2D_Mesh *mesh, const fVector *points, int count, Uint32 rgba);
+int S2D_meshDrawPolyline(S2D_Mesh *mesh, const fVector *points, int count, float thickness, LineJoin join, bool closed, Uint32 rgba);
+
+/*
+    Add raw triangles with per vertex colors to a mesh
+    points: the triangle corners, three per triangle
+    colors: rgba color for each corner, interpolated across the triangle
+    count: the number of corners, a multiple of 3
+    Returns 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_meshAddTriangles(S2D_Mesh *mesh, const fVector *points, const Uint32 *colors, int count);
+
+/*
+    Draw all shapes of a mesh with a single SDL call, using the current blend mode
+    offset: translation applied to the mesh, {0,0} draws it where it was built
+    Returns 0 on success, error code ERROR_DRAW_GEOMETRY on failure
+*/
+int S2D_drawMesh(const S2D_Mesh *mesh, fVector offset);
 
 
 /*
@@ -465,14 +708,131 @@ int S2D_drawFillRectangleF(const fRectangle *rect);
 void *safeAccessTexturePixel(Texture *txt, unsigned int x_pixel, unsigned int y_pixel);
 
 
+/*
+    Mount an asset pack built with tools/s2dpack, replacing the pack mounted before
+    The pack is memory mapped, S2D_createTexture and S2D_createUTF8Texture look up image and font paths
+    in the pack first and fall back to the file system for paths it does not contain.
+    path: the file path of the pack
+    Returns 0 on success, error code ERROR_MOUNT_PACK on failure, in which case no pack is mounted
+*/
+int S2D_mountPack(const char *path);
+
+/*
+    Unmount the mounted asset pack, textures created from it stay valid
+*/
+void S2D_unmountPack();
+
+/*
+    Enable the on disk cache of decoded textures used by S2D_createTexture, disabled by default
+    The first load of an image file stores its decoded pixels in the cache directory, later loads map
+    the cache file and upload from it without decoding. Entries are keyed by the image path, size and
+    modification time, so changed images are decoded again. Images from the asset pack are not cached.
+    dir: the cache directory, created if missing, NULL disables the cache
+    Returns 0 on success, error code ERROR_TEXTURE_CACHE on failure
+*/
+int S2D_setTextureCache(const char *dir);
+
 /*
     Create a texture from a file
-    file: the file path of the image
+    file: the file path of the image, resolved against the mounted asset pack first
     text: the texture to create
     Returns 0 on success, error code ERROR_CREATE_TEXTURE on failure
 */
 int S2D_createTexture(const char *file, Texture *text);
 
+/*
+    Create a texture from an image file of any size, including images beyond the maximum texture size
+    of the renderer which S2D_createTexture fails on.
+    The decoded pixels stay in memory, with the texture cache enabled as a mapping of the cache file, and are
+    uploaded in tiles as they become visible. S2D_drawTexture draws the visible tiles with the usual rectangle
+    semantics, zoomed out draws use tiles downsampled by powers of two. Tiles not drawn recently are released
+    once the budget set with S2D_setTiledTextureBudget is exceeded.
+    The pixels can be accessed and changed like those of an RGBA32 texture, S2D_updateTexture uploads the
+    resident tiles again. Tiled textures can not be drawn with S2D_drawTextureInstances, render queues,
+    command lists or used as a tilemap atlas.
+    file: the file path of the image, resolved against the mounted asset pack first
+    tile_size: the width and height of a tile in pixels, 0 for the default of 512
+    txt: the texture to create
+    Returns 0 on success, error code ERROR_CREATE_TEXTURE on failure
+*/
+int S2D_createTiledTexture(const char *file, int tile_size, Texture *txt);
+
+/*
+    Set the maximum number of tiles of a tiled texture kept uploaded at once, least recently drawn tiles are released first
+    Tiles visible in the current frame are kept even beyond the budget.
+    max_resident: the tile budget, 0 for a default derived from the window size
+*/
+void S2D_setTiledTextureBudget(Texture *txt, int max_resident);
+
+/*
+    Get the number of tiles of a tiled texture currently uploaded, 0 for other textures
+*/
+int S2D_getTiledTextureResidentTiles(const Texture *txt);
+
+
+/*
+    Create a texture from pixel memory owned by the caller, without going through an image file
+    Pixels in the RGBA32 format are wrapped and uploaded without copying and stay the texture pixel memory,
+    so they can be modified in place and reuploaded with S2D_updateTexture.
+    Other formats are converted into a library owned copy.
+    pixels: the pixel memory, allocated with malloc unless TEXTURE_BORROWED is set
+    w: the width in pixels
+    h: the height in pixels
+    pitch: the number of bytes per pixel row
+    format: the pixel format of the memory
+    flags: TEXTURE_BORROWED if the caller keeps ownership of the memory and frees it after S2D_destroyTexture,
+    otherwise the library takes ownership and frees it
+    txt: the texture to create
+    Returns 0 on success, error code ERROR_CREATE_TEXTURE on failure, in which case the caller keeps ownership
+*/
+int S2D_createTextureFromPixels(void *pixels, int w, int h, int pitch, PixelFormat format, int flags, Texture *txt);
+
+/*
+    Blit pixel memory into pixel memory of the same or another format, on the CPU
+    Every combination of formats, blend mode and scaling has its own specialized loop, large blits are spread
+    over worker threads. The source is scaled with nearest neighbour sampling when the sizes differ.
+    Source and destination must not overlap.
+    src: the source pixels
+    src_w, src_h: the source size in pixels
+    src_pitch: the number of bytes per source pixel row
+    src_format: the source pixel format
+    dst: the destination pixels
+    dst_w, dst_h: the destination size in pixels
+    dst_pitch: the number of bytes per destination pixel row
+    dst_format: the destination pixel format
+    mode: BLEND_NONE to convert, BLEND_ALPHA, BLEND_ADD or BLEND_MOD to blend onto the destination like the renderer
+    Returns 0 on success, error code ERROR_BLIT on failure
+*/
+int S2D_blitPixels(const void *src, int src_w, int src_h, int src_pitch, PixelFormat src_format,
+                   void *dst, int dst_w, int dst_h, int dst_pitch, PixelFormat dst_format, BlendMode mode);
+
+/*
+    Set the storage format of textures created after this call, STORAGE_RGBA32 by default
+    Compact formats cut the pixel memory to 2 or 1 bytes per pixel. RGB565 and ARGB4444 textures
+    are uploaded as they are, renderers without native support convert them on the GPU side.
+    A8 and INDEX8 textures are expanded to RGBA32 when uploaded, so only the CPU side copy shrinks.
+    storage: the storage format
+*/
+void S2D_setTextureStorage(TextureStorage storage);
+
+/*
+    Set the palette shared by all STORAGE_INDEX8 textures
+    Pixels are mapped to the nearest opaque palette color, pixels with alpha below 128 to the first
+    fully transparent color if there is one. Changing the palette and calling S2D_updateTexture recolors
+    existing textures.
+    colors: rgba palette colors
+    count: the number of colors, at most 256
+    Returns 0 on success, error code ERROR_CREATE_TEXTURE on failure
+*/
+int S2D_setTexturePalette(const Uint32 *colors, int count);
+
+/*
+    Set the color a texture is multiplied with when drawn with S2D_drawTexture, used to color STORAGE_A8 textures
+    txt: the texture to tint
+    rgba: the tint color, DRAW_COLOR_WHITE for none
+    Returns 0 on success, error code ERROR_DESTROYED_TEXTURE on failure
+*/
+int S2D_setTextureTint(Texture *txt, Uint32 rgba);
 
 /*
     Destroy a texture instance
@@ -487,6 +847,31 @@ void S2D_destroyTexture(Texture *txt);
 */
 int S2D_drawTexture(Texture *text, Rectangle *rect);
 
+/*
+    Texture instance structure, one copy of a texture drawn by S2D_drawTextureInstances
+    dst: the rectangle to draw the copy on
+    src: the part of the texture to draw in texture pixels, w or h of 0 draws the whole texture
+    tint: rgba color multiplied with the texture pixels, DRAW_COLOR_WHITE for none
+    rotation: clockwise rotation in degrees around the center of dst
+    flip: FlipMode flags
+*/
+typedef struct {
+    Rectangle dst;
+    Rectangle src;
+    Uint32 tint;
+    float rotation;
+    int flip;
+} S2D_Instance;
+
+/*
+    Draw many copies of a texture with a single SDL call
+    txt: the texture to draw
+    inst: the instances to draw
+    n: the number of instances
+    Returns 0 on success, error code ERROR_DRAW_TEXTURE on failure
+*/
+int S2D_drawTextureInstances(Texture *txt, const S2D_Instance *inst, int n);
+
 /*
     Draw a texture on a rectangle which is set to the textures native dimensions
     text: the texture to draw
@@ -498,6 +883,7 @@ int S2D_drawTextureNative(Texture *txt, Vector origin);
 /*
     Create a texture WITH UTF8 text from a string.
     Note that direction in the stringRenderData struct is ignored due to setting it to any value causes a bug, so for now only LTR render is supported
+    With STORAGE_A8 the foreground color is set as the texture tint
     txt: the texture to create
     d: the string render data
     Returns 0 on success, error code ERROR_CREATE_TEXTURE on failure
@@ -545,6 +931,75 @@ int S2D_readRendererPixelData(Rectangle *rect, RendererPixels *rpx);
 */
 void S2D_freeRendererPixelData(RendererPixels *rpx);
 
+/*
+    Options of an image comparison, zero initialize for an exact comparison
+    tolerance: the largest difference of a channel still counted as equal, 0 to 255
+    max_differing: the number of pixels allowed to differ beyond the tolerance
+    masks: regions left out of the comparison, e.g. a frame counter, may be NULL
+    mask_count: the number of masks
+    diff_path: a PNG image showing the differing pixels is written here when the images differ, NULL for none
+*/
+typedef struct {
+    int tolerance;
+    Uint64 max_differing;
+    const Rectangle *masks;
+    int mask_count;
+    const char *diff_path;
+} S2D_CompareOptions;
+
+/*
+    Result of an image comparison
+    compared: the number of pixels outside the masks
+    differing: the number of pixels with a channel differing by more than the tolerance
+    max_diff: the largest channel difference outside the masks
+    first: the first differing pixel in row order, -1, -1 when none
+*/
+typedef struct {
+    Uint64 compared;
+    Uint64 differing;
+    int max_diff;
+    Vector first;
+} S2D_ImageDiff;
+
+/*
+    Compare two images per channel, e.g. a frame read with S2D_readRendererPixelData against a stored reference
+    The comparison is vectorized and spread over worker threads, fast enough to check every frame of a replay.
+    image: the image to check, RGBA32 as read back from the renderer
+    reference: the expected image, of the same size and format
+    opt: tolerance, masks and diff image, NULL for an exact comparison
+    diff: receives the comparison result
+    Returns 0 when the images match, error code ERROR_IMAGE_MISMATCH when they differ,
+    error code ERROR_IMAGE_COMPARE when they can not be compared
+*/
+int S2D_compareImages(const RendererPixels *image, const RendererPixels *reference, const S2D_CompareOptions *opt, S2D_ImageDiff *diff);
+
+/*
+    Load an image file as RGBA32 pixels, e.g. a comparison reference, free with S2D_freeRendererPixelData
+    path: the image file
+    rpx: receives the pixels
+    Returns 0 on success, error code ERROR_IMAGE_COMPARE on failure
+*/
+int S2D_loadImagePixels(const char *path, RendererPixels *rpx);
+
+/*
+    Write RGBA32 pixels to a PNG file
+    path: the file to write
+    rpx: the pixels, e.g. read with S2D_readRendererPixelData
+    Returns 0 on success, error code ERROR_IMAGE_COMPARE on failure
+*/
+int S2D_saveImagePixels(const char *path, const RendererPixels *rpx);
+
+/*
+    Compare the rendered frame of the current context with a reference PNG image, call before S2D_presentRender
+    When the reference file does not exist yet it is written from the frame, delete it to accept a changed output.
+    reference_path: the reference image
+    opt: tolerance, masks and diff image, NULL for an exact comparison
+    diff: receives the comparison result
+    Returns 0 when the frame matches or the reference was written, error code ERROR_IMAGE_MISMATCH when it differs,
+    error code ERROR_IMAGE_COMPARE on failure
+*/
+int S2D_checkGoldenFrame(const char *reference_path, const S2D_CompareOptions *opt, S2D_ImageDiff *diff);
+
 void S2D_setCoord(Vector *coord, int x, int y);
 
 /*
@@ -566,10 +1021,362 @@ void S2D_addKeyboardEventhandler(void (*fun_ptr)(KeyboardEvent *, void *));
 void S2D_addMouseEventHandler(void (*fun_ptr)(MouseEvent *, void *));
 
 /*
-    Get ticks in ms since S2D_initialize was called
+    Set the camera applied to every subsequent draw call
+    With a camera set, draw coordinates are world coordinates which are transformed to the window.
+    Draws completely outside the visible region are rejected before reaching SDL, see S2D_getFrameStats
+    position: the world position shown at the center of the window
+    zoom: the scale factor from world to window pixels, 1 for none
+    rotation: the camera rotation in degrees, the world appears rotated by -rotation
+*/
+void S2D_setCamera(fVector position, float zoom, float rotation);
+
+/*
+    Remove the camera, draw coordinates are window coordinates again
+*/
+void S2D_resetCamera();
+
+/*
+    Convert between window and world coordinates using the current camera, for example for mouse input
+*/
+fVector S2D_screenToWorld(fVector screen);
+fVector S2D_worldToScreen(fVector world);
+
+/*
+    Frame statistics structure
+    submitted: the number of draw items passed on to SDL
+    culled: the number of draw items rejected for being outside the visible region
+    draw_calls: the number of SDL render calls issued for drawing
+    heap_allocs: the number of heap allocations made by the library, 0 in steady state frames
+*/
+typedef struct {
+    Uint32 submitted;
+    Uint32 culled;
+    Uint32 draw_calls;
+    Uint32 heap_allocs;
+} S2D_FrameStats;
+
+/*
+    Get the statistics of the last presented frame, counters are reset by S2D_presentRender
+*/
+S2D_FrameStats S2D_getFrameStats();
+
+/*
+    Allocate memory that is valid until the end of the current frame, no free is needed
+    The memory of the thread calling S2D_presentRender is reclaimed there. Other threads get their own
+    arenas, which a present never touches, and reclaim them by calling S2D_frameReset at their own frame
+    boundaries.
+    size: the number of bytes to allocate
+    align: the alignment in bytes, a power of two, 0 for the default of 16
+    Returns a pointer to the memory on success, NULL on failure
+*/
+void* S2D_frameAlloc(size_t size, size_t align);
+
+/*
+    Reclaim all frame memory of the calling thread, for threads with their own frame boundaries
+*/
+void S2D_frameReset();
+
+/*
+    Free the frame arena of the calling thread, call before a worker thread using S2D_frameAlloc exits
+*/
+void S2D_frameArenaRelease();
+
+/*
+    Retained render queue
+    Draw items are submitted with a layer and a z value and drawn when the queue is flushed.
+    On flush items are sorted by layer, then z, then texture, blend mode and color, so items sharing
+    state are merged into single SDL submissions instead of switching state for every item.
+
+    Ordering guarantee: items are drawn in ascending layer order and within a layer in ascending z order.
+    Items with equal layer and z may be reordered relative to each other to group state,
+    give overlapping items different z values when their draw order matters.
+    Items with equal layer, z and state are drawn in submission order.
+*/
+typedef struct S2D_RenderQueue S2D_RenderQueue;
+
+/*
+    Create an empty render queue
+    Returns the queue on success, NULL on failure
+*/
+S2D_RenderQueue* S2D_createRenderQueue();
+
+/*
+    Destroy a render queue, any unflushed items are discarded
+*/
+void S2D_destroyRenderQueue(S2D_RenderQueue *q);
+
+/*
+    Queue a filled rectangle
+    q: the render queue
+    layer: the layer of the item
+    z: the z order of the item within the layer
+    rect: the rectangle to fill
+    rgba: the fill color
+    The blend mode set by S2D_setBlendMode at submission time is used
+    Returns 0 on success, error code ERROR_RENDER_QUEUE on failure
+*/
+int S2D_queueFillRectangle(S2D_RenderQueue *q, int layer, int z, const Rectangle *rect, Uint32 rgba);
+
+/*
+    Queue a rectangle outline, same parameters as S2D_queueFillRectangle
+    Returns 0 on success, error code ERROR_RENDER_QUEUE on failure
+*/
+int S2D_queueDrawRectangle(S2D_RenderQueue *q, int layer, int z, const Rectangle *rect, Uint32 rgba);
+
+/*
+    Queue a texture drawn on a rectangle
+    q: the render queue
+    layer: the layer of the item
+    z: the z order of the item within the layer
+    txt: the texture to draw, must stay alive until the queue is flushed
+    rect: the rectangle to draw the texture on
+    Returns 0 on success, error code ERROR_RENDER_QUEUE on failure
+*/
+int S2D_queueTexture(S2D_RenderQueue *q, int layer, int z, Texture *txt, const Rectangle *rect);
+
+/*
+    Sort and draw all queued items, then empty the queue
+    The draw color and blend mode are restored afterwards
+    Returns 0 on success, otherwise the error code of the failing draw
+*/
+int S2D_flushRenderQueue(S2D_RenderQueue *q);
+
+/*
+    Command list, records draw commands on any thread for S2D_submitCommandLists
+    Recording takes no locks and does not touch the renderer, every list must only be recorded
+    into by one thread at a time. Cleared lists keep their memory, so recording stops allocating
+    once a list reached its working size. Coordinates are the same as for the immediate draw calls.
+*/
+typedef struct S2D_CommandList S2D_CommandList;
+
+/*
+    Create an empty command list
+    Returns the list on success, NULL on failure
+*/
+S2D_CommandList* S2D_createCommandList();
+
+/*
+    Destroy a command list
+*/
+void S2D_destroyCommandList(S2D_CommandList *list);
+
+/*
+    Remove all commands from a list, keeping its memory for the next recording
+*/
+void S2D_clearCommandList(S2D_CommandList *list);
+
+/*
+    Record commands, colors apply to the following primitives of the list,
+    the blend mode applies to primitives, textures blend with their own blend mode
+    clip: the clip rectangle in window coordinates, NULL to disable clipping
+    src: the part of the texture to draw in texture pixels, NULL for the whole texture
+    tint: rgba color multiplied with the texture pixels, DRAW_COLOR_WHITE for none
+    Return 0 on success, error code ERROR_COMMAND_LIST on failure, ERROR_DRAW_TEXTURE for destroyed textures
+*/
+int S2D_cmdSetColor(S2D_CommandList *list, Uint32 rgba);
+int S2D_cmdSetBlendMode(S2D_CommandList *list, BlendMode mode);
+int S2D_cmdSetClip(S2D_CommandList *list, const Rectangle *clip);
+int S2D_cmdFillRectangle(S2D_CommandList *list, const fRectangle *rect);
+int S2D_cmdDrawRectangle(S2D_CommandList *list, const fRectangle *rect);
+int S2D_cmdDrawLine(S2D_CommandList *list, fVector c0, fVector c1);
+int S2D_cmdDrawPoint(S2D_CommandList *list, fVector p);
+int S2D_cmdFillCircle(S2D_CommandList *list, fVector center, float radius);
+int S2D_cmdDrawTexture(S2D_CommandList *list, Texture *txt, const fRectangle *dst, const Rectangle *src, Uint32 tint);
+
+/*
+    Draw command lists in array order, must be called from the thread drawing into the current context
+    Every list starts with the draw color and blend mode of the context and no clipping, which are restored afterwards.
+    Lists are not cleared, recording threads must not record into them until this returns.
+    lists: the command lists, NULL entries are skipped
+    n: the number of lists
+    Returns 0 on success, otherwise the error code of the failing draw
+*/
+int S2D_submitCommandLists(S2D_CommandList *const *lists, int n);
+
+/*
+    Chunked tilemap
+    A grid of tile ids drawn from a texture atlas. The atlas is divided into tile sized cells in row major order,
+    tile id 1 is the top left atlas cell and tile id 0 is an empty tile.
+    Tiles are grouped into chunks which are cached in textures and only redrawn after one of their tiles changed,
+    drawing the map costs one texture copy per visible chunk.
+*/
+typedef struct S2D_Tilemap S2D_Tilemap;
+
+/*
+    Create a tilemap with all tiles empty
+    width: the map width in tiles
+    height: the map height in tiles
+    tile_w: the tile width in pixels
+    tile_h: the tile height in pixels
+    atlas: the texture containing the tile images, must outlive the tilemap
+    chunk_tiles: the width and height of a chunk in tiles, 0 for the default of 32
+    Returns the tilemap on success, NULL on failure
+*/
+S2D_Tilemap* S2D_createTilemap(int width, int height, int tile_w, int tile_h, Texture *atlas, int chunk_tiles);
+
+/*
+    Destroy a tilemap and its cached chunk textures
+*/
+void S2D_destroyTilemap(S2D_Tilemap *map);
+
+/*
+    Set the maximum number of chunk textures kept at once, least recently drawn chunks are released first
+    max_resident: the chunk budget, 0 for a default derived from the window size
+*/
+void S2D_setTilemapChunkBudget(S2D_Tilemap *map, int max_resident);
+
+/*
+    Set the tile id at tile coordinates x, y, out of range coordinates are ignored
+*/
+void S2D_setTile(S2D_Tilemap *map, int x, int y, Uint16 tile);
+
+/*
+    Get the tile id at tile coordinates x, y, returns 0 for out of range coordinates
+*/
+Uint16 S2D_getTile(const S2D_Tilemap *map, int x, int y);
+
+/*
+    Draw the part of the tilemap visible in the window
+    view_origin: the map pixel position drawn at the coordinate origin, which is the top left corner
+    of the window without a camera. With a camera set pass {0,0} and move the camera instead
+    Returns 0 on success, error code ERROR_CREATE_TEXTURE or ERROR_DRAW_TEXTURE on failure
+*/
+int S2D_drawTilemap(S2D_Tilemap *map, Vector view_origin);
+
+/*
+    Built-in colormaps, viridis, magma and inferno are perceptually uniform, turbo is a rainbow
+    colormap with smooth lightness
+*/
+typedef enum {COLORMAP_GRAYSCALE, COLORMAP_VIRIDIS, COLORMAP_MAGMA, COLORMAP_INFERNO, COLORMAP_TURBO} ColormapKind;
+
+#define COLORMAP_MAX_SIZE 4096
+
+/*
+    Colormap structure, maps scalar values to colors
+    colors: the rgba colors, in the format of S2D_setDrawColor
+    size: the number of colors
+    min: the value mapped to the first color, smaller values are clamped
+    max: the value mapped to the last color, larger values are clamped
+*/
+typedef struct {
+    const Uint32 *colors;
+    int size;
+    float min;
+    float max;
+} S2D_Colormap;
+
+/*
+    Get a built-in colormap, the color table is shared and must not be freed
+    kind: the colormap
+    size: the number of colors, 256 or COLORMAP_MAX_SIZE
+    min, max: the value range mapped onto the colors
+    Returns the colormap, with colors NULL for an invalid kind or size
+*/
+S2D_Colormap S2D_getColormap(ColormapKind kind, int size, float min, float max);
+
+/*
+    Draw a field of scalar values, one pixel per value colored through a colormap, e.g. a heatmap
+    The values are mapped on several threads into a streaming texture, which is scaled to dst.
+    NaN values get the first color.
+    data: the values, row by row
+    w: the number of values per row
+    h: the number of rows
+    stride: the distance between the starts of two rows in values, at least w
+    lut: the colormap, own color tables of any size can be used
+    dst: the rectangle to draw into, NULL for the whole window
+    Returns 0 on success, error code ERROR_DRAW_FIELD on failure
+*/
+int S2D_drawScalarField(const float *data, int w, int h, int stride, const S2D_Colormap *lut, const Rectangle *dst);
+
+/*
+    Draw a field of 16 bit scalar values, see S2D_drawScalarField
+*/
+int S2D_drawScalarField16(const Uint16 *data, int w, int h, int stride, const S2D_Colormap *lut, const Rectangle *dst);
+
+/*
+    Uniform grid spatial index for rectangle collision queries
+    Entities are identified by the id returned on insertion. Moving an entity within the same grid cells
+    only updates its bounds, so the cost of an update follows the number of cell boundary crossings.
+    Choose a cell size around the size of a typical entity.
+    Rectangles overlap when they share area, touching edges do not count as overlap.
+*/
+typedef struct S2D_SpatialGrid S2D_SpatialGrid;
+
+/*
+    Create a spatial grid
+    cell_size: the width and height of a grid cell
+    expected_entities: initial entity capacity, the grid grows beyond it as needed
+    Returns the grid on success, NULL on failure
+*/
+S2D_SpatialGrid* S2D_createSpatialGrid(float cell_size, int expected_entities);
+
+/*
+    Destroy a spatial grid
+*/
+void S2D_destroySpatialGrid(S2D_SpatialGrid *g);
+
+/*
+    Insert a rectangle into the grid
+    Returns the entity id on success, -1 on failure
+*/
+int S2D_gridInsert(S2D_SpatialGrid *g, const Rectangle *box);
+
+/*
+    Insert a rectangle using float coordinates
+    Returns the entity id on success, -1 on failure
+*/
+int S2D_gridInsertF(S2D_SpatialGrid *g, const fRectangle *box);
+
+/*
+    Update the bounds of an entity
+    Returns 0 on success, -1 on failure
+*/
+int S2D_gridMove(S2D_SpatialGrid *g, int id, const Rectangle *box);
+
+/*
+    Update the bounds of an entity using float coordinates
+    Returns 0 on success, -1 on failure
+*/
+int S2D_gridMoveF(S2D_SpatialGrid *g, int id, const fRectangle *box);
+
+/*
+    Remove an entity, its id may be reused by later insertions
+*/
+void S2D_gridRemove(S2D_SpatialGrid *g, int id);
+
+/*
+    Find the entities overlapping a rectangle
+    out: array receiving the entity ids
+    max: the size of the out array
+    Returns the number of overlapping entities, which can be larger than max
+*/
+int S2D_gridQuery(S2D_SpatialGrid *g, const Rectangle *box, int *out, int max);
+int S2D_gridQueryF(S2D_SpatialGrid *g, const fRectangle *box, int *out, int max);
+
+/*
+    Find the entities containing a point, parameters and return value as for S2D_gridQuery
+*/
+int S2D_gridQueryPoint(S2D_SpatialGrid *g, Vector p, int *out, int max);
+int S2D_gridQueryPointF(S2D_SpatialGrid *g, fVector p, int *out, int max);
+
+/*
+    Enumerate every pair of overlapping entities once
+    callback: called with the two entity ids, lower id first, may be NULL to only count
+    data: passed along to the callback
+    Returns the number of overlapping pairs
+*/
+int S2D_gridForEachPair(S2D_SpatialGrid *g, void (*callback)(int, int, void *), void *data);
+
+/*
+    Get ticks in ms since S2D_initialize was called, the recorded ticks while input is replayed
 */
 Uint32 S2D_getTicks();
 
+/*
+    Get a monotonic time in nanoseconds from the high resolution performance counter, for measuring intervals
+*/
+Uint64 S2D_getTimeNs();
+
 /*
     Set intervalled callbacks. The callback function is called every interval_ms milliseconds
     until it returns 0 or the timer is removed. 
@@ -585,13 +1392,124 @@ S2D_timerID S2D_setInterval(Uint32 interval_ms, Uint32 (*callbackFn)(Uint32, voi
 */
 bool S2D_removeTimer(S2D_timerID id);
 
+/*
+    Timer wheel for large numbers of cheap timers, such as per entity cooldowns
+    Unlike S2D_setInterval, callbacks run on the thread advancing the wheel, so they may draw.
+    Adding and cancelling timers takes constant time, timers are kept at a resolution of 1 ms.
+    Timers due in the same advance fire in deadline order.
+*/
+typedef struct S2D_TimerWheel S2D_TimerWheel;
+
+/*
+    Create a timer wheel
+    expected_timers: initial timer capacity, the wheel grows beyond it as needed
+    Returns the wheel on success, NULL on failure
+*/
+S2D_TimerWheel* S2D_createTimerWheel(int expected_timers);
+
+/*
+    Destroy a timer wheel, pending timers are dropped without firing
+*/
+void S2D_destroyTimerWheel(S2D_TimerWheel *w);
+
+/*
+    Add a timer to the wheel
+    delay_ms: the time until the timer first fires
+    repeat_ms: the interval of a repeating timer, 0 for a one-shot timer
+    callback: called with the timer id and data when the timer fires, may add and cancel timers
+    data: passed along to the callback
+    Returns the timer id on success, -1 on failure
+*/
+S2D_timerID S2D_wheelAddTimer(S2D_TimerWheel *w, Uint32 delay_ms, Uint32 repeat_ms, void (*callback)(S2D_timerID, void *), void *data);
+
+/*
+    Cancel a timer, a repeating timer may cancel itself from its callback
+    Returns TRUE if the timer was pending, FALSE if it already fired or was cancelled
+*/
+bool S2D_wheelCancelTimer(S2D_TimerWheel *w, S2D_timerID id);
+
+/*
+    Get the number of pending timers
+*/
+int S2D_wheelTimerCount(const S2D_TimerWheel *w);
+
+/*
+    Get the time until the next timer may fire, for the timeout of S2D_waitEvents
+    Returns the time in ms, may be earlier than the actual next timer, -1 when no timer is pending
+*/
+int S2D_wheelTimeUntilNext(const S2D_TimerWheel *w);
+
+/*
+    Advance the wheel and fire the timers that became due, call once per frame or event pump
+    elapsed_ns: the time passed since the last advance, e.g. the difference of two S2D_getTimeNs calls
+    Returns the number of callbacks fired
+*/
+int S2D_advanceTimerWheel(S2D_TimerWheel *w, Uint64 elapsed_ns);
+
 /*
     Dequeues an event from the event queue that is then passed along to the corresponding event handler, can be looped to dequeue all events
+    Events of a window go to the handlers of the context owning the window, other events to the current context
     data: the data to pass along to the event handler
     Returns 1 if an event was dequeued, 0 otherwise
 */
 int S2D_eventDequeue(void *data);
 
+/*
+    Sleep until an event arrives, S2D_wakeEventLoop is called or the timeout passes, then pass every
+    pending event along to the corresponding event handler. Use instead of polling S2D_eventDequeue
+    when the application has nothing to do until the next input.
+    timeout_ms: the longest time to sleep in milliseconds, negative to wait without timeout
+    data: the data to pass along to the event handlers
+    Returns the number of events passed to the event handlers, 0 on timeout or wake up
+*/
+int S2D_waitEvents(int timeout_ms, void *data);
+
+/*
+    Wake up S2D_waitEvents, can be called from any thread, e.g. a worker that finished a job
+    or an interval callback. Wakes before the event loop sleeps again are coalesced into one.
+    Returns 0 on success, error code ERROR_WAKE_EVENT_LOOP on failure
+*/
+int S2D_wakeEventLoop();
+
+/*
+    Input replay speed
+    REPLAY_REALTIME: frames and waits take as long as they did while recording
+    REPLAY_FAST: S2D_delay and S2D_waitEvents return at once, frames run as fast as possible
+    REPLAY_HEADLESS: as REPLAY_FAST, on the dummy video driver when replay starts before S2D_initialize
+*/
+typedef enum {REPLAY_REALTIME, REPLAY_FAST, REPLAY_HEADLESS} ReplayMode;
+
+/*
+    Record the input of the application to a compact binary file: every event passed to the event handlers,
+    the frame boundaries of S2D_presentRender and the results of S2D_getTicks on the calling thread.
+    Recording stops at exit at the latest.
+    path: the file to write
+    Returns 0 on success, error code ERROR_INPUT_RECORDING on failure
+*/
+int S2D_startInputRecording(const char *path);
+
+/*
+    Stop the input recording and close its file
+*/
+void S2D_stopInputRecording();
+
+/*
+    Replay a recording made with S2D_startInputRecording. The recorded events are passed to the event handlers
+    instead of live input and S2D_getTicks returns the recorded ticks, so an application whose behaviour only
+    depends on its input and S2D_getTicks, e.g. with a fixed random seed, draws the same frames again.
+    Call before the main loop, S2D_getTicks continues from the recorded time once the replay ended.
+    S2D_getTimeNs is not replayed, frame time measurements stay real.
+    path: the recording to replay
+    mode: the replay speed
+    Returns 0 on success, error code ERROR_INPUT_RECORDING on failure
+*/
+int S2D_replayInput(const char *path, ReplayMode mode);
+
+/*
+    Returns TRUE while a recording is replayed, FALSE once it ended
+*/
+bool S2D_isReplayingInput();
+
 
 /*
     converts a hex rgba color code to a color struct
@@ -603,4 +1521,222 @@ Color S2D_colorHexToStruct(Uint32 rgbaHEX);
 */
 Uint32 S2D_colorStructToHex(Color color);
 
+/*
+    Start recording trace spans to a Chrome Trace Event JSON file, viewable in chrome://tracing or ui.perfetto.dev
+    The library records spans for presenting, texture creation and upload, text rendering, readback and event pumping.
+    Spans can be recorded from any thread, each thread records into its own lock free ring buffer.
+    The file is completed by S2D_traceStop, which is also called at exit.
+    path: the file path of the trace file
+    events_per_thread: ring buffer capacity in events per thread, rounded up to a power of two, 0 for the default of 65536
+    Returns 0 on success, error code ERROR_TRACE on failure
+*/
+int S2D_traceStart(const char *path, int events_per_thread);
+
+/*
+    Begin a user defined trace span on the calling thread, must be matched by S2D_traceEnd
+    name: the span name, must be a string literal or stay valid until the trace is flushed
+*/
+void S2D_traceBegin(const char *name);
+
+/*
+    End the most recent trace span on the calling thread
+*/
+void S2D_traceEnd();
+
+/*
+    Write all recorded spans to the trace file, events are dropped when a thread buffer fills up between flushes
+    Returns 0 on success, error code ERROR_TRACE on failure
+*/
+int S2D_traceFlush();
+
+/*
+    Flush remaining spans and close the trace file
+*/
+void S2D_traceStop();
+
+/*
+    Frame time profile structure, durations in nanoseconds
+    frames: the number of frames measured
+    over_budget: the number of frames longer than budget_ns
+    budget_ns: the frame budget passed to S2D_startFrameProfiler
+    mean_ns: the mean frame duration
+    p50_ns, p95_ns, p99_ns: frame duration percentiles, accurate to within 3%
+    max_ns: the longest frame duration
+*/
+typedef struct {
+    Uint64 frames;
+    Uint64 over_budget;
+    Uint64 budget_ns;
+    Uint64 mean_ns;
+    Uint64 p50_ns;
+    Uint64 p95_ns;
+    Uint64 p99_ns;
+    Uint64 max_ns;
+} S2D_FrameProfile;
+
+/*
+    Start recording the duration of every frame of the current context, the time between successive
+    S2D_presentRender calls, into a histogram. Restarting clears the recorded frames.
+    The profile of the default context is dumped at exit.
+    budget_ns: frames longer than this are counted as over budget, e.g. 16666667 for 60 fps
+    dump_path: the file the profile is dumped to at exit or by S2D_stopFrameProfiler, NULL for stdout
+    Returns 0 on success, error code ERROR_PROFILER on failure
+*/
+int S2D_startFrameProfiler(Uint64 budget_ns, const char *dump_path);
+
+/*
+    Dump the profile and stop recording frame durations of the current context
+*/
+void S2D_stopFrameProfiler();
+
+/*
+    Clear the recorded frames of the current context
+*/
+void S2D_resetFrameProfile();
+
+/*
+    Get the frame time profile of the current context, all zero when the profiler is not started
+*/
+S2D_FrameProfile S2D_getFrameProfile();
+
+/*
+    Get a frame duration percentile of the current context
+    pct: the percentile, between 0 and 100
+    Returns the duration in nanoseconds, 0 when the profiler is not started
+*/
+Uint64 S2D_getFramePercentile(double pct);
+
+/*
+    Write the frame time profile of the current context, a summary followed by the histogram buckets
+    path: the file to write, NULL for stdout
+    Returns 0 on success, error code ERROR_PROFILER on failure
+*/
+int S2D_dumpFrameProfile(const char *path);
+
+/*
+    Rendering context, owns a window or offscreen renderer together with its draw state, camera,
+    event handlers and caches. The functions without a context argument draw into the current context
+    of the calling thread, which is the default context unless another one is bound.
+    Textures and tilemaps belong to the renderer of the context they were created or first drawn in.
+    Independent contexts can be drawn into from different threads at the same time.
+*/
+typedef struct S2D_Context S2D_Context;
+
+/*
+    Get the default context, the one S2D_createWindow sets up when no other context is bound
+*/
+S2D_Context* S2D_defaultContext();
+
+/*
+    Create a context with its own window
+    title: the window title
+    w: the window width
+    h: the window height
+    Returns the context on success, NULL on failure
+*/
+S2D_Context* S2D_createContext(const char *title, int w, int h);
+
+/*
+    Create a context rendering into offscreen memory with the software renderer,
+    the result is read with S2D_ctx_readRendererPixelData
+    w: the width in pixels
+    h: the height in pixels
+    Returns the context on success, NULL on failure
+*/
+S2D_Context* S2D_createOffscreenContext(int w, int h);
+
+/*
+    Destroy a context and its window or offscreen renderer, destroy its textures first
+    The default context can not be destroyed.
+*/
+void S2D_destroyContext(S2D_Context *ctx);
+
+/*
+    Bind the current context of the calling thread
+    ctx: the context to bind, NULL for the default context
+    Returns the previously current context
+*/
+S2D_Context* S2D_setCurrentContext(S2D_Context *ctx);
+
+/*
+    Enable or disable threaded rendering for the current context
+    While enabled, drawing records the frame and S2D_presentRender hands it to a render thread, which draws
+    and presents it while the next frame is built. Texture creation, updates, read back and tilemap chunk
+    drawing wait for the queued frames to be drawn first. SDL errors of deferred drawing are not reported.
+    Disabling draws the queued frames and returns the renderer to the calling thread.
+    enabled: TRUE to start the render thread, FALSE to stop it
+    frames_in_flight: the number of presented frames that may wait to be drawn before S2D_presentRender blocks, 0 for 2
+    Returns 0 on success, error code ERROR_RENDER_THREAD on failure
+*/
+int S2D_setThreadedRendering(bool enabled, int frames_in_flight);
+
+/*
+    Context variants of the drawing, texture, camera and event handler functions
+    S2D_ctx_X(ctx, ...) behaves like S2D_X(...) called with ctx bound as the current context.
+*/
+int S2D_ctx_setDrawColor(S2D_Context *ctx, Uint32 rgba);
+int S2D_ctx_setBlendMode(S2D_Context *ctx, BlendMode mode);
+int S2D_ctx_setRenderScale(S2D_Context *ctx, float x_scale, float y_scale);
+Drawstate S2D_ctx_getDrawState(S2D_Context *ctx);
+int S2D_ctx_clearScreen(S2D_Context *ctx);
+int S2D_ctx_setThreadedRendering(S2D_Context *ctx, bool enabled, int frames_in_flight);
+int S2D_ctx_setInternalResolution(S2D_Context *ctx, int w, int h, UpscaleFilter filter);
+int S2D_ctx_setDynamicResolution(S2D_Context *ctx, Uint64 budget_ns, float min_scale);
+
+int S2D_ctx_drawPoint(S2D_Context *ctx, Vector c);
+int S2D_ctx_drawPointF(S2D_Context *ctx, fVector p);
+int S2D_ctx_drawPoints(S2D_Context *ctx, const Vector *points, int count);
+int S2D_ctx_drawPointsF(S2D_Context *ctx, const fVector *points, int count);
+int S2D_ctx_drawLine(S2D_Context *ctx, Vector c0, Vector c1);
+int S2D_ctx_drawLineF(S2D_Context *ctx, fVector c0, fVector c1);
+int S2D_ctx_drawRectangle(S2D_Context *ctx, const Rectangle *rect);
+int S2D_ctx_drawRectangleF(S2D_Context *ctx, const fRectangle *rect);
+int S2D_ctx_fillRectangle(S2D_Context *ctx, const Rectangle *rect);
+int S2D_ctx_fillRectangleF(S2D_Context *ctx, const fRectangle *rect);
+int S2D_ctx_drawFillRectangle(S2D_Context *ctx, const Rectangle *rect);
+int S2D_ctx_drawFillRectangleF(S2D_Context *ctx, const fRectangle *rect);
+int S2D_ctx_fillRectangles(S2D_Context *ctx, const Rectangle *rects, int count, const Uint32 *colors);
+int S2D_ctx_fillRectanglesF(S2D_Context *ctx, const fRectangle *rects, int count, const Uint32 *colors);
+int S2D_ctx_drawRectangles(S2D_Context *ctx, const Rectangle *rects, int count, const Uint32 *colors);
+int S2D_ctx_drawRectanglesF(S2D_Context *ctx, const fRectangle *rects, int count, const Uint32 *colors);
+int S2D_ctx_drawLines(S2D_Context *ctx, const Vector *points, int count, const Uint32 *colors);
+int S2D_ctx_drawLinesF(S2D_Context *ctx, const fVector *points, int count, const Uint32 *colors);
+
+int S2D_ctx_fillCircle(S2D_Context *ctx, fVector center, float radius);
+int S2D_ctx_drawCircle(S2D_Context *ctx, fVector center, float radius, float thickness);
+int S2D_ctx_fillEllipse(S2D_Context *ctx, fVector center, float rx, float ry);
+int S2D_ctx_drawEllipse(S2D_Context *ctx, fVector center, float rx, float ry, float thickness);
+int S2D_ctx_fillPolygon(S2D_Context *ctx, const fVector *points, int count);
+int S2D_ctx_drawPolyline(S2D_Context *ctx, const fVector *points, int count, float thickness, LineJoin join, bool closed);
+int S2D_ctx_drawMesh(S2D_Context *ctx, const S2D_Mesh *mesh, fVector offset);
+
+int S2D_ctx_createTexture(S2D_Context *ctx, const char *file, Texture *text);
+int S2D_ctx_createTextureFromPixels(S2D_Context *ctx, void *pixels, int w, int h, int pitch, PixelFormat format, int flags, Texture *txt);
+int S2D_ctx_createTiledTexture(S2D_Context *ctx, const char *file, int tile_size, Texture *txt);
+int S2D_ctx_createUTF8Texture(S2D_Context *ctx, Texture *txt, StringRenderData *d);
+void S2D_ctx_setTextureStorage(S2D_Context *ctx, TextureStorage storage);
+void S2D_ctx_destroyTexture(S2D_Context *ctx, Texture *txt);
+int S2D_ctx_drawTexture(S2D_Context *ctx, Texture *txt, Rectangle *rect);
+int S2D_ctx_drawTextureInstances(S2D_Context *ctx, Texture *txt, const S2D_Instance *inst, int n);
+int S2D_ctx_drawTextureNative(S2D_Context *ctx, Texture *txt, Vector origin);
+
+void S2D_ctx_presentRender(S2D_Context *ctx);
+int S2D_ctx_readRendererPixelData(S2D_Context *ctx, Rectangle *rect, RendererPixels *rpx);
+void S2D_ctx_freeRendererPixelData(S2D_Context *ctx, RendererPixels *rpx);
+void S2D_ctx_addKeyboardEventhandler(S2D_Context *ctx, void (*fun_ptr)(KeyboardEvent *, void *));
+void S2D_ctx_addMouseEventHandler(S2D_Context *ctx, void (*fun_ptr)(MouseEvent *, void *));
+
+void S2D_ctx_setCamera(S2D_Context *ctx, fVector position, float zoom, float rotation);
+void S2D_ctx_resetCamera(S2D_Context *ctx);
+fVector S2D_ctx_screenToWorld(S2D_Context *ctx, fVector screen);
+fVector S2D_ctx_worldToScreen(S2D_Context *ctx, fVector world);
+S2D_FrameStats S2D_ctx_getFrameStats(S2D_Context *ctx);
+S2D_FrameProfile S2D_ctx_getFrameProfile(S2D_Context *ctx);
+
+int S2D_ctx_flushRenderQueue(S2D_Context *ctx, S2D_RenderQueue *q);
+int S2D_ctx_submitCommandLists(S2D_Context *ctx, S2D_CommandList *const *lists, int n);
+int S2D_ctx_drawTilemap(S2D_Context *ctx, S2D_Tilemap *map, Vector view_origin);
+int S2D_ctx_drawScalarField(S2D_Context *ctx, const float *data, int w, int h, int stride, const S2D_Colormap *lut, const Rectangle *dst);
+int S2D_ctx_drawScalarField16(S2D_Context *ctx, const Uint16 *data, int w, int h, int stride, const S2D_Colormap *lut, const Rectangle *dst);
+
 #endif
\ No newline at end of file
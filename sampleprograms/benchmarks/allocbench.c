@@ -0,0 +1,147 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    Steady state allocation check
+    Counts every malloc, calloc and realloc made while drawing warmed up frames of the batched, camera,
+    command list and polygon paths into an offscreen context, and fails unless every path makes none.
+    The library sources have to be linked into the program with the allocator calls wrapped:
+    build: gcc allocbench.c $(find ../../src -name '*.c') -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc $(sdl2-config --cflags --libs) -lm
+    usage: ./allocbench <warmup_frames> <frames>
+*/
+
+#define TARGET_SIZE 1024
+#define SPRITES 2000
+#define COMMANDS 4000
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+static SDL_atomic_t g_counting, g_allocs;
+
+void* __wrap_malloc(size_t size){
+    if (SDL_AtomicGet(&g_counting)) SDL_AtomicAdd(&g_allocs, 1);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size){
+    if (SDL_AtomicGet(&g_counting)) SDL_AtomicAdd(&g_allocs, 1);
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* p, size_t size){
+    if (SDL_AtomicGet(&g_counting)) SDL_AtomicAdd(&g_allocs, 1);
+    return __real_realloc(p, size);
+}
+
+typedef struct {
+    Texture sprite;
+    S2D_CommandList* list;
+    fRectangle rects[SPRITES];
+    Uint32 colors[SPRITES];
+    S2D_Instance instances[SPRITES];
+} Scene;
+
+static void drawBatched(Scene* s, int frame){
+    for (int i = 0; i < SPRITES; i++){
+        s->rects[i].origin.x = (i * 37 + frame * 3) % TARGET_SIZE;
+        s->instances[i].rotation = (float)(frame + i);
+    }
+    S2D_fillRectanglesF(s->rects, SPRITES, s->colors);
+    S2D_drawTextureInstances(&s->sprite, s->instances, SPRITES);
+}
+
+// most sprites end up outside the rotated and zoomed view and are culled
+static void drawCamera(Scene* s, int frame){
+    S2D_setCamera((fVector){TARGET_SIZE / 2 + frame % 200, TARGET_SIZE / 2}, 2.5f, (float)(frame % 360));
+    for (int i = 0; i < SPRITES; i += 4){
+        Rectangle r = {{(int) s->rects[i].origin.x, (int) s->rects[i].origin.y}, 16, 16};
+        S2D_drawTexture(&s->sprite, &r);
+        S2D_fillRectangleF(&s->rects[i + 1]);
+    }
+    S2D_setCamera((fVector){TARGET_SIZE / 2, TARGET_SIZE / 2}, 1.0f, 0);
+}
+
+static void drawCommandList(Scene* s, int frame){
+    S2D_clearCommandList(s->list);
+    for (int i = 0; i < COMMANDS; i++){
+        float x = (i * 53 + frame) % TARGET_SIZE, y = (i * 97) % TARGET_SIZE;
+        if (i % 16 == 0) S2D_cmdSetColor(s->list, 0xFF000000 | i * 2654435761u);
+        switch (i % 4){
+            case 0: S2D_cmdFillRectangle(s->list, &(fRectangle){{x, y}, 8, 8}); break;
+            case 1: S2D_cmdFillCircle(s->list, (fVector){x, y}, 4); break;
+            case 2: S2D_cmdDrawLine(s->list, (fVector){x, y}, (fVector){x + 12, y + 5}); break;
+            default: S2D_cmdDrawTexture(s->list, &s->sprite, &(fRectangle){{x, y}, 16, 16}, NULL, 0xFFFFFFFF); break;
+        }
+    }
+    S2D_submitCommandLists(&s->list, 1);
+}
+
+static void drawPolygons(Scene* s, int frame){
+    // a concave star and an open polyline through its points
+    fVector points[24];
+    for (int i = 0; i < 24; i++){
+        float r = i % 2 == 0 ? 300.0f : 120.0f;
+        float a = (i + frame * 0.01f) * 6.2831853f / 24;
+        points[i] = (fVector){TARGET_SIZE / 2 + r * SDL_cosf(a), TARGET_SIZE / 2 + r * SDL_sinf(a)};
+    }
+    S2D_fillPolygon(points, 24);
+    S2D_drawPolyline(points, 24, 6.0f, JOIN_ROUND, FALSE);
+    S2D_drawPolyline(points, 24, 3.0f, JOIN_MITER, TRUE);
+}
+
+// returns the allocations made while drawing frames after the warm up
+static int countAllocations(Scene* s, void (*draw)(Scene*, int), int warmup, int frames){
+    for (int frame = 0; frame < warmup + frames; frame++){
+        if (frame == warmup){
+            SDL_AtomicSet(&g_allocs, 0);
+            SDL_AtomicSet(&g_counting, 1);
+        }
+        S2D_setDrawColor(0xFF000000);
+        S2D_clearScreen();
+        draw(s, frame);
+        S2D_presentRender();
+    }
+    SDL_AtomicSet(&g_counting, 0);
+    return SDL_AtomicGet(&g_allocs);
+}
+
+int main(int gc, char** gv){
+    int warmup = gc > 1 ? atoi(gv[1]) : 30;
+    int frames = gc > 2 ? atoi(gv[2]) : 300;
+    if (warmup <= 0 || frames <= 0 || S2D_initialize() != 0) return 1;
+    S2D_Context* ctx = S2D_createOffscreenContext(TARGET_SIZE, TARGET_SIZE);
+    if (ctx == NULL) return 1;
+    S2D_setCurrentContext(ctx);
+
+    static Scene s;
+    Uint32* pixels = malloc(16 * 16 * sizeof(Uint32));
+    s.list = S2D_createCommandList();
+    if (pixels == NULL || s.list == NULL) return 1;
+    for (int i = 0; i < 16 * 16; i++) pixels[i] = 0xFF000000 | i * 997;
+    if (S2D_createTextureFromPixels(pixels, 16, 16, 16 * sizeof(Uint32), PIXEL_FORMAT_RGBA32, 0, &s.sprite) != 0) return 1;
+    for (int i = 0; i < SPRITES; i++){
+        s.rects[i] = (fRectangle){{0, (i * 61) % TARGET_SIZE}, 6, 6};
+        s.colors[i] = 0xFF000000 | i * 2654435761u;
+        s.instances[i] = (S2D_Instance){{{(i * 41) % TARGET_SIZE, (i * 73) % TARGET_SIZE}, 16, 16}, {{0, 0}, 16, 16}, 0xFFFFFFFF, 0, 0};
+    }
+
+    struct { const char* name; void (*draw)(Scene*, int); } paths[] = {
+        {"batched", drawBatched}, {"camera", drawCamera}, {"command list", drawCommandList}, {"polygon", drawPolygons}
+    };
+    int failed = 0;
+    for (int i = 0; i < (int)(sizeof(paths) / sizeof(paths[0])); i++){
+        int allocs = countAllocations(&s, paths[i].draw, warmup, frames);
+        printf("%-14s %d allocations in %d frames, %u in the last frame stats\n", paths[i].name, allocs, frames, S2D_getFrameStats().heap_allocs);
+        if (allocs != 0) failed = 1;
+    }
+    printf(failed ? "FAILED\n" : "passed\n");
+
+    S2D_destroyTexture(&s.sprite);
+    S2D_destroyCommandList(s.list);
+    S2D_setCurrentContext(NULL);
+    S2D_destroyContext(ctx);
+    return failed;
+}
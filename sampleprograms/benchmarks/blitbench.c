@@ -0,0 +1,78 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+    Blitter benchmark
+    Prints a table of megapixels per second for every source and destination format pair: converting,
+    alpha blending and converting with scaling through S2D_blitPixels, and SDL_ConvertPixels as the
+    generic conversion for comparison where SDL has both formats.
+    usage: ./blitbench <width> <height> <repeats>
+*/
+
+#define FORMAT_COUNT 6
+
+static const char* g_names[FORMAT_COUNT] = {"RGBA32", "BGRA32", "ARGB8888", "RGB24", "RGB565", "A8"};
+static const int g_bpp[FORMAT_COUNT] = {4, 4, 4, 3, 2, 1};
+static const Uint32 g_sdl_formats[FORMAT_COUNT] = {
+    SDL_PIXELFORMAT_RGBA32, SDL_PIXELFORMAT_BGRA32, SDL_PIXELFORMAT_ARGB8888,
+    SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_RGB565, SDL_PIXELFORMAT_UNKNOWN
+};
+
+static double seconds(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// megapixels per second of repeats blits, -1 on failure
+static double blitRate(const Uint8* src, int sf, Uint8* dst, int df, int w, int h, int dw, int dh, BlendMode mode, int repeats){
+    double start = seconds();
+    for (int i = 0; i < repeats; i++){
+        if (S2D_blitPixels(src, w, h, w * g_bpp[sf], sf, dst, dw, dh, dw * g_bpp[df], df, mode) != 0) return -1;
+    }
+    return (double) dw * dh * repeats / (seconds() - start) / 1e6;
+}
+
+static double sdlRate(const Uint8* src, int sf, Uint8* dst, int df, int w, int h, int repeats){
+    if (g_sdl_formats[sf] == SDL_PIXELFORMAT_UNKNOWN || g_sdl_formats[df] == SDL_PIXELFORMAT_UNKNOWN) return -1;
+    double start = seconds();
+    for (int i = 0; i < repeats; i++){
+        if (SDL_ConvertPixels(w, h, g_sdl_formats[sf], src, w * g_bpp[sf], g_sdl_formats[df], dst, w * g_bpp[df]) != 0) return -1;
+    }
+    return (double) w * h * repeats / (seconds() - start) / 1e6;
+}
+
+static void printRate(double rate){
+    if (rate < 0) printf("%10s", "-");
+    else printf("%10.0f", rate);
+}
+
+int main(int argc, char** argv){
+    int w = argc > 1 ? atoi(argv[1]) : 1920;
+    int h = argc > 2 ? atoi(argv[2]) : 1080;
+    int repeats = argc > 3 ? atoi(argv[3]) : 20;
+    if (w <= 0 || h <= 0 || repeats <= 0) return 1;
+
+    Uint8* src = malloc((size_t) w * h * 4);
+    Uint8* dst = malloc((size_t) w * h * 4 * 4);
+    if (src == NULL || dst == NULL) return 1;
+    for (size_t i = 0; i < (size_t) w * h * 4; i++) src[i] = rand();
+
+    printf("%dx%d, megapixels per second, scaled blits are 1.5x the size\n", w, h);
+    printf("%-10s%-10s%10s%10s%10s%10s\n", "source", "dest", "convert", "alpha", "scaled", "SDL");
+    for (int sf = 0; sf < FORMAT_COUNT; sf++){
+        for (int df = 0; df < FORMAT_COUNT; df++){
+            printf("%-10s%-10s", g_names[sf], g_names[df]);
+            printRate(blitRate(src, sf, dst, df, w, h, w, h, BLEND_NONE, repeats));
+            printRate(blitRate(src, sf, dst, df, w, h, w, h, BLEND_ALPHA, repeats));
+            printRate(blitRate(src, sf, dst, df, w, h, w * 3 / 2, h * 3 / 2, BLEND_NONE, repeats));
+            printRate(sdlRate(src, sf, dst, df, w, h, repeats));
+            printf("\n");
+        }
+    }
+    free(src);
+    free(dst);
+    return 0;
+}
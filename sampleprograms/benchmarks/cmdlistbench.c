@@ -0,0 +1,83 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+    Command list benchmark
+    Every thread records its own command list each frame, recording throughput is measured for
+    1 to 8 threads. The lists of the last frame are then submitted into an offscreen context.
+    usage: ./cmdlistbench <frames> <commands_per_thread>
+*/
+
+#define MAX_THREADS 8
+#define TARGET_SIZE 1024
+
+typedef struct {
+    S2D_CommandList* list;
+    int frames;
+    int commands;
+    int seed;
+} ThreadData;
+
+static double seconds(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void* recordProc(void* arg){
+    ThreadData* td = (ThreadData*) arg;
+    unsigned int seed = td->seed;
+    for (int f = 0; f < td->frames; f++){
+        S2D_clearCommandList(td->list);
+        for (int i = 0; i < td->commands; i++){
+            float x = rand_r(&seed) % TARGET_SIZE, y = rand_r(&seed) % TARGET_SIZE;
+            if (i % 16 == 0) S2D_cmdSetColor(td->list, 0xFF000000 | rand_r(&seed));
+            if (i % 4 == 3) S2D_cmdFillCircle(td->list, (fVector){x, y}, 4);
+            else S2D_cmdFillRectangle(td->list, &(fRectangle){{x, y}, 8, 8});
+        }
+    }
+    return NULL;
+}
+
+static double runRecording(ThreadData* data, int threads, int frames, int commands){
+    pthread_t ids[MAX_THREADS];
+    double start = seconds();
+    for (int i = 0; i < threads; i++){
+        data[i].frames = frames, data[i].commands = commands, data[i].seed = i + 1;
+        pthread_create(&ids[i], NULL, recordProc, &data[i]);
+    }
+    for (int i = 0; i < threads; i++) pthread_join(ids[i], NULL);
+    return seconds() - start;
+}
+
+int main(int gc, char** gv){
+    int frames = gc > 1 ? atoi(gv[1]) : 100;
+    int commands = gc > 2 ? atoi(gv[2]) : 10000;
+    ThreadData data[MAX_THREADS];
+    for (int i = 0; i < MAX_THREADS; i++) data[i].list = S2D_createCommandList();
+
+    // one untimed frame per list, so the timed frames record into warmed up lists
+    runRecording(data, MAX_THREADS, 1, commands);
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2){
+        double t = runRecording(data, threads, frames, commands);
+        printf("%d threads: %.1f M commands/s\n", threads, (double) threads * frames * commands / t * 1e-6);
+    }
+
+    if (S2D_initialize() == 0){
+        S2D_Context* ctx = S2D_createOffscreenContext(TARGET_SIZE, TARGET_SIZE);
+        if (ctx != NULL){
+            S2D_CommandList* lists[MAX_THREADS];
+            for (int i = 0; i < MAX_THREADS; i++) lists[i] = data[i].list;
+            double start = seconds();
+            S2D_ctx_submitCommandLists(ctx, lists, MAX_THREADS);
+            S2D_ctx_presentRender(ctx);
+            printf("submit %d lists: %.2f ms\n", MAX_THREADS, (seconds() - start) * 1e3);
+            S2D_destroyContext(ctx);
+        }
+    }
+    for (int i = 0; i < MAX_THREADS; i++) S2D_destroyCommandList(data[i].list);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    Fill rate benchmark for the internal resolution
+    Draws layers of large alpha blended rectangles into a 1536x1024 offscreen context, at the full size,
+    at half the internal resolution and with dynamic resolution under a frame budget.
+    usage: ./fillbench <frames> <layers> <budget_ms>
+*/
+
+#define CONTEXT_W 1536
+#define CONTEXT_H 1024
+
+static void drawFrame(int frame, int layers){
+    Drawstate ds = S2D_getDrawState();
+    S2D_setBlendMode(BLEND_NONE);
+    S2D_setDrawColor(0xFF000000);
+    S2D_clearScreen();
+    S2D_setBlendMode(BLEND_ALPHA);
+    for (int i = 0; i < layers; i++){
+        // draw coordinates are in the draw size, whichever resolution the pixels are drawn at
+        fRectangle r = {{(float)((frame * 3 + i * 17) % (ds.draw_w / 4)), (float)((i * 29) % (ds.draw_h / 4))}, ds.draw_w * 0.75f, ds.draw_h * 0.75f};
+        S2D_setDrawColor(0x40000000 | (i * 40 % 256) << 16 | (255 - i * 20 % 256) << 8 | 0x80);
+        S2D_fillRectangleF(&r);
+    }
+}
+
+static double run(int frames, int layers){
+    Uint64 start = S2D_getTimeNs();
+    for (int frame = 0; frame < frames; frame++){
+        drawFrame(frame, layers);
+        S2D_presentRender();
+    }
+    return (S2D_getTimeNs() - start) / 1e6 / frames;
+}
+
+int main(int argc, char** argv){
+    int frames = argc > 1 ? atoi(argv[1]) : 120;
+    int layers = argc > 2 ? atoi(argv[2]) : 16;
+    double budget_ms = argc > 3 ? atof(argv[3]) : 8.0;
+    if (frames <= 0 || layers <= 0 || S2D_initialize() != 0) return 1;
+    S2D_Context* ctx = S2D_createOffscreenContext(CONTEXT_W, CONTEXT_H);
+    if (ctx == NULL) return 1;
+    S2D_setCurrentContext(ctx);
+
+    printf("%dx%d, %d layers, ms per frame\n", CONTEXT_W, CONTEXT_H, layers);
+    printf("full size          %8.2f\n", run(frames, layers));
+    if (S2D_setInternalResolution(CONTEXT_W / 2, CONTEXT_H / 2, UPSCALE_NEAREST) != 0) return 1;
+    printf("half, nearest      %8.2f\n", run(frames, layers));
+    if (S2D_setInternalResolution(CONTEXT_W, CONTEXT_H, UPSCALE_LINEAR) != 0) return 1;
+    if (S2D_setDynamicResolution((Uint64)(budget_ms * 1e6), 0.25f) != 0) return 1;
+    double ms = run(frames, layers);
+    int w, h;
+    S2D_getInternalResolution(&w, &h);
+    printf("dynamic, %.1f ms   %8.2f, settled at %dx%d\n", budget_ms, ms, w, h);
+
+    S2D_setInternalResolution(0, 0, UPSCALE_NEAREST);
+    S2D_setCurrentContext(NULL);
+    S2D_destroyContext(ctx);
+    return 0;
+}
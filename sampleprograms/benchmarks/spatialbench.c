@@ -0,0 +1,102 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+    Spatial grid benchmark against brute force collision checks
+    Boxes move randomly each frame, every frame all overlapping pairs are enumerated and checked against
+    brute force. The world is centered on the origin, so cells of negative coordinates are covered too.
+    usage: ./spatialbench <frames>
+*/
+
+#define WORLD_SIZE_PER_1K 1024.0f
+#define BOX_SIZE 8.0f
+#define MAX_SPEED 2.0f
+
+static double seconds(){
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
+static float frand(float max){
+    return max * (float) rand() / (float) RAND_MAX;
+}
+
+static bool overlap(const fRectangle* a, const fRectangle* b){
+    return a->origin.x < b->origin.x + b->w && b->origin.x < a->origin.x + a->w
+        && a->origin.y < b->origin.y + b->h && b->origin.y < a->origin.y + a->h;
+}
+
+static int bruteForcePairs(const fRectangle* boxes, int n){
+    int pairs = 0;
+    for (int i = 0; i < n; i++){
+        for (int j = i + 1; j < n; j++){
+            if (overlap(&boxes[i], &boxes[j])) pairs++;
+        }
+    }
+    return pairs;
+}
+
+static void moveBoxes(fRectangle* boxes, fVector* vel, int n, float world){
+    for (int i = 0; i < n; i++){
+        boxes[i].origin.x += vel[i].x;
+        boxes[i].origin.y += vel[i].y;
+        if (boxes[i].origin.x < -world / 2 || boxes[i].origin.x > world / 2) vel[i].x = -vel[i].x;
+        if (boxes[i].origin.y < -world / 2 || boxes[i].origin.y > world / 2) vel[i].y = -vel[i].y;
+    }
+}
+
+static void runBenchmark(int n, int frames){
+    // world area grows with the box count so the density stays constant
+    float world = WORLD_SIZE_PER_1K;
+    while (world * world < (float) n / 1000 * WORLD_SIZE_PER_1K * WORLD_SIZE_PER_1K) world *= 1.4142f;
+
+    fRectangle* boxes = malloc(n * sizeof(fRectangle));
+    fVector* vel = malloc(n * sizeof(fVector));
+    int* ids = malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++){
+        boxes[i] = (fRectangle){{frand(world) - world / 2, frand(world) - world / 2}, BOX_SIZE, BOX_SIZE};
+        vel[i] = (fVector){frand(2*MAX_SPEED) - MAX_SPEED, frand(2*MAX_SPEED) - MAX_SPEED};
+    }
+
+    S2D_SpatialGrid* g = S2D_createSpatialGrid(2*BOX_SIZE, n);
+    for (int i = 0; i < n; i++) ids[i] = S2D_gridInsertF(g, &boxes[i]);
+
+    double gridTime = 0, bruteTime = 0, t;
+    int gridPairs = 0, brutePairs = 0;
+    bool mismatch = FALSE;
+    for (int f = 0; f < frames; f++){
+        moveBoxes(boxes, vel, n, world);
+
+        t = seconds();
+        for (int i = 0; i < n; i++) S2D_gridMoveF(g, ids[i], &boxes[i]);
+        gridPairs = S2D_gridForEachPair(g, NULL, NULL);
+        gridTime += seconds() - t;
+
+        // brute force gets slow quickly, only the first frame is measured above 10k boxes
+        if (n <= 10000 || f == 0){
+            t = seconds();
+            brutePairs = bruteForcePairs(boxes, n);
+            bruteTime += (seconds() - t) * (n <= 10000 ? 1 : frames);
+            if (brutePairs != gridPairs) mismatch = TRUE;
+        }
+    }
+
+    printf("%7d boxes: grid %9.3f ms/frame, brute force %10.3f ms/frame, overlapping pairs %d%s\n", n,
+        1000 * gridTime / frames, 1000 * bruteTime / frames, gridPairs, mismatch ? " MISMATCH" : "");
+
+    S2D_destroySpatialGrid(g);
+    free(boxes);
+    free(vel);
+    free(ids);
+}
+
+int main(int gc, char** gv){
+    int frames = 20;
+    if (gc > 1) frames = atoi(gv[1]);
+    srand(1);
+    runBenchmark(1000, frames);
+    runBenchmark(10000, frames);
+    runBenchmark(100000, frames);
+    return 0;
+}
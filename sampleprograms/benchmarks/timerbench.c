@@ -0,0 +1,77 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+    Timer benchmark
+    Adds repeating timers with random intervals to a timer wheel and advances it frame by frame at 60 fps
+    of simulated time, then runs the same timers as SDL_AddTimer timers for two seconds of real time.
+    usage: ./timerbench <timers> <frames>
+*/
+
+#define FRAME_NS 16666667ull
+#define SDL_RUN_MS 2000
+
+static double seconds(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long g_wheel_fired;
+static SDL_atomic_t g_sdl_fired;
+
+static void wheelCallback(S2D_timerID id, void* data){
+    g_wheel_fired++;
+}
+
+static Uint32 sdlCallback(Uint32 interval, void* data){
+    SDL_AtomicAdd(&g_sdl_fired, 1);
+    return interval;
+}
+
+int main(int gc, char** gv){
+    int timers = gc > 1 ? atoi(gv[1]) : 100000;
+    int frames = gc > 2 ? atoi(gv[2]) : 3600;
+    Uint32* intervals = malloc(timers * sizeof(Uint32));
+    S2D_timerID* ids = malloc(timers * sizeof(S2D_timerID));
+    SDL_TimerID* sdl_ids = malloc(timers * sizeof(SDL_TimerID));
+    srand(1);
+    for (int i = 0; i < timers; i++) intervals[i] = 100 + rand() % 4900;
+
+    S2D_TimerWheel* w = S2D_createTimerWheel(timers);
+    double start = seconds();
+    for (int i = 0; i < timers; i++) ids[i] = S2D_wheelAddTimer(w, intervals[i], intervals[i], wheelCallback, NULL);
+    printf("wheel: add %d timers %.2f ms\n", timers, (seconds() - start) * 1e3);
+    double worst = 0;
+    start = seconds();
+    for (int f = 0; f < frames; f++){
+        double t = seconds();
+        S2D_advanceTimerWheel(w, FRAME_NS);
+        if (seconds() - t > worst) worst = seconds() - t;
+    }
+    double elapsed = seconds() - start;
+    printf("wheel: %d frames, %ld callbacks, %.2f us per frame, worst frame %.2f us\n", frames, g_wheel_fired, elapsed / frames * 1e6, worst * 1e6);
+    start = seconds();
+    for (int i = 0; i < timers; i++) S2D_wheelCancelTimer(w, ids[i]);
+    printf("wheel: cancel %d timers %.2f ms\n", timers, (seconds() - start) * 1e3);
+    S2D_destroyTimerWheel(w);
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0) return 1;
+    start = seconds();
+    for (int i = 0; i < timers; i++) sdl_ids[i] = SDL_AddTimer(intervals[i], sdlCallback, NULL);
+    printf("SDL_AddTimer: add %d timers %.2f ms\n", timers, (seconds() - start) * 1e3);
+    clock_t cpu = clock();
+    SDL_Delay(SDL_RUN_MS);
+    printf("SDL_AddTimer: %d callbacks in %d ms, %.1f%% of a core on the timer thread\n",
+        SDL_AtomicGet(&g_sdl_fired), SDL_RUN_MS, (double)(clock() - cpu) / CLOCKS_PER_SEC * 1e3 / SDL_RUN_MS * 100);
+    start = seconds();
+    for (int i = 0; i < timers; i++) SDL_RemoveTimer(sdl_ids[i]);
+    printf("SDL_AddTimer: remove %d timers %.2f ms\n", timers, (seconds() - start) * 1e3);
+    SDL_Quit();
+    free(intervals);
+    free(ids);
+    free(sdl_ids);
+    return 0;
+}
@@ -6,7 +6,8 @@
 /*
     Multithreaded Mandelbrot set generator
     default thread count is 4
-    usage: ./mandelbrot <thread_count>
+    usage: ./mandelbrot <thread_count> <trace_file>
+    if trace_file is given a Chrome trace of the compute threads and rendering is written to it
 */
 
 #define WINDOW_W 3*512
@@ -15,7 +16,8 @@
 #define BOUNDARY_SQR 4
 #define SCALER 512.0f
 
-Uint32 g_pixData[WINDOW_W][WINDOW_H];
+// iteration counts, row by row, drawn through a colormap
+float g_field[WINDOW_H][WINDOW_W];
 
 typedef struct {
     float scaler;
@@ -60,10 +62,7 @@ void mandelBrotProc(float scaler, float boundary_sqr, int max_n, int x_start_pos
     int count = 0;
     float v_r, v_z;
     float c_r, c_z;
-    const int colorMult = 2;
     float absSqr = 0;
-    Vector v;
-    Color c = {.R = 0, .G = 0, .B = 0, .A = 255};
     for (int i =x_start_pos; i < window_w; i++)
     {
         for (int j = 0; j < window_h; j++)
@@ -76,29 +75,18 @@ void mandelBrotProc(float scaler, float boundary_sqr, int max_n, int x_start_pos
                 mandelBrotFn(&v_r, &v_z, c_r, c_z);
                 count++;
             }
-            v.x = i, v.y = j;
-            c.R = count * colorMult;
-            c.G = (Uint8)2*absSqr;
-            g_pixData[i][j] = S2D_colorStructToHex(c);
+            g_field[j][i] = count;
         }
         
     }
     
 }
 
-void drawPixels(int x_start_pos, int x_end_pos){
-    for (int i = x_start_pos; i < x_end_pos; i++){
-        for(int j = 0; j < WINDOW_H; j++){
-            S2D_setDrawColor(g_pixData[i][j]);
-            S2D_drawPoint((Vector){i,j});
-        }
-    }
-}
-
-
 void* thread_fun(void* params){
     ThreadData* d = (ThreadData*) params;
+    S2D_traceBegin("mandelBrotProc");
     mandelBrotProc(d->scaler, d->boundary_sqr, d->max_n, d->x_start_pos, d->window_w, d->window_h);
+    S2D_traceEnd();
 }
 
 
@@ -111,6 +99,9 @@ int main(int gc, char** gv){
     if (gc > 1) {
         threadCount = atoi(gv[1]);
     }
+    if (gc > 2) {
+        S2D_traceStart(gv[2], 0);
+    }
 
     pthread_t threads[threadCount];
     ThreadData d[threadCount];
@@ -133,13 +124,15 @@ int main(int gc, char** gv){
 
     for (int i = 0; i < threadCount; i++){
         pthread_join(threads[i], NULL);
-        drawPixels(d[i].x_start_pos, d[i].window_w);
     }
+    S2D_Colormap lut = S2D_getColormap(COLORMAP_MAGMA, 256, 0, MAX_N);
+    S2D_drawScalarField(&g_field[0][0], WINDOW_W, WINDOW_H, WINDOW_W, &lut, NULL);
     printf("Thread count: %d\n", threadCount);
     printf("Time taken: %d\n", S2D_getTicks() - tick);
     S2D_presentRender();
+    // sleeps until input arrives instead of polling
     while (TRUE){
-        S2D_eventDequeue(NULL);
+        S2D_waitEvents(-1, NULL);
     }
 
     return 0;
@@ -0,0 +1,90 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+/*
+    Golden image test, renders an animated scene offscreen and compares every frame with the
+    reference images in a directory, to check that batching and SIMD changes leave the output unchanged
+    Missing references are written on the first run, a differing frame writes frame_<n>_diff.png.
+    The noise square in the corner changes every run and is masked out.
+    usage: ./golden <reference_dir> [tolerance]
+    Exits with 0 when every frame matches, 1 otherwise
+*/
+
+#define SCENE_W 320
+#define SCENE_H 240
+#define FRAMES 60
+#define BAR_COUNT 64
+
+static void drawScene(int frame){
+    float t = frame * 0.05f;
+    S2D_setBlendMode(BLEND_NONE);
+    S2D_setDrawColor(0xFF301010);
+    S2D_clearScreen();
+
+    // many small rectangles, drawn as one batch
+    fRectangle bars[BAR_COUNT];
+    Uint32 colors[BAR_COUNT];
+    for (int i = 0; i < BAR_COUNT; i++){
+        float h = 20 + 60 * (0.5f + 0.5f * sinf(t + i * 0.3f));
+        bars[i] = (fRectangle){{i * (SCENE_W / (float) BAR_COUNT), SCENE_H - h}, SCENE_W / (float) BAR_COUNT - 1, h};
+        colors[i] = 0xFF000000 | (i * 4) << 16 | (255 - i * 4) << 8 | 0x40;
+    }
+    S2D_fillRectanglesF(bars, BAR_COUNT, colors);
+
+    S2D_setBlendMode(BLEND_ALPHA);
+    S2D_setDrawColor(0x8000C0FF);
+    S2D_fillCircle((fVector){SCENE_W/2 + 80 * cosf(t), SCENE_H/2 + 40 * sinf(t)}, 30);
+    S2D_setDrawColor(DRAW_COLOR_WHITE);
+    S2D_drawCircle((fVector){SCENE_W/2, SCENE_H/2}, 100, 2);
+    fVector tri[3] = {{40, 40}, {40 + 50 * cosf(t), 90}, {90, 40 + 50 * sinf(t)}};
+    S2D_drawPolyline(tri, 3, 3, JOIN_ROUND, TRUE);
+
+    // output that differs on every run
+    S2D_setBlendMode(BLEND_NONE);
+    for (int i = 0; i < 8; i++){
+        S2D_setDrawColor(0xFF000000 | (rand() & 0xFFFFFF));
+        Rectangle r = {{SCENE_W - 16 + (i % 4) * 4, (i / 4) * 4}, 4, 4};
+        S2D_fillRectangle(&r);
+    }
+}
+
+int main(int argc, char** argv){
+    if (argc < 2){
+        fprintf(stderr, "usage: %s reference_dir [tolerance]\n", argv[0]);
+        return 1;
+    }
+    srand(time(NULL));
+    if (S2D_initialize() != 0) return 1;
+    S2D_Context* ctx = S2D_createOffscreenContext(SCENE_W, SCENE_H);
+    if (ctx == NULL) return 1;
+    S2D_setCurrentContext(ctx);
+
+    Rectangle noise = {{SCENE_W - 16, 0}, 16, 8};
+    char path[512], diff_path[512];
+    S2D_CompareOptions opt = {.tolerance = argc > 2 ? atoi(argv[2]) : 0, .masks = &noise, .mask_count = 1, .diff_path = diff_path};
+    int failed = 0;
+    Uint64 start = S2D_getTimeNs();
+    for (int frame = 0; frame < FRAMES; frame++){
+        drawScene(frame);
+        snprintf(path, sizeof(path), "%s/frame_%03d.png", argv[1], frame);
+        snprintf(diff_path, sizeof(diff_path), "%s/frame_%03d_diff.png", argv[1], frame);
+        S2D_ImageDiff diff;
+        int code = S2D_checkGoldenFrame(path, &opt, &diff);
+        if (code == ERROR_IMAGE_MISMATCH){
+            printf("frame %d: %llu of %llu pixels differ, largest difference %d, first at %d,%d\n", frame,
+                (unsigned long long) diff.differing, (unsigned long long) diff.compared, diff.max_diff, diff.first.x, diff.first.y);
+            failed++;
+        } else if (code != 0){
+            printf("frame %d: can not compare with %s\n", frame, path);
+            failed++;
+        }
+        S2D_presentRender();
+    }
+    printf("%d of %d frames differ, %.2f ms per frame\n", failed, FRAMES, (S2D_getTimeNs() - start) / 1e6 / FRAMES);
+    S2D_setCurrentContext(NULL);
+    S2D_destroyContext(ctx);
+    return failed != 0;
+}
@@ -0,0 +1,79 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    Map viewer for images of any size, e.g. 30000x30000 maps beyond the maximum texture size
+    The image is loaded as a tiled texture, only the tiles around the visible part are uploaded.
+    Drag with the mouse or use the arrow keys to pan, the mouse wheel zooms.
+    With a cache directory the decoded image is kept in a mapped cache file and later runs skip decoding.
+    usage: ./mapviewer <image> [tile_size] [cache_dir]
+*/
+
+#define WINDOW_W 1280
+#define WINDOW_H 800
+#define PAN_STEP 64.0f
+
+typedef struct {
+    fVector position;
+    float zoom;
+} view;
+
+void mouse_eventhandler(MouseEvent* me, void* data){
+    view* v = (view*) data;
+    if (me->type == MOVEMENT && me->move.button_state != 0){
+        v->position.x -= me->move.xrel / v->zoom;
+        v->position.y -= me->move.yrel / v->zoom;
+    } else if (me->type == WHEEL){
+        v->zoom *= me->wheel.Y_vertical > 0 ? 1.25f : 0.8f;
+        if (v->zoom < 0.01f) v->zoom = 0.01f;
+        if (v->zoom > 32.0f) v->zoom = 32.0f;
+    }
+}
+
+void keyboard_eventhandler(KeyboardEvent* ke, void* data){
+    view* v = (view*) data;
+    if (ke->state != PRESSED) return;
+    float step = PAN_STEP / v->zoom;
+    switch (ke->keycode){
+        case KEYCODE_ARROW_LEFT: v->position.x -= step; break;
+        case KEYCODE_ARROW_RIGHT: v->position.x += step; break;
+        case KEYCODE_ARROW_UP: v->position.y -= step; break;
+        case KEYCODE_ARROW_DOWN: v->position.y += step; break;
+        default: break;
+    }
+}
+
+int main(int argc, char** argv){
+    if (argc < 2){
+        fprintf(stderr, "usage: %s image [tile_size] [cache_dir]\n", argv[0]);
+        return 1;
+    }
+    if (S2D_initialize() != 0 || S2D_createWindow("Map viewer", WINDOW_W, WINDOW_H) != 0) return 1;
+    if (argc > 3 && S2D_setTextureCache(argv[3]) != 0) return 1;
+
+    Texture map;
+    Uint64 start = S2D_getTimeNs();
+    if (S2D_createTiledTexture(argv[1], argc > 2 ? atoi(argv[2]) : 0, &map) != 0){
+        fprintf(stderr, "can not load %s\n", argv[1]);
+        return 1;
+    }
+    printf("%dx%d image loaded in %.0f ms\n", map.width, map.height, (S2D_getTimeNs() - start) / 1e6);
+
+    view v = {{map.width / 2.0f, map.height / 2.0f}, 1.0f};
+    S2D_addMouseEventHandler(mouse_eventhandler);
+    S2D_addKeyboardEventhandler(keyboard_eventhandler);
+    Rectangle rect = {{0, 0}, map.width, map.height};
+    int frame = 0;
+    while (TRUE){
+        S2D_eventDequeue(&v);
+        S2D_setCamera(v.position, v.zoom, 0);
+        S2D_setDrawColor(0xFF202020);
+        S2D_clearScreen();
+        S2D_drawTexture(&map, &rect);
+        S2D_presentRender();
+        if (++frame % 120 == 0) printf("zoom %.2f, %d tiles resident\n", v.zoom, S2D_getTiledTextureResidentTiles(&map));
+    }
+    S2D_destroyTexture(&map);
+    return 0;
+}
@@ -14,6 +14,7 @@
 #define SNAKE_COLOR (DRAW_COLOR_GREEN)
 #define TEXTURE_PATH_FROM_ROOT_DIR "sampleprograms/snake/pixilapple.png"
 #define FONT_PATH_FROM_ROOT_DIR "sampleprograms/snake/font.ttf"
+#define ASSET_PACK_PATH "snake.pak"
 #define BACKGROUND_COLOR 0xFFC0C0C0
 #define MOVEMENT_INTERVAL_MS (8*16)
 #define RERENDER_INTERVAL_MS (16)
@@ -143,20 +144,20 @@ int init_apple(apple* a){
     return retcode;
 }
 
-void drawSnake(snake* s){
+// tiles are queued with fills below outlines, so the whole body is drawn with two SDL calls
+void drawSnake(snake* s, S2D_RenderQueue* q){
         int i = 0;
         Rectangle rect;
         rect.w = TILE_WIDTH, rect.h = TILE_HEIGHT;
-        Color copy = snakeRGBA;
+        Uint32 snakeColor = S2D_colorStructToHex(snakeRGBA);
         while (i < s->tileCount){
             rect.origin.x = s->positions[i][X];
             rect.origin.y = s->positions[i][Y];
-            S2D_setDrawColor(S2D_colorStructToHex(snakeRGBA));
-            S2D_fillRectangle(&rect);
-            S2D_setDrawColor(DRAW_COLOR_BLACK);
-            S2D_drawRectangle(&rect);
+            S2D_queueFillRectangle(q, 0, 0, &rect, snakeColor);
+            S2D_queueDrawRectangle(q, 0, 1, &rect, DRAW_COLOR_BLACK);
             i++;
         }
+        S2D_flushRenderQueue(q);
         if(alterColors){
             snakeRGBA.R = (snakeRGBA.R + 1)%255;
             alterColors = FALSE;
@@ -245,11 +246,10 @@ void createScoreTexture(int font_size, Color fcolor){
     sd.font_fpath = FONT_PATH_FROM_ROOT_DIR;
     sd.font_size = font_size;
     sd.foreground_color = fcolor;
-    sd.string = malloc(20*sizeof(char));
+    sd.string = S2D_frameAlloc(20*sizeof(char), 1);
     sprintf(sd.string, "SCORE: %d ", g_score);
     if(g_cond_texture_created) S2D_destroyTexture(&g_scoreTexture);
     S2D_createUTF8Texture(&g_scoreTexture, &sd);
-    free(sd.string);
 }
 
 Texture* createGameOverTexture(int font_size, Color color, char* game_over_msg){
@@ -263,10 +263,31 @@ Texture* createGameOverTexture(int font_size, Color color, char* game_over_msg){
     return txt;
 }
 
-int main (){
-    srand(time(NULL));
+int main (int argc, char **argv){
+    // --record FILE plays and records a game, --replay FILE or --replay-headless FILE plays it back,
+    // --golden DIR compares every frame with the images in DIR, written there by the first run.
+    // Recorded games use a fixed seed so the apples land on the same tiles again.
+    unsigned int seed = time(NULL);
+    const char* golden_dir = NULL;
+    for (int i = 1; i + 1 < argc; i += 2){
+        if (strcmp(argv[i], "--record") == 0){
+            seed = 1;
+            S2D_startInputRecording(argv[i + 1]);
+        } else if (strcmp(argv[i], "--replay") == 0){
+            seed = 1;
+            S2D_replayInput(argv[i + 1], REPLAY_REALTIME);
+        } else if (strcmp(argv[i], "--replay-headless") == 0){
+            seed = 1;
+            S2D_replayInput(argv[i + 1], REPLAY_HEADLESS);
+        } else if (strcmp(argv[i], "--golden") == 0){
+            golden_dir = argv[i + 1];
+        }
+    }
+    srand(seed);
     S2D_initialize();
     S2D_createWindow("Snake", WINDOW_W, WINDOW_H);
+    // the assets load from the pack when one was built, from their files otherwise
+    S2D_mountPack(ASSET_PACK_PATH);
     S2D_addKeyboardEventhandler(keyboard_eventhandler);
     S2D_setDrawColor(BACKGROUND_COLOR);
     S2D_clearScreen();
@@ -281,8 +302,6 @@ int main (){
     
     Uint32 ticks_init = S2D_getTicks();
     Uint32 ticks_curr;
-    Uint32 prev_frame_ticker = ticks_curr;
-    Uint32 curr_frame_ticker = ticks_curr;
     bool collisionState = FALSE;
     int prevScore = g_score;
     g_game_state = GAME_ON; 
@@ -290,6 +309,10 @@ int main (){
     Rectangle game_over_dims = {.origin={WINDOW_W/4, WINDOW_H/4}, .w = 4*gameover_txt->width, .h = 4*gameover_txt->height};
     createScoreTexture(20, (Color){0,0,255,255});
     int tile_appends = 1;
+    S2D_RenderQueue* snakeQueue = S2D_createRenderQueue();
+    // frame time percentiles and frames over the render interval are printed at exit
+    S2D_startFrameProfiler(RERENDER_INTERVAL_MS * 1000000ull, NULL);
+    int golden_frame = 0;
 
     while(g_game_state == GAME_ON){
         S2D_eventDequeue(&s);
@@ -317,15 +340,10 @@ int main (){
                 tile_appends++;
         }
         
-        curr_frame_ticker = S2D_getTicks();
-        if (curr_frame_ticker - prev_frame_ticker >= RERENDER_INTERVAL_MS){
-            if(curr_frame_ticker - prev_frame_ticker > RERENDER_INTERVAL_MS) printf("\t----RERENDER MISS %d\n", curr_frame_ticker - prev_frame_ticker);
-            prev_frame_ticker = curr_frame_ticker;
-        }
         S2D_delay(1);
         S2D_setDrawColor(BACKGROUND_COLOR);
         S2D_clearScreen();
-        drawSnake(&s);
+        drawSnake(&s, snakeQueue);
         drawApple(&a);
         
         if (g_score != prevScore){
@@ -336,6 +354,15 @@ int main (){
         if(g_game_state == GAME_OVER){
             S2D_drawTexture(gameover_txt, &game_over_dims); 
         }
+        if (golden_dir != NULL){
+            char golden_path[512];
+            S2D_ImageDiff diff;
+            snprintf(golden_path, sizeof(golden_path), "%s/frame_%05d.png", golden_dir, golden_frame);
+            if (S2D_checkGoldenFrame(golden_path, NULL, &diff) == ERROR_IMAGE_MISMATCH){
+                printf("frame %d differs from %s in %llu pixels\n", golden_frame, golden_path, (unsigned long long) diff.differing);
+            }
+            golden_frame++;
+        }
      
         S2D_presentRender();
     }
@@ -347,9 +374,11 @@ int main (){
     S2D_destroyTexture(gameover_txt);
     S2D_destroyTexture(&g_scoreTexture);
     S2D_destroyTexture(&a.txt);
+    S2D_destroyRenderQueue(snakeQueue);
 
-    while(S2D_getTicks() < ticks_curr + LOOP_TICKS){
-        S2D_eventDequeue(NULL);
+    Uint32 now;
+    while((now = S2D_getTicks()) < ticks_curr + LOOP_TICKS){
+        S2D_waitEvents(ticks_curr + LOOP_TICKS - now, NULL);
     }
 
     return 0;
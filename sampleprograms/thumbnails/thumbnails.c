@@ -0,0 +1,87 @@
+#include "../../graphics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+/*
+    Parallel offscreen rendering, every thread draws thumbnails into its own offscreen context
+    and writes them as PPM images thumb_<n>.ppm to the working directory
+    usage: ./thumbnails <thread_count> <thumbnail_count>
+*/
+
+#define THUMB_W 256
+#define THUMB_H 256
+
+typedef struct {
+    int first;
+    int count;
+} ThreadData;
+
+static void drawThumbnail(S2D_Context* ctx, int n){
+    srand(n);
+    S2D_ctx_setDrawColor(ctx, 0xFF202020);
+    S2D_ctx_clearScreen(ctx);
+    S2D_ctx_setBlendMode(ctx, BLEND_ALPHA);
+    int petals = 3 + n % 9;
+    for (int i = 0; i < petals; i++){
+        float a = i * 2 * (float) M_PI / petals;
+        fVector c = {THUMB_W/2 + cosf(a) * 64, THUMB_H/2 + sinf(a) * 64};
+        S2D_ctx_setDrawColor(ctx, 0x80000000 | (rand() & 0xFFFFFF));
+        S2D_ctx_fillCircle(ctx, c, 48);
+    }
+    S2D_ctx_setDrawColor(ctx, DRAW_COLOR_WHITE);
+    S2D_ctx_drawCircle(ctx, (fVector){THUMB_W/2, THUMB_H/2}, 120, 3);
+}
+
+static int writePPM(const char* path, const RendererPixels* rpx){
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) return -1;
+    fprintf(f, "P6\n%d %d\n255\n", rpx->w, rpx->h);
+    for (int y = 0; y < rpx->h; y++){
+        const Uint8* row = (const Uint8*) rpx->pixelData + y * rpx->pitch;
+        for (int x = 0; x < rpx->w; x++) fwrite(row + x * rpx->bytes_per_pixel, 1, 3, f);
+    }
+    return fclose(f);
+}
+
+void* renderProc(void* arg){
+    ThreadData* td = (ThreadData*) arg;
+    S2D_Context* ctx = S2D_createOffscreenContext(THUMB_W, THUMB_H);
+    if (ctx == NULL) return NULL;
+    Rectangle all = {{0, 0}, THUMB_W, THUMB_H};
+    char path[64];
+    for (int n = td->first; n < td->first + td->count; n++){
+        drawThumbnail(ctx, n);
+        RendererPixels rpx;
+        if (S2D_ctx_readRendererPixelData(ctx, &all, &rpx) != 0) break;
+        snprintf(path, sizeof(path), "thumb_%d.ppm", n);
+        writePPM(path, &rpx);
+        S2D_ctx_freeRendererPixelData(ctx, &rpx);
+        S2D_ctx_presentRender(ctx);
+    }
+    S2D_destroyContext(ctx);
+    return NULL;
+}
+
+int main(int argc, char** argv){
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int thumbnails = argc > 2 ? atoi(argv[2]) : 64;
+    if (threads <= 0 || thumbnails <= 0) return 1;
+    if (S2D_initialize() != 0) return 1;
+
+    pthread_t* ids = malloc(threads * sizeof(pthread_t));
+    ThreadData* data = malloc(threads * sizeof(ThreadData));
+    Uint32 start = S2D_getTicks();
+    for (int i = 0, first = 0; i < threads; i++){
+        int count = thumbnails / threads + (i < thumbnails % threads);
+        data[i] = (ThreadData){first, count};
+        first += count;
+        pthread_create(&ids[i], NULL, renderProc, &data[i]);
+    }
+    for (int i = 0; i < threads; i++) pthread_join(ids[i], NULL);
+    printf("%d thumbnails on %d threads in %u ms\n", thumbnails, threads, S2D_getTicks() - start);
+    free(ids);
+    free(data);
+    return 0;
+}
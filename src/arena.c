@@ -0,0 +1,105 @@
+#include "internal.h"
+
+/*
+    Per frame bump allocator
+
+    Each thread allocates from its own arena, so S2D_frameAlloc needs no locking. The arena of the thread
+    calling S2D_presentRender is reset there and only there, arenas of other threads are reset by their own
+    S2D_frameReset. A present never reclaims memory another thread may still be using, whichever context or
+    thread it presents. A frame that spills over several blocks has them replaced by a single block large
+    enough for the whole frame, so steady state frames allocate nothing from the heap.
+*/
+
+#define ARENA_BLOCK_SIZE (64*1024)
+#define ARENA_DEFAULT_ALIGN 16
+
+typedef struct arena_block {
+    struct arena_block* next;
+    size_t size;
+    size_t used;
+} arena_block;
+
+typedef struct {
+    arena_block* head;
+    size_t frame_total;
+} frame_arena;
+
+static _Thread_local frame_arena t_arena;
+SDL_atomic_t g_heap_allocs;
+
+// data starts after the header, rounded up so default alignment holds for the first allocation
+#define BLOCK_HEADER_SIZE ((sizeof(arena_block) + ARENA_DEFAULT_ALIGN - 1) & ~(size_t)(ARENA_DEFAULT_ALIGN - 1))
+
+static arena_block* block_new(size_t size){
+    if (size < ARENA_BLOCK_SIZE) size = ARENA_BLOCK_SIZE;
+    arena_block* b = malloc(BLOCK_HEADER_SIZE + size);
+    if (b == NULL) return NULL;
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    b->next = NULL;
+    b->size = size;
+    b->used = 0;
+    return b;
+}
+
+static void arena_free_blocks(frame_arena* a){
+    arena_block* b = a->head;
+    while (b != NULL){
+        arena_block* next = b->next;
+        free(b);
+        b = next;
+    }
+    a->head = NULL;
+}
+
+static void arena_reset(frame_arena* a){
+    if (a->head != NULL && a->head->next != NULL){
+        size_t total = a->frame_total;
+        arena_free_blocks(a);
+        a->head = block_new(total);
+    } else if (a->head != NULL){
+        a->head->used = 0;
+    }
+    a->frame_total = 0;
+}
+
+void* S2D_frameAlloc(size_t size, size_t align){
+    frame_arena* a = &t_arena;
+    if (align == 0) align = ARENA_DEFAULT_ALIGN;
+    if ((align & (align - 1)) != 0) return NULL;
+
+    arena_block* b = a->head;
+    if (b != NULL){
+        Uint8* base = (Uint8*) b + BLOCK_HEADER_SIZE;
+        size_t offset = ((uintptr_t)(base + b->used) + align - 1) & ~(uintptr_t)(align - 1);
+        offset -= (uintptr_t) base;
+        if (offset + size <= b->size){
+            a->frame_total += offset + size - b->used;
+            b->used = offset + size;
+            return base + offset;
+        }
+    }
+
+    b = block_new(size + align);
+    if (b == NULL) return NULL;
+    b->next = a->head;
+    a->head = b;
+    Uint8* base = (Uint8*) b + BLOCK_HEADER_SIZE;
+    size_t offset = (((uintptr_t) base + align - 1) & ~(uintptr_t)(align - 1)) - (uintptr_t) base;
+    b->used = offset + size;
+    a->frame_total += b->used;
+    return base + offset;
+}
+
+void S2D_frameReset(){
+    arena_reset(&t_arena);
+}
+
+void S2D_frameArenaRelease(){
+    arena_free_blocks(&t_arena);
+    t_arena.frame_total = 0;
+}
+
+// called from S2D_presentRender, ends the frame of the presenting thread
+void frame_arena_advance(){
+    arena_reset(&t_arena);
+}
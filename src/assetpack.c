@@ -0,0 +1,115 @@
+#include "internal.h"
+
+/*
+    Asset pack, one file holding many assets built by tools/s2dpack.c
+    All integers are little endian.
+
+    header, 32 bytes:   magic "S2DPACK\0", Uint32 version, Uint32 slot_count (power of two),
+                        Uint32 entry_count, Uint32 reserved, Uint64 file_size
+    slots, 32 bytes:    Uint64 path_hash, Uint32 name_offset, Uint32 name_len, Uint64 data_offset, Uint64 data_size
+                        open addressing table indexed by path_hash, name_len 0 marks an empty slot
+    names and data:     offsets are from the start of the file, data is 16 byte aligned
+
+    Paths are hashed with 64 bit FNV-1a after normalizing: leading "./" removed, '\' turned into '/'.
+*/
+
+#define PACK_MAGIC "S2DPACK"
+#define PACK_VERSION 1
+#define PACK_HEADER_SIZE 32
+#define PACK_SLOT_SIZE 32
+
+typedef struct {
+    const Uint8* base;
+    size_t size;
+    Uint32 slot_count;
+} asset_pack;
+
+static asset_pack g_pack;
+
+static Uint32 read32(const Uint8* p){
+    return p[0] | p[1] << 8 | p[2] << 16 | (Uint32) p[3] << 24;
+}
+
+static Uint64 read64(const Uint8* p){
+    return read32(p) | (Uint64) read32(p + 4) << 32;
+}
+
+static const char* normalize_start(const char* path){
+    while (path[0] == '.' && (path[1] == '/' || path[1] == '\\')) path += 2;
+    return path;
+}
+
+static Uint64 path_hash(const char* path, size_t* len){
+    Uint64 h = 0xcbf29ce484222325ULL;
+    size_t n = 0;
+    for (; path[n] != '\0'; n++){
+        h ^= (Uint8)(path[n] == '\\' ? '/' : path[n]);
+        h *= 0x100000001b3ULL;
+    }
+    *len = n;
+    return h;
+}
+
+static bool path_equal(const char* path, const Uint8* name, size_t len){
+    for (size_t i = 0; i < len; i++){
+        char c = path[i] == '\\' ? '/' : path[i];
+        if (c != (char) name[i]) return FALSE;
+    }
+    return TRUE;
+}
+
+static void unmap_pack(){
+    unmap_file((void*) g_pack.base, g_pack.size);
+    g_pack = (asset_pack){0};
+}
+
+int S2D_mountPack(const char* path){
+    void* mapping;
+    size_t size;
+    if (map_file(path, FALSE, &mapping, &size) != 0) return ERROR_MOUNT_PACK;
+    const Uint8* base = mapping;
+
+    Uint32 slot_count = size >= PACK_HEADER_SIZE ? read32(base + 12) : 0;
+    bool valid = size >= PACK_HEADER_SIZE && SDL_memcmp(base, PACK_MAGIC, 8) == 0
+        && read32(base + 8) == PACK_VERSION && read64(base + 24) == size
+        && slot_count != 0 && (slot_count & (slot_count - 1)) == 0
+        && (size - PACK_HEADER_SIZE) / PACK_SLOT_SIZE >= slot_count;
+    unmap_pack();
+    g_pack = (asset_pack){.base = base, .size = size, .slot_count = slot_count};
+    if (!valid){
+        unmap_pack();
+        return ERROR_MOUNT_PACK;
+    }
+    return 0;
+}
+
+void S2D_unmountPack(){
+    unmap_pack();
+}
+
+const void* pack_find(const char* path, size_t* size){
+    if (g_pack.base == NULL || path == NULL) return NULL;
+    path = normalize_start(path);
+    size_t len;
+    Uint64 h = path_hash(path, &len);
+    Uint32 mask = g_pack.slot_count - 1;
+    for (Uint32 i = 0, s = (Uint32) h & mask; i < g_pack.slot_count; i++, s = (s + 1) & mask){
+        const Uint8* slot = g_pack.base + PACK_HEADER_SIZE + (size_t) s * PACK_SLOT_SIZE;
+        Uint32 name_len = read32(slot + 12);
+        if (name_len == 0) return NULL;
+        if (read64(slot) != h || name_len != len) continue;
+        Uint64 name_off = read32(slot + 8), data_off = read64(slot + 16), data_size = read64(slot + 24);
+        if (name_off + name_len > g_pack.size || data_off > g_pack.size || data_size > g_pack.size - data_off) return NULL;
+        if (!path_equal(path, g_pack.base + name_off, len)) continue;
+        *size = (size_t) data_size;
+        return g_pack.base + data_off;
+    }
+    return NULL;
+}
+
+SDL_RWops* pack_open(const char* path){
+    size_t size;
+    const void* data = pack_find(path, &size);
+    if (data == NULL || size > SDL_MAX_SINT32) return NULL;
+    return SDL_RWFromConstMem(data, (int) size);
+}
@@ -0,0 +1,62 @@
+#include "internal.h"
+
+static int grow(void** buf, int* capacity, int needed, size_t elem_size){
+    if (needed <= *capacity) return 0;
+    int cap = *capacity > 0 ? *capacity : 256;
+    while (cap < needed) cap *= 2;
+    void* n = realloc(*buf, cap * elem_size);
+    if (n == NULL) return -1;
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    *buf = n;
+    *capacity = cap;
+    return 0;
+}
+
+int batch_reserve(batch_buffer* b, int vertices, int indices){
+    if (grow((void**) &b->vertices, &b->vertex_capacity, b->vertex_count + vertices, sizeof(SDL_Vertex)) != 0) return -1;
+    if (grow((void**) &b->indices, &b->index_capacity, b->index_count + indices, sizeof(int)) != 0) return -1;
+    return 0;
+}
+
+int batch_quad(batch_buffer* b, const SDL_FRect* dst, SDL_Color color, float u0, float v0, float u1, float v1){
+    if (batch_reserve(b, 4, 6) != 0) return -1;
+    SDL_Vertex* v = b->vertices + b->vertex_count;
+    int* i = b->indices + b->index_count;
+    int base = b->vertex_count;
+
+    v[0] = (SDL_Vertex){{dst->x, dst->y}, color, {u0, v0}};
+    v[1] = (SDL_Vertex){{dst->x + dst->w, dst->y}, color, {u1, v0}};
+    v[2] = (SDL_Vertex){{dst->x + dst->w, dst->y + dst->h}, color, {u1, v1}};
+    v[3] = (SDL_Vertex){{dst->x, dst->y + dst->h}, color, {u0, v1}};
+    i[0] = base, i[1] = base + 1, i[2] = base + 2;
+    i[3] = base, i[4] = base + 2, i[5] = base + 3;
+
+    b->vertex_count += 4;
+    b->index_count += 6;
+    return 0;
+}
+
+void batch_reset(batch_buffer* b){
+    b->vertex_count = 0;
+    b->index_count = 0;
+}
+
+// items: the number of draw items in the batch, for the frame counters
+int batch_submit(batch_buffer* b, SDL_Texture* texture, int items){
+    int retcode = 0;
+    if (b->index_count > 0){
+        retcode = render_geometry(texture, b->vertices, b->vertex_count, b->indices, b->index_count, items);
+    }
+    batch_reset(b);
+    return retcode;
+}
+
+// submits without camera transform or culling, for drawing into render target textures
+int batch_submit_raw(batch_buffer* b, SDL_Texture* texture){
+    int retcode = 0;
+    if (b->index_count > 0){
+        retcode = SDL_RenderGeometry(g_RENDERER, texture, b->vertices, b->vertex_count, b->indices, b->index_count);
+    }
+    batch_reset(b);
+    return retcode;
+}
@@ -0,0 +1,251 @@
+#include "internal.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+    Pixel blitters between the caller pixel formats
+
+    Every (source format, destination format, blend mode, scaling) combination is its own kernel,
+    generated from the per format LOAD/STORE macros and the per blend mode OP macros below, so the
+    inner loops have no format branches and the compiler sees the channel layout of both sides.
+    Formats without alpha load as opaque, A8 loads as white with alpha like expand_a8_to_rgba32.
+    A few hand written kernels registered in g_overrides replace the generated ones where SIMD
+    or a plain row copy is faster, blit_lookup prefers them.
+    Blending follows SDL: ALPHA is source over, ADD adds the color times source alpha, MOD multiplies
+    the colors, ADD and MOD keep the destination alpha.
+*/
+
+#define BLIT_ROWS_PER_CHUNK 64
+// blits smaller than this stay on the calling thread
+#define BLIT_PARALLEL_PIXELS (256 * 256)
+#define BLIT_FORMATS (PIXEL_FORMAT_A8 + 1)
+#define BLIT_MODES (BLEND_MOD + 1)
+
+typedef struct blit_job blit_job;
+typedef void (*blit_fn)(const blit_job* j, int y0, int y1);
+
+struct blit_job {
+    blit_fn fn;
+    const Uint8* src;
+    int src_pitch;
+    Uint8* dst;
+    int dst_pitch;
+    int w;
+    // 16.16 source position of the destination pixel centers, scaled kernels only
+    Uint32 start_x, step_x, start_y, step_y;
+};
+
+// exact rounding division of a product of two channels by 255
+#define DIV255(x) (((x) + 128 + (((x) + 128) >> 8)) >> 8)
+
+#define RGBA32_BPP 4
+#define RGBA32_LOAD(p, r, g, b, a) do { r = (p)[0]; g = (p)[1]; b = (p)[2]; a = (p)[3]; } while (0)
+#define RGBA32_STORE(p, r, g, b, a) do { (p)[0] = (Uint8)(r); (p)[1] = (Uint8)(g); (p)[2] = (Uint8)(b); (p)[3] = (Uint8)(a); } while (0)
+
+#define BGRA32_BPP 4
+#define BGRA32_LOAD(p, r, g, b, a) do { b = (p)[0]; g = (p)[1]; r = (p)[2]; a = (p)[3]; } while (0)
+#define BGRA32_STORE(p, r, g, b, a) do { (p)[0] = (Uint8)(b); (p)[1] = (Uint8)(g); (p)[2] = (Uint8)(r); (p)[3] = (Uint8)(a); } while (0)
+
+// native endian 0xAARRGGBB
+#define ARGB8888_BPP 4
+#define ARGB8888_LOAD(p, r, g, b, a) do { Uint32 v_; memcpy(&v_, (p), 4); \
+    a = v_ >> 24; r = (v_ >> 16) & 0xFF; g = (v_ >> 8) & 0xFF; b = v_ & 0xFF; } while (0)
+#define ARGB8888_STORE(p, r, g, b, a) do { Uint32 v_ = (Uint32)(a) << 24 | (Uint32)(r) << 16 | (Uint32)(g) << 8 | (Uint32)(b); \
+    memcpy((p), &v_, 4); } while (0)
+
+#define RGB24_BPP 3
+#define RGB24_LOAD(p, r, g, b, a) do { r = (p)[0]; g = (p)[1]; b = (p)[2]; a = 255; } while (0)
+#define RGB24_STORE(p, r, g, b, a) do { (void)(a); (p)[0] = (Uint8)(r); (p)[1] = (Uint8)(g); (p)[2] = (Uint8)(b); } while (0)
+
+// native endian, the low bits are replicated when expanding to 8 bits
+#define RGB565_BPP 2
+#define RGB565_LOAD(p, r, g, b, a) do { Uint16 v_; memcpy(&v_, (p), 2); \
+    r = (v_ >> 11) << 3 | (v_ >> 13); g = ((v_ >> 5) & 0x3F) << 2 | ((v_ >> 9) & 0x3); \
+    b = (v_ & 0x1F) << 3 | ((v_ >> 2) & 0x7); a = 255; } while (0)
+#define RGB565_STORE(p, r, g, b, a) do { (void)(a); Uint16 v_ = (Uint16)(((r) & 0xF8) << 8 | ((g) & 0xFC) << 3 | (b) >> 3); \
+    memcpy((p), &v_, 2); } while (0)
+
+#define A8_BPP 1
+#define A8_LOAD(p, r, g, b, a) do { r = g = b = 255; a = (p)[0]; } while (0)
+#define A8_STORE(p, r, g, b, a) do { (void)(r); (void)(g); (void)(b); (p)[0] = (Uint8)(a); } while (0)
+
+#define OP_NONE(DST, p, r, g, b, a) DST##_STORE(p, r, g, b, a)
+
+#define OP_ALPHA(DST, p, r, g, b, a) do { \
+    if (a == 255) DST##_STORE(p, r, g, b, a); \
+    else if (a != 0){ \
+        Uint32 dr_, dg_, db_, da_, ia_ = 255 - a; \
+        DST##_LOAD(p, dr_, dg_, db_, da_); \
+        DST##_STORE(p, DIV255(r * a + dr_ * ia_), DIV255(g * a + dg_ * ia_), DIV255(b * a + db_ * ia_), a + DIV255(da_ * ia_)); \
+    } \
+} while (0)
+
+#define OP_ADD(DST, p, r, g, b, a) do { \
+    Uint32 dr_, dg_, db_, da_; \
+    DST##_LOAD(p, dr_, dg_, db_, da_); \
+    dr_ += DIV255(r * a), dg_ += DIV255(g * a), db_ += DIV255(b * a); \
+    DST##_STORE(p, SDL_min(dr_, 255), SDL_min(dg_, 255), SDL_min(db_, 255), da_); \
+} while (0)
+
+#define OP_MOD(DST, p, r, g, b, a) do { \
+    Uint32 dr_, dg_, db_, da_; \
+    (void)(a); \
+    DST##_LOAD(p, dr_, dg_, db_, da_); \
+    DST##_STORE(p, DIV255(r * dr_), DIV255(g * dg_), DIV255(b * db_), da_); \
+} while (0)
+
+#define BLIT_NAME(SRC, DST, MODE, SCALED) blit_##SRC##_##DST##_##MODE##_##SCALED
+
+#define DEFINE_BLIT(SRC, DST, MODE, SCALED) \
+static void BLIT_NAME(SRC, DST, MODE, SCALED)(const blit_job* j, int y0, int y1){ \
+    for (int y = y0; y < y1; y++){ \
+        int sy = SCALED ? (int)((j->start_y + (Uint32) y * j->step_y) >> 16) : y; \
+        const Uint8* s = j->src + (size_t) sy * j->src_pitch; \
+        Uint8* d = j->dst + (size_t) y * j->dst_pitch; \
+        Uint32 sx = j->start_x; \
+        for (int x = 0; x < j->w; x++){ \
+            const Uint8* sp = s + (size_t)(SCALED ? (int)(sx >> 16) : x) * SRC##_BPP; \
+            Uint8* dp = d + (size_t) x * DST##_BPP; \
+            Uint32 r, g, b, a; \
+            SRC##_LOAD(sp, r, g, b, a); \
+            OP_##MODE(DST, dp, r, g, b, a); \
+            if (SCALED) sx += j->step_x; \
+        } \
+    } \
+}
+
+#define BLIT_TABLE_ENTRY(SRC, DST, MODE, SCALED) \
+    [PIXEL_FORMAT_##SRC][PIXEL_FORMAT_##DST][BLEND_##MODE][SCALED] = BLIT_NAME(SRC, DST, MODE, SCALED),
+
+#define BLIT_MODES_OF(M, SRC, DST) \
+    M(SRC, DST, NONE, 0) M(SRC, DST, NONE, 1) M(SRC, DST, ALPHA, 0) M(SRC, DST, ALPHA, 1) \
+    M(SRC, DST, ADD, 0) M(SRC, DST, ADD, 1) M(SRC, DST, MOD, 0) M(SRC, DST, MOD, 1)
+
+#define BLIT_DESTINATIONS_OF(M, SRC) \
+    BLIT_MODES_OF(M, SRC, RGBA32) BLIT_MODES_OF(M, SRC, BGRA32) BLIT_MODES_OF(M, SRC, ARGB8888) \
+    BLIT_MODES_OF(M, SRC, RGB24) BLIT_MODES_OF(M, SRC, RGB565) BLIT_MODES_OF(M, SRC, A8)
+
+#define BLIT_ALL(M) \
+    BLIT_DESTINATIONS_OF(M, RGBA32) BLIT_DESTINATIONS_OF(M, BGRA32) BLIT_DESTINATIONS_OF(M, ARGB8888) \
+    BLIT_DESTINATIONS_OF(M, RGB24) BLIT_DESTINATIONS_OF(M, RGB565) BLIT_DESTINATIONS_OF(M, A8)
+
+BLIT_ALL(DEFINE_BLIT)
+
+static const blit_fn g_kernels[BLIT_FORMATS][BLIT_FORMATS][BLIT_MODES][2] = {
+    BLIT_ALL(BLIT_TABLE_ENTRY)
+};
+
+
+// hand written kernels, unscaled only
+
+static const int g_bytes_per_pixel[BLIT_FORMATS] = {
+    [PIXEL_FORMAT_RGBA32] = 4, [PIXEL_FORMAT_BGRA32] = 4, [PIXEL_FORMAT_ARGB8888] = 4,
+    [PIXEL_FORMAT_RGB24] = 3, [PIXEL_FORMAT_RGB565] = 2, [PIXEL_FORMAT_A8] = 1
+};
+
+#define DEFINE_COPY(FMT) \
+static void copy_##FMT(const blit_job* j, int y0, int y1){ \
+    for (int y = y0; y < y1; y++) \
+        memcpy(j->dst + (size_t) y * j->dst_pitch, j->src + (size_t) y * j->src_pitch, (size_t) j->w * FMT##_BPP); \
+}
+DEFINE_COPY(RGBA32)
+DEFINE_COPY(BGRA32)
+DEFINE_COPY(ARGB8888)
+DEFINE_COPY(RGB24)
+DEFINE_COPY(RGB565)
+DEFINE_COPY(A8)
+
+// swaps the first and third byte of every pixel, RGBA32 to BGRA32 and back
+static void swap_red_blue(const blit_job* j, int y0, int y1){
+    for (int y = y0; y < y1; y++){
+        const Uint8* s = j->src + (size_t) y * j->src_pitch;
+        Uint8* d = j->dst + (size_t) y * j->dst_pitch;
+        int x = 0;
+#ifdef __SSE2__
+        __m128i keep = _mm_set1_epi32((int) 0xFF00FF00), low = _mm_set1_epi32(0xFF);
+        for (; x + 4 <= j->w; x += 4){
+            __m128i p = _mm_loadu_si128((const __m128i*)(s + 4*x));
+            __m128i swapped = _mm_or_si128(_mm_and_si128(p, keep),
+                _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low), _mm_slli_epi32(_mm_and_si128(p, low), 16)));
+            _mm_storeu_si128((__m128i*)(d + 4*x), swapped);
+        }
+#endif
+        for (; x < j->w; x++){
+            d[4*x] = s[4*x + 2], d[4*x + 1] = s[4*x + 1], d[4*x + 2] = s[4*x], d[4*x + 3] = s[4*x + 3];
+        }
+    }
+}
+
+static void rgba32_to_rgb565(const blit_job* j, int y0, int y1){
+    convert_rgba32_to_rgb565(j->src + (size_t) y0 * j->src_pitch, j->src_pitch, j->dst + (size_t) y0 * j->dst_pitch, j->dst_pitch, j->w, y1 - y0);
+}
+
+static void rgba32_to_a8(const blit_job* j, int y0, int y1){
+    convert_rgba32_to_a8(j->src + (size_t) y0 * j->src_pitch, j->src_pitch, j->dst + (size_t) y0 * j->dst_pitch, j->dst_pitch, j->w, y1 - y0);
+}
+
+typedef struct {
+    PixelFormat src, dst;
+    BlendMode mode;
+    blit_fn fn;
+} blit_override;
+
+static const blit_override g_overrides[] = {
+    {PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGBA32, BLEND_NONE, copy_RGBA32},
+    {PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRA32, BLEND_NONE, copy_BGRA32},
+    {PIXEL_FORMAT_ARGB8888, PIXEL_FORMAT_ARGB8888, BLEND_NONE, copy_ARGB8888},
+    {PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB24, BLEND_NONE, copy_RGB24},
+    {PIXEL_FORMAT_RGB565, PIXEL_FORMAT_RGB565, BLEND_NONE, copy_RGB565},
+    {PIXEL_FORMAT_A8, PIXEL_FORMAT_A8, BLEND_NONE, copy_A8},
+    {PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_BGRA32, BLEND_NONE, swap_red_blue},
+    {PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBA32, BLEND_NONE, swap_red_blue},
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    // the same memory layout as BGRA32
+    {PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_ARGB8888, BLEND_NONE, swap_red_blue},
+    {PIXEL_FORMAT_ARGB8888, PIXEL_FORMAT_RGBA32, BLEND_NONE, swap_red_blue},
+    {PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_ARGB8888, BLEND_NONE, copy_BGRA32},
+    {PIXEL_FORMAT_ARGB8888, PIXEL_FORMAT_BGRA32, BLEND_NONE, copy_BGRA32},
+#endif
+    {PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGB565, BLEND_NONE, rgba32_to_rgb565},
+    {PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_A8, BLEND_NONE, rgba32_to_a8},
+};
+
+static blit_fn blit_lookup(PixelFormat src, PixelFormat dst, BlendMode mode, bool scaled){
+    if (!scaled){
+        for (size_t i = 0; i < SDL_arraysize(g_overrides); i++){
+            const blit_override* o = &g_overrides[i];
+            if (o->src == src && o->dst == dst && o->mode == mode) return o->fn;
+        }
+    }
+    return g_kernels[src][dst][mode][scaled ? 1 : 0];
+}
+
+static void blit_rows(int begin, int end, void* arg){
+    blit_job* job = arg;
+    job->fn(job, begin, end);
+}
+
+int S2D_blitPixels(const void* src, int src_w, int src_h, int src_pitch, PixelFormat src_format,
+                   void* dst, int dst_w, int dst_h, int dst_pitch, PixelFormat dst_format, BlendMode mode){
+    if (src == NULL || dst == NULL || src_format < 0 || src_format >= BLIT_FORMATS || dst_format < 0 || dst_format >= BLIT_FORMATS
+        || mode < 0 || mode >= BLIT_MODES || src_w <= 0 || src_h <= 0 || dst_w <= 0 || dst_h <= 0
+        || src_w > 0xFFFF || src_h > 0xFFFF || src_pitch < src_w * g_bytes_per_pixel[src_format] || dst_pitch < dst_w * g_bytes_per_pixel[dst_format]){
+        return ERROR_BLIT;
+    }
+    TRACE_BEGIN("S2D_blitPixels");
+    bool scaled = src_w != dst_w || src_h != dst_h;
+    blit_job job = {blit_lookup(src_format, dst_format, mode, scaled), src, src_pitch, dst, dst_pitch, dst_w};
+    if (scaled){
+        // nearest neighbour, sampled at the destination pixel centers
+        job.step_x = (Uint32)(((Uint64) src_w << 16) / dst_w);
+        job.step_y = (Uint32)(((Uint64) src_h << 16) / dst_h);
+        job.start_x = job.step_x / 2;
+        job.start_y = job.step_y / 2;
+    }
+    if ((Sint64) dst_w * dst_h < BLIT_PARALLEL_PIXELS) job.fn(&job, 0, dst_h);
+    else parallel_for(dst_h, BLIT_ROWS_PER_CHUNK, blit_rows, &job);
+    TRACE_END();
+    return 0;
+}
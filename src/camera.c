@@ -0,0 +1,243 @@
+#include "internal.h"
+
+/*
+    Camera transform and culling
+
+    Every draw call passes through the render_* functions below. They reject draws whose bounds lie
+    completely outside the visible region before any SDL call, apply the camera transform if a camera
+    is set and keep the per frame submission counters.
+    Without a camera, coordinates are screen coordinates and the visible region is the window.
+*/
+
+#define g_camera (current_context()->camera)
+#define g_last_frame_stats (current_context()->last_frame_stats)
+
+static inline SDL_FPoint to_screen(float x, float y){
+    float dx = x - g_camera.x, dy = y - g_camera.y;
+    SDL_FPoint p = {
+        g_camera.center_x + g_camera.zoom * (g_camera.cos_r*dx + g_camera.sin_r*dy),
+        g_camera.center_y + g_camera.zoom * (g_camera.cos_r*dy - g_camera.sin_r*dx)
+    };
+    return p;
+}
+
+static inline SDL_FPoint to_world(float x, float y){
+    float dx = (x - g_camera.center_x) / g_camera.zoom, dy = (y - g_camera.center_y) / g_camera.zoom;
+    SDL_FPoint p = {g_camera.x + g_camera.cos_r*dx - g_camera.sin_r*dy, g_camera.y + g_camera.sin_r*dx + g_camera.cos_r*dy};
+    return p;
+}
+
+void camera_update(){
+    float w = g_drawstate.draw_w / g_camera.scale_x, h = g_drawstate.draw_h / g_camera.scale_y;
+    g_camera.center_x = w / 2, g_camera.center_y = h / 2;
+    if (!g_camera.enabled){
+        g_camera.view_x0 = 0, g_camera.view_y0 = 0;
+        g_camera.view_x1 = w, g_camera.view_y1 = h;
+        return;
+    }
+    SDL_FPoint corners[4] = {to_world(0, 0), to_world(w, 0), to_world(w, h), to_world(0, h)};
+    g_camera.view_x0 = g_camera.view_x1 = corners[0].x;
+    g_camera.view_y0 = g_camera.view_y1 = corners[0].y;
+    for (int i = 1; i < 4; i++){
+        g_camera.view_x0 = SDL_min(g_camera.view_x0, corners[i].x);
+        g_camera.view_x1 = SDL_max(g_camera.view_x1, corners[i].x);
+        g_camera.view_y0 = SDL_min(g_camera.view_y0, corners[i].y);
+        g_camera.view_y1 = SDL_max(g_camera.view_y1, corners[i].y);
+    }
+}
+
+void S2D_setCamera(fVector position, float zoom, float rotation){
+    g_camera.enabled = TRUE;
+    g_camera.x = position.x, g_camera.y = position.y;
+    g_camera.zoom = zoom > 0 ? zoom : 1.0f;
+    g_camera.rotation = rotation;
+    float rad = rotation * (float) M_PI / 180.0f;
+    g_camera.cos_r = SDL_cosf(rad), g_camera.sin_r = SDL_sinf(rad);
+    camera_update();
+}
+
+void S2D_resetCamera(){
+    g_camera.enabled = FALSE;
+    g_camera.x = 0, g_camera.y = 0;
+    g_camera.zoom = 1.0f, g_camera.rotation = 0;
+    g_camera.cos_r = 1.0f, g_camera.sin_r = 0;
+    camera_update();
+}
+
+fVector S2D_screenToWorld(fVector screen){
+    if (!g_camera.enabled) return screen;
+    SDL_FPoint p = to_world(screen.x, screen.y);
+    return (fVector){p.x, p.y};
+}
+
+fVector S2D_worldToScreen(fVector world){
+    if (!g_camera.enabled) return world;
+    SDL_FPoint p = to_screen(world.x, world.y);
+    return (fVector){p.x, p.y};
+}
+
+void camera_view_bounds(float* x0, float* y0, float* x1, float* y1){
+    *x0 = g_camera.view_x0, *y0 = g_camera.view_y0;
+    *x1 = g_camera.view_x1, *y1 = g_camera.view_y1;
+}
+
+float camera_pixel_scale(){
+    return (g_camera.enabled ? g_camera.zoom : 1.0f) * SDL_max(g_camera.scale_x, g_camera.scale_y) * g_camera.res_scale;
+}
+
+void camera_screen_axes(fVector* unit_x, fVector* unit_y){
+    if (!g_camera.enabled){
+        *unit_x = (fVector){1, 0}, *unit_y = (fVector){0, 1};
+        return;
+    }
+    float s = 1.0f / g_camera.zoom;
+    *unit_x = (fVector){g_camera.cos_r * s, g_camera.sin_r * s};
+    *unit_y = (fVector){-g_camera.sin_r * s, g_camera.cos_r * s};
+}
+
+S2D_FrameStats S2D_getFrameStats(){
+    return g_last_frame_stats;
+}
+
+void frame_stats_rollover(){
+    g_frame_stats.heap_allocs = SDL_AtomicSet(&g_heap_allocs, 0);
+    g_last_frame_stats = g_frame_stats;
+    memset(&g_frame_stats, 0, sizeof(S2D_FrameStats));
+    current_context()->frame++;
+}
+
+bool camera_cull(float x0, float y0, float x1, float y1){
+    if (x1 < g_camera.view_x0 || x0 > g_camera.view_x1 || y1 < g_camera.view_y0 || y0 > g_camera.view_y1){
+        g_frame_stats.culled++;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static inline bool is_rotated(){
+    return g_camera.enabled && g_camera.rotation != 0;
+}
+
+static inline SDL_FRect rect_to_screen(const SDL_FRect* r){
+    SDL_FPoint o = to_screen(r->x, r->y);
+    SDL_FRect s = {o.x, o.y, r->w * g_camera.zoom, r->h * g_camera.zoom};
+    return s;
+}
+
+// rectangles under a rotated camera become quads, filled as triangles or outlined as a closed line strip
+static int render_rotated_rect(const SDL_FRect* r, bool fill){
+    SDL_FPoint c[5] = {to_screen(r->x, r->y), to_screen(r->x + r->w, r->y), to_screen(r->x + r->w, r->y + r->h), to_screen(r->x, r->y + r->h)};
+    c[4] = c[0];
+    g_frame_stats.draw_calls++;
+    if (!fill) return rt_points(c, NULL, 5, TRUE);
+
+    SDL_Color color = color_SDL2(g_drawstate.draw_color);
+    SDL_Vertex v[4];
+    for (int i = 0; i < 4; i++) v[i] = (SDL_Vertex){c[i], color, {0, 0}};
+    int idx[6] = {0, 1, 2, 0, 2, 3};
+    return rt_geometry(NULL, v, 4, idx, 6);
+}
+
+int render_rect(const SDL_FRect* r, bool fill){
+    if (camera_cull(r->x, r->y, r->x + r->w, r->y + r->h)) return 0;
+    g_frame_stats.submitted++;
+    if (is_rotated()) return render_rotated_rect(r, fill);
+    g_frame_stats.draw_calls++;
+    if (!g_camera.enabled) return rt_rects(r, NULL, 1, fill);
+    SDL_FRect s = rect_to_screen(r);
+    return rt_rects(&s, NULL, 1, fill);
+}
+
+int render_rects(const SDL_FRect* frects, const SDL_Rect* rects, int n, bool fill){
+    // without a camera arrays go to SDL unchanged, which clips them itself
+    if (!g_camera.enabled){
+        g_frame_stats.submitted += n;
+        g_frame_stats.draw_calls++;
+        return rt_rects(frects, rects, n, fill);
+    }
+
+    SDL_FRect* out = S2D_frameAlloc(n * sizeof(SDL_FRect), 0);
+    if (out == NULL) return -1;
+    int count = 0, retcode = 0;
+    for (int i = 0; i < n; i++){
+        SDL_FRect r = frects != NULL ? frects[i] : (SDL_FRect){rects[i].x, rects[i].y, rects[i].w, rects[i].h};
+        if (camera_cull(r.x, r.y, r.x + r.w, r.y + r.h)) continue;
+        g_frame_stats.submitted++;
+        if (is_rotated()){
+            if ((retcode = render_rotated_rect(&r, fill)) != 0) return retcode;
+        } else {
+            out[count++] = rect_to_screen(&r);
+        }
+    }
+    if (count == 0) return 0;
+    g_frame_stats.draw_calls++;
+    return rt_rects(out, NULL, count, fill);
+}
+
+int render_line(float x0, float y0, float x1, float y1){
+    if (camera_cull(SDL_min(x0, x1), SDL_min(y0, y1), SDL_max(x0, x1), SDL_max(y0, y1))) return 0;
+    g_frame_stats.submitted++;
+    g_frame_stats.draw_calls++;
+    SDL_FPoint p[2] = {{x0, y0}, {x1, y1}};
+    if (g_camera.enabled) p[0] = to_screen(x0, y0), p[1] = to_screen(x1, y1);
+    return rt_points(p, NULL, 2, TRUE);
+}
+
+// points and line strips, strip TRUE draws connected lines instead of points
+int render_points(const SDL_FPoint* fpoints, const SDL_Point* points, int n, bool strip){
+    g_frame_stats.draw_calls++;
+    if (!g_camera.enabled){
+        g_frame_stats.submitted += n;
+        return rt_points(fpoints, points, n, strip);
+    }
+
+    SDL_FPoint* out = S2D_frameAlloc(n * sizeof(SDL_FPoint), 0);
+    if (out == NULL) return -1;
+    int count = 0;
+    for (int i = 0; i < n; i++){
+        float x = fpoints != NULL ? fpoints[i].x : points[i].x;
+        float y = fpoints != NULL ? fpoints[i].y : points[i].y;
+        // strips keep every point so segments crossing the view stay connected
+        if (!strip && camera_cull(x, y, x, y)) continue;
+        out[count++] = to_screen(x, y);
+    }
+    g_frame_stats.submitted += count;
+    if (count == 0) return 0;
+    return rt_points(out, NULL, count, strip);
+}
+
+int render_copy(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect* dst){
+    if (camera_cull(dst->x, dst->y, dst->x + dst->w, dst->y + dst->h)) return 0;
+    g_frame_stats.submitted++;
+    g_frame_stats.draw_calls++;
+    if (!g_camera.enabled) return rt_copy(texture, src, dst, 0, NULL);
+    SDL_FRect s = rect_to_screen(dst);
+    if (!is_rotated()) return rt_copy(texture, src, &s, 0, NULL);
+    SDL_FPoint pivot = {0, 0};
+    return rt_copy(texture, src, &s, -g_camera.rotation, &pivot);
+}
+
+// vertices are transformed in place when a camera is set, callers pass scratch vertex data
+// items: the number of draw items the geometry was built from, for the frame counters
+int render_geometry(SDL_Texture* texture, SDL_Vertex* v, int nv, const int* idx, int ni, int items){
+    if (nv == 0) return 0;
+    float x0 = v[0].position.x, y0 = v[0].position.y, x1 = x0, y1 = y0;
+    for (int i = 1; i < nv; i++){
+        x0 = SDL_min(x0, v[i].position.x), x1 = SDL_max(x1, v[i].position.x);
+        y0 = SDL_min(y0, v[i].position.y), y1 = SDL_max(y1, v[i].position.y);
+    }
+    if (camera_cull(x0, y0, x1, y1)){
+        g_frame_stats.culled += items - 1;
+        return 0;
+    }
+    if (g_camera.enabled){
+        for (int i = 0; i < nv; i++) v[i].position = to_screen(v[i].position.x, v[i].position.y);
+    }
+    g_frame_stats.submitted += items;
+    g_frame_stats.draw_calls++;
+    return rt_geometry(texture, v, nv, idx, ni);
+}
+
+bool camera_enabled(){
+    return g_camera.enabled;
+}
@@ -0,0 +1,258 @@
+#include "internal.h"
+
+/*
+    Command lists
+
+    A command list is plain memory owned by the thread recording into it, recording takes no locks and
+    touches no renderer state, so any number of threads can record in parallel. The commands keep their
+    memory when a list is cleared, so recording does not allocate once a list has grown to its working size.
+    Submitting replays the lists in order on the thread owning the renderer. Consecutive filled rectangles,
+    circles, lines and textured quads of one texture become a single geometry batch, lines tessellated
+    into quads one draw unit wide on screen whatever the camera. Consecutive outlines and points of one
+    color become a single SDL call.
+*/
+
+typedef enum {CMD_COLOR, CMD_BLEND, CMD_CLIP, CMD_FILL_RECT, CMD_DRAW_RECT, CMD_LINE, CMD_POINT, CMD_FILL_CIRCLE, CMD_TEXTURE} command_type;
+
+typedef struct {
+    command_type type;
+    union {
+        Uint32 color;
+        BlendMode blend;
+        struct { bool enabled; SDL_Rect rect; } clip;
+        SDL_FRect rect;
+        struct { float x0, y0, x1, y1; } line;
+        SDL_FPoint point;
+        struct { fVector center; float radius; } circle;
+        struct { SDL_Texture* texture; SDL_FRect dst; float u0, v0, u1, v1; Uint32 tint; } quad;
+    };
+} command;
+
+struct S2D_CommandList {
+    command* cmds;
+    int count;
+    int capacity;
+};
+
+S2D_CommandList* S2D_createCommandList(){
+    return calloc(1, sizeof(S2D_CommandList));
+}
+
+void S2D_destroyCommandList(S2D_CommandList* list){
+    if (list == NULL) return;
+    free(list->cmds);
+    free(list);
+}
+
+void S2D_clearCommandList(S2D_CommandList* list){
+    list->count = 0;
+}
+
+static command* push(S2D_CommandList* list, command_type type){
+    if (list->count == list->capacity){
+        int cap = list->capacity > 0 ? list->capacity * 2 : 256;
+        command* n = realloc(list->cmds, cap * sizeof(command));
+        if (n == NULL) return NULL;
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+        list->cmds = n;
+        list->capacity = cap;
+    }
+    command* c = &list->cmds[list->count++];
+    c->type = type;
+    return c;
+}
+
+int S2D_cmdSetColor(S2D_CommandList* list, Uint32 rgba){
+    command* c = push(list, CMD_COLOR);
+    if (c == NULL) return ERROR_COMMAND_LIST;
+    c->color = rgba;
+    return 0;
+}
+
+int S2D_cmdSetBlendMode(S2D_CommandList* list, BlendMode mode){
+    command* c = push(list, CMD_BLEND);
+    if (c == NULL) return ERROR_COMMAND_LIST;
+    c->blend = mode;
+    return 0;
+}
+
+int S2D_cmdSetClip(S2D_CommandList* list, const Rectangle* clip){
+    command* c = push(list, CMD_CLIP);
+    if (c == NULL) return ERROR_COMMAND_LIST;
+    c->clip.enabled = clip != NULL;
+    if (clip != NULL) c->clip.rect = (SDL_Rect){clip->origin.x, clip->origin.y, clip->w, clip->h};
+    return 0;
+}
+
+static int push_rect(S2D_CommandList* list, command_type type, const fRectangle* rect){
+    command* c = push(list, type);
+    if (c == NULL) return ERROR_COMMAND_LIST;
+    c->rect = (SDL_FRect){rect->origin.x, rect->origin.y, rect->w, rect->h};
+    return 0;
+}
+
+int S2D_cmdFillRectangle(S2D_CommandList* list, const fRectangle* rect){
+    return push_rect(list, CMD_FILL_RECT, rect);
+}
+
+int S2D_cmdDrawRectangle(S2D_CommandList* list, const fRectangle* rect){
+    return push_rect(list, CMD_DRAW_RECT, rect);
+}
+
+int S2D_cmdDrawLine(S2D_CommandList* list, fVector c0, fVector c1){
+    command* c = push(list, CMD_LINE);
+    if (c == NULL) return ERROR_COMMAND_LIST;
+    c->line.x0 = c0.x, c->line.y0 = c0.y, c->line.x1 = c1.x, c->line.y1 = c1.y;
+    return 0;
+}
+
+int S2D_cmdDrawPoint(S2D_CommandList* list, fVector p){
+    command* c = push(list, CMD_POINT);
+    if (c == NULL) return ERROR_COMMAND_LIST;
+    c->point = (SDL_FPoint){p.x, p.y};
+    return 0;
+}
+
+int S2D_cmdFillCircle(S2D_CommandList* list, fVector center, float radius){
+    command* c = push(list, CMD_FILL_CIRCLE);
+    if (c == NULL) return ERROR_COMMAND_LIST;
+    c->circle.center = center;
+    c->circle.radius = radius;
+    return 0;
+}
+
+int S2D_cmdDrawTexture(S2D_CommandList* list, Texture* txt, const fRectangle* dst, const Rectangle* src, Uint32 tint){
+    // tiled textures have no single texture to record
+    if (txt->internal_ == NULL || ((internal_texture_data*) txt->internal_)->tiled != NULL) return ERROR_DRAW_TEXTURE;
+    command* c = push(list, CMD_TEXTURE);
+    if (c == NULL) return ERROR_COMMAND_LIST;
+    c->quad.texture = ((internal_texture_data*) txt->internal_)->texture;
+    c->quad.dst = (SDL_FRect){dst->origin.x, dst->origin.y, dst->w, dst->h};
+    c->quad.u0 = 0.0f, c->quad.v0 = 0.0f, c->quad.u1 = 1.0f, c->quad.v1 = 1.0f;
+    if (src != NULL){
+        c->quad.u0 = (float) src->origin.x / txt->width, c->quad.u1 = (float)(src->origin.x + src->w) / txt->width;
+        c->quad.v0 = (float) src->origin.y / txt->height, c->quad.v1 = (float)(src->origin.y + src->h) / txt->height;
+    }
+    c->quad.tint = tint;
+    return 0;
+}
+
+// replay state of one list, the open geometry batch is drawn with batch_texture
+typedef struct {
+    Uint32 color;
+    Uint32 sdl_color;
+    SDL_Texture* batch_texture;
+    int batch_items;
+    fVector unit_x, unit_y;     // screen axes in world units, lines stay one draw unit wide under the camera
+} replay_state;
+
+static int flush(replay_state* st){
+    if (st->batch_items == 0) return 0;
+    int retcode = batch_submit(&g_batch, st->batch_texture, st->batch_items);
+    st->batch_items = 0;
+    return retcode != 0 ? ERROR_COMMAND_LIST : 0;
+}
+
+static int sync_color(replay_state* st){
+    if (st->sdl_color == st->color) return 0;
+    Uint32 c = st->color;
+    if (rt_draw_color(c) != 0) return ERROR_SET_DRAW_COLOR;
+    st->sdl_color = c;
+    return 0;
+}
+
+// adds to the open batch, a batch of another texture is drawn first
+static int batch_for(replay_state* st, SDL_Texture* texture){
+    if (st->batch_items > 0 && st->batch_texture != texture){
+        int retcode = flush(st);
+        if (retcode != 0) return retcode;
+    }
+    st->batch_texture = texture;
+    st->batch_items++;
+    return 0;
+}
+
+// number of commands of the same type starting at i, they are drawn with one call
+static int run_length(const S2D_CommandList* list, int i){
+    int n = 1;
+    while (i + n < list->count && list->cmds[i + n].type == list->cmds[i].type) n++;
+    return n;
+}
+
+static int replay(const S2D_CommandList* list){
+    replay_state st = {.color = g_drawstate.draw_color, .sdl_color = g_drawstate.draw_color};
+    camera_screen_axes(&st.unit_x, &st.unit_y);
+    int retcode = 0;
+    for (int i = 0; i < list->count && retcode == 0; i++){
+        const command* c = &list->cmds[i];
+        switch (c->type){
+            case CMD_COLOR:
+                st.color = c->color;
+                break;
+            case CMD_BLEND:
+                if ((retcode = flush(&st)) == 0 && rt_blend_mode(c->blend) != 0) retcode = ERROR_SET_BLEND_MODE;
+                break;
+            case CMD_CLIP:
+                if ((retcode = flush(&st)) == 0 && rt_clip(c->clip.enabled ? &c->clip.rect : NULL) != 0) retcode = ERROR_COMMAND_LIST;
+                break;
+            case CMD_FILL_RECT:
+                if ((retcode = batch_for(&st, NULL)) == 0 && batch_quad(&g_batch, &c->rect, color_SDL2(st.color), 0.0f, 0.0f, 1.0f, 1.0f) != 0) retcode = ERROR_COMMAND_LIST;
+                break;
+            case CMD_FILL_CIRCLE:
+                if ((retcode = batch_for(&st, NULL)) == 0
+                    && tess_fill_ellipse(&g_batch, c->circle.center, c->circle.radius, c->circle.radius, color_SDL2(st.color)) != 0) retcode = ERROR_COMMAND_LIST;
+                break;
+            case CMD_TEXTURE:
+                if ((retcode = batch_for(&st, c->quad.texture)) == 0
+                    && batch_quad(&g_batch, &c->quad.dst, color_SDL2(c->quad.tint), c->quad.u0, c->quad.v0, c->quad.u1, c->quad.v1) != 0) retcode = ERROR_COMMAND_LIST;
+                break;
+            case CMD_LINE:
+                if ((retcode = batch_for(&st, NULL)) == 0
+                    && tess_line(&g_batch, (fVector){c->line.x0, c->line.y0}, (fVector){c->line.x1, c->line.y1}, st.unit_x, st.unit_y, color_SDL2(st.color)) != 0) retcode = ERROR_COMMAND_LIST;
+                break;
+            case CMD_DRAW_RECT:
+            case CMD_POINT: {
+                int n = run_length(list, i);
+                if ((retcode = flush(&st)) != 0 || (retcode = sync_color(&st)) != 0) break;
+                if (c->type == CMD_DRAW_RECT){
+                    SDL_FRect* rects = S2D_frameAlloc(n * sizeof(SDL_FRect), 0);
+                    if (rects == NULL){
+                        retcode = ERROR_COMMAND_LIST;
+                        break;
+                    }
+                    for (int k = 0; k < n; k++) rects[k] = c[k].rect;
+                    if (render_rects(rects, NULL, n, FALSE) != 0) retcode = ERROR_DRAW_RECT;
+                } else {
+                    SDL_FPoint* points = S2D_frameAlloc(n * sizeof(SDL_FPoint), 0);
+                    if (points == NULL){
+                        retcode = ERROR_COMMAND_LIST;
+                        break;
+                    }
+                    for (int k = 0; k < n; k++) points[k] = c[k].point;
+                    if (render_points(points, NULL, n, FALSE) != 0) retcode = ERROR_DRAW_POINT;
+                }
+                i += n - 1;
+                break;
+            }
+        }
+    }
+    int code = flush(&st);
+    batch_reset(&g_batch);
+    return retcode != 0 ? retcode : code;
+}
+
+int S2D_submitCommandLists(S2D_CommandList* const* lists, int n){
+    int retcode = 0;
+    TRACE_BEGIN("S2D_submitCommandLists");
+    for (int i = 0; i < n && retcode == 0; i++){
+        if (lists[i] == NULL) continue;
+        retcode = replay(lists[i]);
+        // every list starts from the draw state of the context, without clipping
+        Uint32 c = g_drawstate.draw_color;
+        rt_draw_color(c);
+        rt_blend_mode(g_drawstate.blend_mode);
+        rt_clip(NULL);
+    }
+    TRACE_END();
+    return retcode;
+}
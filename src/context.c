@@ -0,0 +1,175 @@
+#include "internal.h"
+
+S2D_Context g_default_context = {.camera = {.zoom = 1.0f, .cos_r = 1.0f, .scale_x = 1.0f, .scale_y = 1.0f, .res_scale = 1.0f}};
+_Thread_local S2D_Context* t_context;
+
+static S2D_Context* context_alloc(){
+    S2D_Context* ctx = calloc(1, sizeof(S2D_Context));
+    if (ctx == NULL) return NULL;
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    ctx->camera.zoom = 1.0f;
+    ctx->camera.cos_r = 1.0f;
+    ctx->camera.scale_x = ctx->camera.scale_y = 1.0f;
+    ctx->camera.res_scale = 1.0f;
+    // the quit handler installed by S2D_initialize applies to every context
+    ctx->evh.app_quit = g_default_context.evh.app_quit;
+    return ctx;
+}
+
+S2D_Context* S2D_defaultContext(){
+    return &g_default_context;
+}
+
+S2D_Context* S2D_setCurrentContext(S2D_Context* ctx){
+    S2D_Context* prev = current_context();
+    t_context = ctx;
+    return prev;
+}
+
+S2D_Context* S2D_createContext(const char* title, int w, int h){
+    S2D_Context* ctx = context_alloc();
+    if (ctx == NULL) return NULL;
+    S2D_Context* prev = S2D_setCurrentContext(ctx);
+    int code = S2D_createWindow(title, w, h);
+    S2D_setCurrentContext(prev);
+    if (code != 0){
+        S2D_destroyContext(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+S2D_Context* S2D_createOffscreenContext(int w, int h){
+    S2D_Context* ctx = context_alloc();
+    if (ctx == NULL) return NULL;
+    ctx->target = SDL_CreateRGBSurfaceWithFormat(0, w, h, SDL_BITSPERPIXEL(INTERNAL_PIXEL_FORMAT), INTERNAL_PIXEL_FORMAT);
+    ctx->renderer = ctx->target != NULL ? SDL_CreateSoftwareRenderer(ctx->target) : NULL;
+    if (ctx->renderer == NULL){
+        S2D_destroyContext(ctx);
+        return NULL;
+    }
+    ctx->drawstate.draw_w = w;
+    ctx->drawstate.draw_h = h;
+
+    S2D_Context* prev = S2D_setCurrentContext(ctx);
+    camera_update();
+    int code = S2D_setDrawColor(DRAW_COLOR_DEFAULT);
+    if (code == 0) code = S2D_setBlendMode(BLEND_NONE);
+    if (code == 0) code = S2D_clearScreen();
+    S2D_setCurrentContext(prev);
+    if (code != 0){
+        S2D_destroyContext(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void S2D_destroyContext(S2D_Context* ctx){
+    if (ctx == NULL || ctx == &g_default_context) return;
+    if (t_context == ctx) t_context = NULL;
+    rt_shutdown(ctx);
+    profiler_free(ctx);
+    internal_res_free(ctx);
+    if (ctx->renderer != NULL) SDL_DestroyRenderer(ctx->renderer);
+    if (ctx->window != NULL) SDL_DestroyWindow(ctx->window);
+    SDL_FreeSurface(ctx->target);
+    free(ctx->batch.vertices);
+    free(ctx->batch.indices);
+    while (ctx->free_texture_data != NULL){
+        texture_data_slot* next = ctx->free_texture_data->next;
+        free(ctx->free_texture_data);
+        ctx->free_texture_data = next;
+    }
+    free(ctx->readback_buffer);
+    free(ctx->upload_buffer);
+    free(ctx->polygon_scratch.indices);
+    free(ctx);
+}
+
+/*
+    S2D_ctx_* variants bind the context for the duration of the call,
+    the binding of the calling thread is restored afterwards
+*/
+#define CTX_CALL(type, call) { \
+    S2D_Context* prev = t_context; \
+    t_context = ctx; \
+    type ret = call; \
+    t_context = prev; \
+    return ret; \
+}
+
+#define CTX_CALL_VOID(call) { \
+    S2D_Context* prev = t_context; \
+    t_context = ctx; \
+    call; \
+    t_context = prev; \
+}
+
+int S2D_ctx_setDrawColor(S2D_Context* ctx, Uint32 rgba) CTX_CALL(int, S2D_setDrawColor(rgba))
+int S2D_ctx_setBlendMode(S2D_Context* ctx, BlendMode mode) CTX_CALL(int, S2D_setBlendMode(mode))
+int S2D_ctx_setRenderScale(S2D_Context* ctx, float x_scale, float y_scale) CTX_CALL(int, S2D_setRenderScale(x_scale, y_scale))
+Drawstate S2D_ctx_getDrawState(S2D_Context* ctx) CTX_CALL(Drawstate, S2D_getDrawState())
+int S2D_ctx_clearScreen(S2D_Context* ctx) CTX_CALL(int, S2D_clearScreen())
+int S2D_ctx_setThreadedRendering(S2D_Context* ctx, bool enabled, int frames_in_flight) CTX_CALL(int, S2D_setThreadedRendering(enabled, frames_in_flight))
+int S2D_ctx_setInternalResolution(S2D_Context* ctx, int w, int h, UpscaleFilter filter) CTX_CALL(int, S2D_setInternalResolution(w, h, filter))
+int S2D_ctx_setDynamicResolution(S2D_Context* ctx, Uint64 budget_ns, float min_scale) CTX_CALL(int, S2D_setDynamicResolution(budget_ns, min_scale))
+
+int S2D_ctx_drawPoint(S2D_Context* ctx, Vector c) CTX_CALL(int, S2D_drawPoint(c))
+int S2D_ctx_drawPointF(S2D_Context* ctx, fVector p) CTX_CALL(int, S2D_drawPointF(p))
+int S2D_ctx_drawPoints(S2D_Context* ctx, const Vector* points, int count) CTX_CALL(int, S2D_drawPoints(points, count))
+int S2D_ctx_drawPointsF(S2D_Context* ctx, const fVector* points, int count) CTX_CALL(int, S2D_drawPointsF(points, count))
+int S2D_ctx_drawLine(S2D_Context* ctx, Vector c0, Vector c1) CTX_CALL(int, S2D_drawLine(c0, c1))
+int S2D_ctx_drawLineF(S2D_Context* ctx, fVector c0, fVector c1) CTX_CALL(int, S2D_drawLineF(c0, c1))
+int S2D_ctx_drawRectangle(S2D_Context* ctx, const Rectangle* rect) CTX_CALL(int, S2D_drawRectangle(rect))
+int S2D_ctx_drawRectangleF(S2D_Context* ctx, const fRectangle* rect) CTX_CALL(int, S2D_drawRectangleF(rect))
+int S2D_ctx_fillRectangle(S2D_Context* ctx, const Rectangle* rect) CTX_CALL(int, S2D_fillRectangle(rect))
+int S2D_ctx_fillRectangleF(S2D_Context* ctx, const fRectangle* rect) CTX_CALL(int, S2D_fillRectangleF(rect))
+int S2D_ctx_drawFillRectangle(S2D_Context* ctx, const Rectangle* rect) CTX_CALL(int, S2D_drawFillRectangle(rect))
+int S2D_ctx_drawFillRectangleF(S2D_Context* ctx, const fRectangle* rect) CTX_CALL(int, S2D_drawFillRectangleF(rect))
+int S2D_ctx_fillRectangles(S2D_Context* ctx, const Rectangle* rects, int count, const Uint32* colors) CTX_CALL(int, S2D_fillRectangles(rects, count, colors))
+int S2D_ctx_fillRectanglesF(S2D_Context* ctx, const fRectangle* rects, int count, const Uint32* colors) CTX_CALL(int, S2D_fillRectanglesF(rects, count, colors))
+int S2D_ctx_drawRectangles(S2D_Context* ctx, const Rectangle* rects, int count, const Uint32* colors) CTX_CALL(int, S2D_drawRectangles(rects, count, colors))
+int S2D_ctx_drawRectanglesF(S2D_Context* ctx, const fRectangle* rects, int count, const Uint32* colors) CTX_CALL(int, S2D_drawRectanglesF(rects, count, colors))
+int S2D_ctx_drawLines(S2D_Context* ctx, const Vector* points, int count, const Uint32* colors) CTX_CALL(int, S2D_drawLines(points, count, colors))
+int S2D_ctx_drawLinesF(S2D_Context* ctx, const fVector* points, int count, const Uint32* colors) CTX_CALL(int, S2D_drawLinesF(points, count, colors))
+
+int S2D_ctx_fillCircle(S2D_Context* ctx, fVector center, float radius) CTX_CALL(int, S2D_fillCircle(center, radius))
+int S2D_ctx_drawCircle(S2D_Context* ctx, fVector center, float radius, float thickness) CTX_CALL(int, S2D_drawCircle(center, radius, thickness))
+int S2D_ctx_fillEllipse(S2D_Context* ctx, fVector center, float rx, float ry) CTX_CALL(int, S2D_fillEllipse(center, rx, ry))
+int S2D_ctx_drawEllipse(S2D_Context* ctx, fVector center, float rx, float ry, float thickness) CTX_CALL(int, S2D_drawEllipse(center, rx, ry, thickness))
+int S2D_ctx_fillPolygon(S2D_Context* ctx, const fVector* points, int count) CTX_CALL(int, S2D_fillPolygon(points, count))
+int S2D_ctx_drawPolyline(S2D_Context* ctx, const fVector* points, int count, float thickness, LineJoin join, bool closed)
+    CTX_CALL(int, S2D_drawPolyline(points, count, thickness, join, closed))
+int S2D_ctx_drawMesh(S2D_Context* ctx, const S2D_Mesh* mesh, fVector offset) CTX_CALL(int, S2D_drawMesh(mesh, offset))
+
+int S2D_ctx_createTexture(S2D_Context* ctx, const char* file, Texture* text) CTX_CALL(int, S2D_createTexture(file, text))
+int S2D_ctx_createTextureFromPixels(S2D_Context* ctx, void* pixels, int w, int h, int pitch, PixelFormat format, int flags, Texture* txt)
+    CTX_CALL(int, S2D_createTextureFromPixels(pixels, w, h, pitch, format, flags, txt))
+int S2D_ctx_createTiledTexture(S2D_Context* ctx, const char* file, int tile_size, Texture* txt) CTX_CALL(int, S2D_createTiledTexture(file, tile_size, txt))
+int S2D_ctx_createUTF8Texture(S2D_Context* ctx, Texture* txt, StringRenderData* d) CTX_CALL(int, S2D_createUTF8Texture(txt, d))
+void S2D_ctx_setTextureStorage(S2D_Context* ctx, TextureStorage storage) CTX_CALL_VOID(S2D_setTextureStorage(storage))
+void S2D_ctx_destroyTexture(S2D_Context* ctx, Texture* txt) CTX_CALL_VOID(S2D_destroyTexture(txt))
+int S2D_ctx_drawTexture(S2D_Context* ctx, Texture* txt, Rectangle* rect) CTX_CALL(int, S2D_drawTexture(txt, rect))
+int S2D_ctx_drawTextureInstances(S2D_Context* ctx, Texture* txt, const S2D_Instance* inst, int n) CTX_CALL(int, S2D_drawTextureInstances(txt, inst, n))
+int S2D_ctx_drawTextureNative(S2D_Context* ctx, Texture* txt, Vector origin) CTX_CALL(int, S2D_drawTextureNative(txt, origin))
+
+void S2D_ctx_presentRender(S2D_Context* ctx) CTX_CALL_VOID(S2D_presentRender())
+int S2D_ctx_readRendererPixelData(S2D_Context* ctx, Rectangle* rect, RendererPixels* rpx) CTX_CALL(int, S2D_readRendererPixelData(rect, rpx))
+void S2D_ctx_freeRendererPixelData(S2D_Context* ctx, RendererPixels* rpx) CTX_CALL_VOID(S2D_freeRendererPixelData(rpx))
+void S2D_ctx_addKeyboardEventhandler(S2D_Context* ctx, void (*fun_ptr)(KeyboardEvent*, void*)) CTX_CALL_VOID(S2D_addKeyboardEventhandler(fun_ptr))
+void S2D_ctx_addMouseEventHandler(S2D_Context* ctx, void (*fun_ptr)(MouseEvent*, void*)) CTX_CALL_VOID(S2D_addMouseEventHandler(fun_ptr))
+
+void S2D_ctx_setCamera(S2D_Context* ctx, fVector position, float zoom, float rotation) CTX_CALL_VOID(S2D_setCamera(position, zoom, rotation))
+void S2D_ctx_resetCamera(S2D_Context* ctx) CTX_CALL_VOID(S2D_resetCamera())
+fVector S2D_ctx_screenToWorld(S2D_Context* ctx, fVector screen) CTX_CALL(fVector, S2D_screenToWorld(screen))
+fVector S2D_ctx_worldToScreen(S2D_Context* ctx, fVector world) CTX_CALL(fVector, S2D_worldToScreen(world))
+S2D_FrameStats S2D_ctx_getFrameStats(S2D_Context* ctx) CTX_CALL(S2D_FrameStats, S2D_getFrameStats())
+S2D_FrameProfile S2D_ctx_getFrameProfile(S2D_Context* ctx) CTX_CALL(S2D_FrameProfile, S2D_getFrameProfile())
+
+int S2D_ctx_flushRenderQueue(S2D_Context* ctx, S2D_RenderQueue* q) CTX_CALL(int, S2D_flushRenderQueue(q))
+int S2D_ctx_submitCommandLists(S2D_Context* ctx, S2D_CommandList* const* lists, int n) CTX_CALL(int, S2D_submitCommandLists(lists, n))
+int S2D_ctx_drawTilemap(S2D_Context* ctx, S2D_Tilemap* map, Vector view_origin) CTX_CALL(int, S2D_drawTilemap(map, view_origin))
+int S2D_ctx_drawScalarField(S2D_Context* ctx, const float* data, int w, int h, int stride, const S2D_Colormap* lut, const Rectangle* dst)
+    CTX_CALL(int, S2D_drawScalarField(data, w, h, stride, lut, dst))
+int S2D_ctx_drawScalarField16(S2D_Context* ctx, const Uint16* data, int w, int h, int stride, const S2D_Colormap* lut, const Rectangle* dst)
+    CTX_CALL(int, S2D_drawScalarField16(data, w, h, stride, lut, dst))
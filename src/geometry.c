@@ -0,0 +1,346 @@
+#include "internal.h"
+#include <math.h>
+
+/*
+    CPU tessellation of circles, ellipses, polygons and thick polylines into triangle lists.
+    Shapes are tessellated into a batch_buffer, either the shared g_batch for immediate drawing
+    or the buffer of a S2D_Mesh which is kept and can be drawn every frame with a single call.
+*/
+
+#define CIRCLE_TOLERANCE_PX 0.25f
+#define CIRCLE_MIN_SEGMENTS 8
+#define CIRCLE_MAX_SEGMENTS 256
+#define MITER_LIMIT 4.0f
+
+struct S2D_Mesh {
+    batch_buffer buf;
+    polygon_scratch scratch;    // owned by the mesh, meshes are often built on loader threads
+};
+
+static inline int push_vertex(batch_buffer* b, float x, float y, SDL_Color c){
+    b->vertices[b->vertex_count] = (SDL_Vertex){{x, y}, c, {0.0f, 0.0f}};
+    return b->vertex_count++;
+}
+
+static inline void push_triangle(batch_buffer* b, int i0, int i1, int i2){
+    int* i = b->indices + b->index_count;
+    i[0] = i0, i[1] = i1, i[2] = i2;
+    b->index_count += 3;
+}
+
+// segment count keeping the chord within CIRCLE_TOLERANCE_PX of the true arc
+static int circle_segments(float radius){
+    if (radius <= CIRCLE_TOLERANCE_PX) return CIRCLE_MIN_SEGMENTS;
+    int n = (int) ceilf((float) M_PI / acosf(1.0f - CIRCLE_TOLERANCE_PX / radius));
+    if (n < CIRCLE_MIN_SEGMENTS) n = CIRCLE_MIN_SEGMENTS;
+    if (n > CIRCLE_MAX_SEGMENTS) n = CIRCLE_MAX_SEGMENTS;
+    return n;
+}
+
+int tess_fill_ellipse(batch_buffer* b, fVector c, float rx, float ry, SDL_Color color){
+    int n = circle_segments(rx > ry ? rx : ry);
+    if (batch_reserve(b, n + 1, 3*n) != 0) return -1;
+    int center = push_vertex(b, c.x, c.y, color);
+    for (int i = 0; i < n; i++){
+        float a = 2.0f * (float) M_PI * i / n;
+        push_vertex(b, c.x + rx*cosf(a), c.y + ry*sinf(a), color);
+    }
+    for (int i = 0; i < n; i++){
+        push_triangle(b, center, center + 1 + i, center + 1 + (i + 1) % n);
+    }
+    return 0;
+}
+
+static int tess_draw_ellipse(batch_buffer* b, fVector c, float rx, float ry, float thickness, SDL_Color color){
+    int n = circle_segments(rx > ry ? rx : ry);
+    float ht = thickness / 2;
+    if (batch_reserve(b, 2*n, 6*n) != 0) return -1;
+    int base = b->vertex_count;
+    for (int i = 0; i < n; i++){
+        float a = 2.0f * (float) M_PI * i / n;
+        float ca = cosf(a), sa = sinf(a);
+        push_vertex(b, c.x + (rx + ht)*ca, c.y + (ry + ht)*sa, color);
+        push_vertex(b, c.x + (rx - ht)*ca, c.y + (ry - ht)*sa, color);
+    }
+    for (int i = 0; i < n; i++){
+        int o0 = base + 2*i, i0 = o0 + 1;
+        int o1 = base + 2*((i + 1) % n), i1 = o1 + 1;
+        push_triangle(b, o0, o1, i1);
+        push_triangle(b, o0, i1, i0);
+    }
+    return 0;
+}
+
+static inline float cross(fVector o, fVector a, fVector b){
+    return (a.x - o.x)*(b.y - o.y) - (a.y - o.y)*(b.x - o.x);
+}
+
+static bool point_in_triangle(fVector p, fVector a, fVector b, fVector c, float orientation){
+    return orientation*cross(a, b, p) >= 0 && orientation*cross(b, c, p) >= 0 && orientation*cross(c, a, p) >= 0;
+}
+
+// ear clipping, works for convex and concave simple polygons in either winding order
+static int tess_fill_polygon(batch_buffer* b, polygon_scratch* scratch, const fVector* pts, int count, SDL_Color color){
+    if (count < 3) return 0;
+    if (batch_reserve(b, count, 3*(count - 2)) != 0) return -1;
+    // the scratch keeps its largest size, so filling polygons every frame does not allocate
+    if (scratch->capacity < count){
+        int* indices = realloc(scratch->indices, count * sizeof(int));
+        if (indices == NULL) return -1;
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+        scratch->indices = indices;
+        scratch->capacity = count;
+    }
+    int* remaining = scratch->indices;
+
+    float area = 0;
+    for (int i = 0; i < count; i++){
+        const fVector* p0 = &pts[i];
+        const fVector* p1 = &pts[(i + 1) % count];
+        area += p0->x*p1->y - p1->x*p0->y;
+    }
+    float orientation = area >= 0 ? 1.0f : -1.0f;
+
+    int base = b->vertex_count;
+    for (int i = 0; i < count; i++){
+        push_vertex(b, pts[i].x, pts[i].y, color);
+        remaining[i] = i;
+    }
+
+    int n = count;
+    int i = 0, misses = 0;
+    while (n > 3 && misses < n){
+        int ip = remaining[(i + n - 1) % n], ic = remaining[i % n], in = remaining[(i + 1) % n];
+        fVector a = pts[ip], c = pts[ic], d = pts[in];
+        bool ear = orientation*cross(a, c, d) > 0;
+        for (int k = 0; ear && k < n; k++){
+            int v = remaining[k];
+            if (v == ip || v == ic || v == in) continue;
+            if (point_in_triangle(pts[v], a, c, d, orientation)) ear = FALSE;
+        }
+        if (ear){
+            push_triangle(b, base + ip, base + ic, base + in);
+            memmove(&remaining[i % n], &remaining[i % n + 1], (n - i % n - 1) * sizeof(int));
+            n--;
+            misses = 0;
+        } else {
+            i++;
+            misses++;
+        }
+        i %= n;
+    }
+    // degenerate or self intersecting input stops early instead of looping forever
+    if (n == 3) push_triangle(b, base + remaining[0], base + remaining[1], base + remaining[2]);
+    return 0;
+}
+
+static int tess_join(batch_buffer* b, fVector p, fVector n0, fVector n1, float side, float hw, LineJoin join, SDL_Color color){
+    fVector a = {p.x + side*hw*n0.x, p.y + side*hw*n0.y};
+    fVector c = {p.x + side*hw*n1.x, p.y + side*hw*n1.y};
+
+    if (join == JOIN_ROUND){
+        float a0 = atan2f(side*n0.y, side*n0.x);
+        float a1 = atan2f(side*n1.y, side*n1.x);
+        float sweep = a1 - a0;
+        if (sweep > (float) M_PI) sweep -= 2.0f * (float) M_PI;
+        if (sweep < -(float) M_PI) sweep += 2.0f * (float) M_PI;
+        int steps = (int) ceilf(fabsf(sweep) / (2.0f * (float) M_PI) * circle_segments(hw));
+        if (steps < 1) steps = 1;
+        if (batch_reserve(b, steps + 2, 3*steps) != 0) return -1;
+        int center = push_vertex(b, p.x, p.y, color);
+        int prev = push_vertex(b, a.x, a.y, color);
+        for (int i = 1; i <= steps; i++){
+            float ang = a0 + sweep * i / steps;
+            int cur = push_vertex(b, p.x + hw*cosf(ang), p.y + hw*sinf(ang), color);
+            push_triangle(b, center, prev, cur);
+            prev = cur;
+        }
+        return 0;
+    }
+
+    if (batch_reserve(b, 4, 6) != 0) return -1;
+    int center = push_vertex(b, p.x, p.y, color);
+    int ia = push_vertex(b, a.x, a.y, color);
+    int ic = push_vertex(b, c.x, c.y, color);
+    fVector m = {n0.x + n1.x, n0.y + n1.y};
+    float mlen = sqrtf(m.x*m.x + m.y*m.y);
+    float cos_half = mlen > 0 ? (m.x*n0.x + m.y*n0.y) / mlen : 0;
+    if (join == JOIN_MITER && cos_half > 1.0f / MITER_LIMIT){
+        float len = hw / cos_half / mlen;
+        int im = push_vertex(b, p.x + side*m.x*len, p.y + side*m.y*len, color);
+        push_triangle(b, center, ia, im);
+        push_triangle(b, center, im, ic);
+    } else {
+        push_triangle(b, center, ia, ic);
+    }
+    return 0;
+}
+
+static int tess_polyline(batch_buffer* b, const fVector* pts, int count, float thickness, LineJoin join, bool closed, SDL_Color color){
+    if (count < 2) return 0;
+    float hw = thickness / 2;
+    int segments = closed ? count : count - 1;
+    fVector prev_n = {0, 0}, first_n = {0, 0}, prev_d = {0, 0}, first_d = {0, 0};
+
+    for (int s = 0; s < segments; s++){
+        fVector p0 = pts[s], p1 = pts[(s + 1) % count];
+        fVector d = {p1.x - p0.x, p1.y - p0.y};
+        float len = sqrtf(d.x*d.x + d.y*d.y);
+        if (len == 0) continue;
+        d.x /= len, d.y /= len;
+        fVector n = {-d.y, d.x};
+
+        if (batch_reserve(b, 4, 6) != 0) return -1;
+        int i0 = push_vertex(b, p0.x + hw*n.x, p0.y + hw*n.y, color);
+        int i1 = push_vertex(b, p1.x + hw*n.x, p1.y + hw*n.y, color);
+        int i2 = push_vertex(b, p1.x - hw*n.x, p1.y - hw*n.y, color);
+        int i3 = push_vertex(b, p0.x - hw*n.x, p0.y - hw*n.y, color);
+        push_triangle(b, i0, i1, i2);
+        push_triangle(b, i0, i2, i3);
+
+        if (s == 0){
+            first_n = n, first_d = d;
+        } else {
+            // the join fills the gap on the outer side of the turn
+            float turn = prev_d.x*d.y - prev_d.y*d.x;
+            if (turn != 0 && tess_join(b, p0, prev_n, n, turn > 0 ? -1.0f : 1.0f, hw, join, color) != 0) return -1;
+        }
+        prev_n = n, prev_d = d;
+    }
+
+    if (closed && segments > 1){
+        float turn = prev_d.x*first_d.y - prev_d.y*first_d.x;
+        if (turn != 0 && tess_join(b, pts[0], prev_n, first_n, turn > 0 ? -1.0f : 1.0f, hw, join, color) != 0) return -1;
+    }
+    return 0;
+}
+
+/*
+    a line one draw unit wide on screen as a quad in world coordinates, unit_x and unit_y are the world
+    vectors of one draw unit along the screen axes. The quad runs through the centers of the screen pixels
+    of its end points and extends half a unit beyond them, so horizontal and vertical lines cover the pixels
+    render_line draws. Slanted lines are covered by area instead of stepped like SDL's line drawing, which
+    differs from it by a pixel here and there along the line.
+*/
+int tess_line(batch_buffer* b, fVector p0, fVector p1, fVector unit_x, fVector unit_y, SDL_Color color){
+    float unit = sqrtf(unit_x.x*unit_x.x + unit_x.y*unit_x.y);
+    fVector center = {(unit_x.x + unit_y.x) / 2, (unit_x.y + unit_y.y) / 2};
+    fVector d = {p1.x - p0.x, p1.y - p0.y};
+    float len = sqrtf(d.x*d.x + d.y*d.y);
+    // a zero length line is one pixel, drawn as a unit long segment along the screen x axis
+    if (len == 0) d = unit_x, len = unit;
+    d.x *= unit / (2*len), d.y *= unit / (2*len);
+    fVector ends[2] = {{p0.x + center.x - d.x, p0.y + center.y - d.y}, {p1.x + center.x + d.x, p1.y + center.y + d.y}};
+    return tess_polyline(b, ends, 2, unit, JOIN_BEVEL, FALSE, color);
+}
+
+static int submit_immediate(int tess_status){
+    if (tess_status != 0){
+        batch_reset(&g_batch);
+        return ERROR_DRAW_GEOMETRY;
+    }
+    return batch_submit(&g_batch, NULL, 1) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+}
+
+static SDL_Color current_color(){
+    return color_SDL2(g_drawstate.draw_color);
+}
+
+int S2D_fillCircle(fVector center, float radius){
+    return submit_immediate(tess_fill_ellipse(&g_batch, center, radius, radius, current_color()));
+}
+
+int S2D_drawCircle(fVector center, float radius, float thickness){
+    return submit_immediate(tess_draw_ellipse(&g_batch, center, radius, radius, thickness, current_color()));
+}
+
+int S2D_fillEllipse(fVector center, float rx, float ry){
+    return submit_immediate(tess_fill_ellipse(&g_batch, center, rx, ry, current_color()));
+}
+
+int S2D_drawEllipse(fVector center, float rx, float ry, float thickness){
+    return submit_immediate(tess_draw_ellipse(&g_batch, center, rx, ry, thickness, current_color()));
+}
+
+int S2D_fillPolygon(const fVector *points, int count){
+    return submit_immediate(tess_fill_polygon(&g_batch, &current_context()->polygon_scratch, points, count, current_color()));
+}
+
+int S2D_drawPolyline(const fVector *points, int count, float thickness, LineJoin join, bool closed){
+    return submit_immediate(tess_polyline(&g_batch, points, count, thickness, join, closed, current_color()));
+}
+
+S2D_Mesh* S2D_createMesh(){
+    return calloc(1, sizeof(S2D_Mesh));
+}
+
+void S2D_destroyMesh(S2D_Mesh* mesh){
+    if (mesh == NULL) return;
+    free(mesh->buf.vertices);
+    free(mesh->buf.indices);
+    free(mesh->scratch.indices);
+    free(mesh);
+}
+
+void S2D_clearMesh(S2D_Mesh* mesh){
+    batch_reset(&mesh->buf);
+}
+
+int S2D_meshFillCircle(S2D_Mesh* mesh, fVector center, float radius, Uint32 rgba){
+    return tess_fill_ellipse(&mesh->buf, center, radius, radius, color_SDL2(rgba)) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+}
+
+int S2D_meshDrawCircle(S2D_Mesh* mesh, fVector center, float radius, float thickness, Uint32 rgba){
+    return tess_draw_ellipse(&mesh->buf, center, radius, radius, thickness, color_SDL2(rgba)) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+}
+
+int S2D_meshFillEllipse(S2D_Mesh* mesh, fVector center, float rx, float ry, Uint32 rgba){
+    return tess_fill_ellipse(&mesh->buf, center, rx, ry, color_SDL2(rgba)) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+}
+
+int S2D_meshDrawEllipse(S2D_Mesh* mesh, fVector center, float rx, float ry, float thickness, Uint32 rgba){
+    return tess_draw_ellipse(&mesh->buf, center, rx, ry, thickness, color_SDL2(rgba)) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+}
+
+int S2D_meshFillPolygon(S2D_Mesh* mesh, const fVector* points, int count, Uint32 rgba){
+    return tess_fill_polygon(&mesh->buf, &mesh->scratch, points, count, color_SDL2(rgba)) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+}
+
+int S2D_meshDrawPolyline(S2D_Mesh* mesh, const fVector* points, int count, float thickness, LineJoin join, bool closed, Uint32 rgba){
+    return tess_polyline(&mesh->buf, points, count, thickness, join, closed, color_SDL2(rgba)) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+}
+
+int S2D_meshAddTriangles(S2D_Mesh* mesh, const fVector* points, const Uint32* colors, int count){
+    batch_buffer* b = &mesh->buf;
+    count -= count % 3;
+    if (batch_reserve(b, count, count) != 0) return ERROR_DRAW_GEOMETRY;
+    for (int i = 0; i < count; i += 3){
+        int i0 = push_vertex(b, points[i].x, points[i].y, color_SDL2(colors[i]));
+        int i1 = push_vertex(b, points[i+1].x, points[i+1].y, color_SDL2(colors[i+1]));
+        int i2 = push_vertex(b, points[i+2].x, points[i+2].y, color_SDL2(colors[i+2]));
+        push_triangle(b, i0, i1, i2);
+    }
+    return 0;
+}
+
+int S2D_drawMesh(const S2D_Mesh* mesh, fVector offset){
+    const batch_buffer* m = &mesh->buf;
+    if (m->index_count == 0) return 0;
+    if (offset.x == 0 && offset.y == 0 && !camera_enabled()){
+        // vertices are only modified under a camera, so the mesh can be submitted directly
+        return render_geometry(NULL, m->vertices, m->vertex_count, m->indices, m->index_count, 1) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+    }
+
+    // transformed copy through the shared batch, the cached mesh itself stays untouched
+    if (batch_reserve(&g_batch, m->vertex_count, m->index_count) != 0) return ERROR_DRAW_GEOMETRY;
+    for (int i = 0; i < m->vertex_count; i++){
+        SDL_Vertex v = m->vertices[i];
+        v.position.x += offset.x;
+        v.position.y += offset.y;
+        g_batch.vertices[i] = v;
+    }
+    memcpy(g_batch.indices, m->indices, m->index_count * sizeof(int));
+    g_batch.vertex_count = m->vertex_count;
+    g_batch.index_count = m->index_count;
+    return batch_submit(&g_batch, NULL, 1) != 0 ? ERROR_DRAW_GEOMETRY : 0;
+}
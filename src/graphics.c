@@ -1,4 +1,4 @@
-#include "../graphics.h"
+#include "internal.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_video.h>
 #include <SDL2/SDL_timer.h>
@@ -12,9 +12,6 @@
 
 #include <stdio.h> //for debugging
 
-#define INTERNAL_PIXEL_FORMAT (SDL_PIXELFORMAT_RGBA32)
-#define INTERNAL_PIXEL_SIZE 4
-
 typedef enum {
     QUIT = SDL_QUIT,
     KEY_PRESSED = SDL_KEYDOWN,
@@ -27,20 +24,24 @@ typedef enum {
     MOUSE_WHEEL_MOVED
 } EventType;
 
-typedef struct {
-    SDL_Texture* texture;
-    SDL_Surface* surface;
-} internal_texture_data;
 
 
+// event handlers, texture data and read back pixel buffers kept for reuse belong to the current context
+#define g_evh (&current_context()->evh)
+#define g_free_texture_data (current_context()->free_texture_data)
+#define g_readback_buffer (current_context()->readback_buffer)
+#define g_readback_size (current_context()->readback_size)
+#define g_upload_buffer (current_context()->upload_buffer)
+#define g_upload_size (current_context()->upload_size)
+#define g_texture_storage (current_context()->texture_storage)
 
-static SDL_Window* g_WINDOW;
-static SDL_Renderer* g_RENDERER;
-static Drawstate g_drawstate;
-static EventHandler evhData;
-static EventHandler* g_evh = &evhData;
+// user event type pushed by S2D_wakeEventLoop, registered by S2D_initialize
+static Uint32 g_wake_event;
+// set while a wake event is queued, so repeated wakes queue a single event
+static SDL_atomic_t g_wake_pending;
 
 static void handle_quit_signal(void*){
+    rt_shutdown(current_context());
     SDL_DestroyRenderer(g_RENDERER);
     SDL_DestroyWindow(g_WINDOW);
     SDL_Quit();
@@ -52,21 +53,35 @@ int S2D_initialize(){
     g_evh->keyboard_eventhandler = FALSE;
     g_evh->mouse_eventhandler = FALSE;
     g_evh->app_quit = handle_quit_signal;
+    if (g_wake_event == 0){
+        Uint32 type = SDL_RegisterEvents(1);
+        if (type != (Uint32) -1) g_wake_event = type;
+    }
     return SDL_Init(SDL_INIT_VIDEO|SDL_INIT_TIMER|SDL_INIT_EVENTS) != 0 ? ERROR_INITIALIZE : 0;
 }
 
 
 
 int S2D_setDrawColor (Uint32 rgba){
-    if(SDL_SetRenderDrawColor(g_RENDERER, rgba&0xFF, (rgba>>8)&0xFF, (rgba>>16)&0xFF, rgba>>24) != 0){
+    if(rt_draw_color(rgba) != 0){
         return ERROR_SET_DRAW_COLOR;
     }
     g_drawstate.draw_color = rgba;
     return 0;
 }
 
+int S2D_setBlendMode(BlendMode mode){
+    if (rt_blend_mode(mode) != 0) return ERROR_SET_BLEND_MODE;
+    g_drawstate.blend_mode = mode;
+    return 0;
+}
+
 int S2D_setRenderScale(float x_scale, float y_scale){
-    if (SDL_RenderSetScale(g_RENDERER, x_scale, y_scale) != 0) return ERROR_SET_RENDER_SCALE;
+    float res_scale = current_context()->camera.res_scale;
+    if (rt_scale(x_scale * res_scale, y_scale * res_scale) != 0) return ERROR_SET_RENDER_SCALE;
+    current_context()->camera.scale_x = x_scale;
+    current_context()->camera.scale_y = y_scale;
+    camera_update();
     return 0;
 }
 
@@ -75,12 +90,13 @@ Drawstate S2D_getDrawState(){
 }
 
 int S2D_clearScreen(){
-    if (SDL_RenderClear(g_RENDERER) != 0) return ERROR_CLEAR_SCREEN;
+    if (rt_clear() != 0) return ERROR_CLEAR_SCREEN;
     return 0;
 }
 
-// lets quit, mouse, keyboard events pass through from SDL
+// lets quit, mouse, keyboard and wake events pass through from SDL
 static int eventFilter(void* userdata, SDL_Event *event){
+    if (g_wake_event != 0 && event->type == g_wake_event) return 1;
     Uint32 etypeCode = event->type>>8;
     if (etypeCode <= 0x4 && (etypeCode&0xd) != 0) return 1;
     return 0;
@@ -90,7 +106,8 @@ static int eventFilter(void* userdata, SDL_Event *event){
 
 static int EventQueueFilter (void* userdata, SDL_Event *event, void* data){
     EventHandler* eh = (EventHandler*) userdata;
-    
+    input_record_event(event);
+
     if (event->type == QUIT) {
         if (eh->app_quit != NULL) eh->app_quit(NULL);
     }
@@ -112,6 +129,7 @@ static int EventQueueFilter (void* userdata, SDL_Event *event, void* data){
         if(event->type == MOUSE_BUTTON_PRESSED || event->type == MOUSE_BUTTON_RELEASED){
             MouseEvent me = {.type = BUTTON, .btn = {.button = event->button.button, .clicks = event->button.clicks,
             .state = event->button.state, .timestamp = event->button.timestamp, .x = event->button.x, .y = event->button.y }};
+            internal_res_map_mouse(&me.btn.x, &me.btn.y, NULL, NULL);
             eh->mouse_eventhandler(&me, data);
         }
 
@@ -127,6 +145,7 @@ static int EventQueueFilter (void* userdata, SDL_Event *event, void* data){
                     .yrel = event->motion.yrel
                 }
             };
+            internal_res_map_mouse(&me.move.x, &me.move.y, &me.move.xrel, &me.move.yrel);
             eh->mouse_eventhandler(&me, data);
         }
         
@@ -150,13 +169,75 @@ static int EventQueueFilter (void* userdata, SDL_Event *event, void* data){
 
 
 
+#define CONTEXT_WINDOW_DATA "S2D_Context"
+
+// the handlers of the context owning the window the event belongs to
+static EventHandler* event_handler(const SDL_Event *event){
+    Uint32 id = 0;
+    switch (event->type){
+        case KEY_PRESSED: case KEY_RELEASED: id = event->key.windowID; break;
+        case MOUSE_BUTTON_PRESSED: case MOUSE_BUTTON_RELEASED: id = event->button.windowID; break;
+        case MOUSE_MOVE: id = event->motion.windowID; break;
+        case MOUSE_WHEEL_MOVED: id = event->wheel.windowID; break;
+    }
+    SDL_Window* window = id != 0 ? SDL_GetWindowFromID(id) : NULL;
+    S2D_Context* ctx = window != NULL ? SDL_GetWindowData(window, CONTEXT_WINDOW_DATA) : NULL;
+    return ctx != NULL ? &ctx->evh : g_evh;
+}
+
 int S2D_eventDequeue(void* data){
     SDL_Event event;
-    int status = SDL_PollEvent(&event);
-    if (status == 0) return 0;
-    else {
-        return EventQueueFilter(g_evh, &event, data);
+    int retcode;
+    TRACE_BEGIN("S2D_eventDequeue");
+    int status = input_replaying() ? input_replay_poll(&event) : SDL_PollEvent(&event);
+    if (status == 0) retcode = 0;
+    else if (event.type == g_wake_event){
+        SDL_AtomicSet(&g_wake_pending, 0);
+        retcode = 1;
+    } else {
+        retcode = EventQueueFilter(event_handler(&event), &event, data);
     }
+    TRACE_END();
+    return retcode;
+}
+
+int S2D_waitEvents(int timeout_ms, void* data){
+    SDL_Event event;
+    int dispatched = 0;
+    TRACE_BEGIN("S2D_waitEvents");
+    int status;
+    if (input_replaying()){
+        // recorded events are due at once, without any the wait takes as long as it did while recording
+        status = input_replay_poll(&event);
+        if (status == 0) input_replay_idle(timeout_ms);
+    } else {
+        status = SDL_WaitEventTimeout(&event, timeout_ms < 0 ? -1 : timeout_ms);
+    }
+    // everything that queued up while sleeping is handled in one go
+    while (status != 0){
+        if (event.type == g_wake_event){
+            SDL_AtomicSet(&g_wake_pending, 0);
+        } else {
+            EventQueueFilter(event_handler(&event), &event, data);
+            dispatched++;
+        }
+        status = input_replaying() ? input_replay_poll(&event) : SDL_PollEvent(&event);
+    }
+    TRACE_END();
+    return dispatched;
+}
+
+int S2D_wakeEventLoop(){
+    if (g_wake_event == 0) return ERROR_WAKE_EVENT_LOOP;
+    if (!SDL_AtomicCAS(&g_wake_pending, 0, 1)) return 0;
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = g_wake_event;
+    if (SDL_PushEvent(&event) != 1){
+        SDL_AtomicSet(&g_wake_pending, 0);
+        return ERROR_WAKE_EVENT_LOOP;
+    }
+    return 0;
 }
 
 int S2D_createWindow(const char *title, int w, int h){
@@ -166,14 +247,19 @@ int S2D_createWindow(const char *title, int w, int h){
         w, h, flags);
 
     if (g_WINDOW == NULL) return ERROR_CREATE_WINDOW;
+    SDL_SetWindowData(g_WINDOW, CONTEXT_WINDOW_DATA, current_context());
     SDL_SetEventFilter(eventFilter, NULL);
 
     SDL_GetWindowSize(g_WINDOW, &g_drawstate.draw_w, &g_drawstate.draw_h);
     
     g_RENDERER = SDL_CreateRenderer(g_WINDOW,0, 0);
+    // e.g. no OpenGL under the dummy video driver of headless replays
+    if (g_RENDERER == NULL) g_RENDERER = SDL_CreateRenderer(g_WINDOW, -1, SDL_RENDERER_SOFTWARE);
     if (g_RENDERER == NULL) return ERROR_CREATE_RENDERER;
+    camera_update();
 
     if ((code = S2D_setDrawColor(DRAW_COLOR_DEFAULT)) != 0) return code;
+    if ((code = S2D_setBlendMode(BLEND_NONE)) != 0) return code;
 
     if((code = SDL_RenderClear(g_RENDERER)) != 0) return code;
     SDL_RenderPresent(g_RENDERER);
@@ -183,27 +269,31 @@ int S2D_createWindow(const char *title, int w, int h){
 
 
 int S2D_drawPoint(Vector p){
-    return SDL_RenderDrawPoint(g_RENDERER, p.x, p.y ) != 0 ? ERROR_DRAW_COORD : 0;
+    SDL_Point sp = {p.x, p.y};
+    if (camera_cull(p.x, p.y, p.x, p.y)) return 0;
+    return render_points(NULL, &sp, 1, FALSE) != 0 ? ERROR_DRAW_COORD : 0;
 }
 
 int S2D_drawPointF(fVector p){
-    return SDL_RenderDrawPointF(g_RENDERER, p.x, p.y ) != 0 ? ERROR_DRAW_COORD : 0;
+    SDL_FPoint sp = {p.x, p.y};
+    if (camera_cull(p.x, p.y, p.x, p.y)) return 0;
+    return render_points(&sp, NULL, 1, FALSE) != 0 ? ERROR_DRAW_COORD : 0;
 }
 
 int S2D_drawPoints(const Vector *points, int count){
-    return SDL_RenderDrawPoints(g_RENDERER, (SDL_Point *) points, count) != 0 ? ERROR_DRAW_COORD : 0;
+    return render_points(NULL, (const SDL_Point *) points, count, FALSE) != 0 ? ERROR_DRAW_COORD : 0;
 }
 
 int S2D_drawPointsF(const fVector *points, int count){
-    return SDL_RenderDrawPointsF(g_RENDERER, (SDL_FPoint *) points, count) != 0 ? ERROR_DRAW_COORD : 0;
+    return render_points((const SDL_FPoint *) points, NULL, count, FALSE) != 0 ? ERROR_DRAW_COORD : 0;
 }
 
 int S2D_drawLine(Vector c0, Vector c1){
-    return SDL_RenderDrawLine(g_RENDERER, c0.x, c0.y, c1.x, c1.y) !=0 ? ERROR_DRAW_LINE: 0;
+    return render_line(c0.x, c0.y, c1.x, c1.y) !=0 ? ERROR_DRAW_LINE: 0;
 }
 
 int S2D_drawLineF(fVector c0, fVector c1){
-    return SDL_RenderDrawLineF(g_RENDERER, c0.x, c0.y, c1.x, c1.y) !=0 ? ERROR_DRAW_LINE: 0;
+    return render_line(c0.x, c0.y, c1.x, c1.y) !=0 ? ERROR_DRAW_LINE: 0;
 }
 
 static void convert_rectange_SDL2(const Rectangle* rect, SDL_Rect* rect_sdl){
@@ -221,28 +311,26 @@ static void convert_rectange_SDL2F(const fRectangle* rect, SDL_FRect* rect_sdl){
 }
 
 int S2D_drawRectangle(const Rectangle* rect){
-    SDL_Rect rect_sdl;
-    convert_rectange_SDL2(rect, &rect_sdl);
-    return SDL_RenderDrawRect(g_RENDERER, &rect_sdl) != 0 ? ERROR_DRAW_RECT : 0;
+    SDL_FRect rect_sdl = {rect->origin.x, rect->origin.y, rect->w, rect->h};
+    return render_rect(&rect_sdl, FALSE) != 0 ? ERROR_DRAW_RECT : 0;
 }
 
 int S2D_drawRectangleF(const fRectangle* rect){
     SDL_FRect rect_sdl;
     convert_rectange_SDL2F(rect, &rect_sdl);
-    return SDL_RenderDrawRectF(g_RENDERER, &rect_sdl) != 0 ? ERROR_DRAW_RECT : 0;
+    return render_rect(&rect_sdl, FALSE) != 0 ? ERROR_DRAW_RECT : 0;
 }
 
 int S2D_fillRectangle(const Rectangle* rect){
-    SDL_Rect rect_sdl;
-    convert_rectange_SDL2(rect, &rect_sdl);
-    return SDL_RenderFillRect(g_RENDERER, &rect_sdl) != 0 ? ERROR_RECT_FILL : 0;
+    SDL_FRect rect_sdl = {rect->origin.x, rect->origin.y, rect->w, rect->h};
+    return render_rect(&rect_sdl, TRUE) != 0 ? ERROR_RECT_FILL : 0;
 }
 
 
 int S2D_fillRectangleF(const fRectangle* rect){
     SDL_FRect rect_sdl;
     convert_rectange_SDL2F(rect, &rect_sdl);
-    return SDL_RenderFillRectF(g_RENDERER, &rect_sdl) != 0 ? ERROR_RECT_FILL : 0;
+    return render_rect(&rect_sdl, TRUE) != 0 ? ERROR_RECT_FILL : 0;
 }
 
 int S2D_drawFillRectangle(const Rectangle* rect){
@@ -261,48 +349,449 @@ int S2D_drawFillRectangleF(const fRectangle* rect){
 
 
 
+// Rectangle, fRectangle and Vector arrays are handed to SDL without copying
+SDL_COMPILE_TIME_ASSERT(rect_layout, sizeof(Rectangle) == sizeof(SDL_Rect) && offsetof(Rectangle, w) == offsetof(SDL_Rect, w));
+SDL_COMPILE_TIME_ASSERT(frect_layout, sizeof(fRectangle) == sizeof(SDL_FRect) && offsetof(fRectangle, w) == offsetof(SDL_FRect, w));
+SDL_COMPILE_TIME_ASSERT(point_layout, sizeof(Vector) == sizeof(SDL_Point) && sizeof(fVector) == sizeof(SDL_FPoint));
+
+static int set_color_raw(Uint32 rgba){
+    return rt_draw_color(rgba);
+}
+
+// fills of per element colors are one geometry batch with the colors as vertex colors
+static int fill_colored_rects(const SDL_FRect* frects, const SDL_Rect* rects, int count, const Uint32* colors){
+    for (int i = 0; i < count; i++){
+        SDL_FRect dst = frects != NULL ? frects[i] : (SDL_FRect){rects[i].x, rects[i].y, rects[i].w, rects[i].h};
+        if (batch_quad(&g_batch, &dst, color_SDL2(colors[i]), 0.0f, 0.0f, 0.0f, 0.0f) != 0){
+            batch_reset(&g_batch);
+            return ERROR_RECT_FILL;
+        }
+    }
+    return batch_submit(&g_batch, NULL, count) != 0 ? ERROR_RECT_FILL : 0;
+}
+
+// outlines of per element colors are drawn as one call per run of equal colors
+static int draw_colored_rects(const SDL_FRect* frects, const SDL_Rect* rects, int count, const Uint32* colors){
+    int retcode = 0;
+    int start = 0;
+    while (start < count && retcode == 0){
+        int end = start + 1;
+        while (end < count && colors[end] == colors[start]) end++;
+        set_color_raw(colors[start]);
+        retcode = render_rects(frects != NULL ? frects + start : NULL, rects != NULL ? rects + start : NULL, end - start, FALSE);
+        start = end;
+    }
+    set_color_raw(g_drawstate.draw_color);
+    return retcode != 0 ? ERROR_DRAW_RECT : 0;
+}
+
+int S2D_fillRectangles(const Rectangle* rects, int count, const Uint32* colors){
+    if (colors != NULL) return fill_colored_rects(NULL, (const SDL_Rect*) rects, count, colors);
+    return render_rects(NULL, (const SDL_Rect*) rects, count, TRUE) != 0 ? ERROR_RECT_FILL : 0;
+}
+
+int S2D_fillRectanglesF(const fRectangle* rects, int count, const Uint32* colors){
+    if (colors != NULL) return fill_colored_rects((const SDL_FRect*) rects, NULL, count, colors);
+    return render_rects((const SDL_FRect*) rects, NULL, count, TRUE) != 0 ? ERROR_RECT_FILL : 0;
+}
+
+int S2D_drawRectangles(const Rectangle* rects, int count, const Uint32* colors){
+    if (colors != NULL) return draw_colored_rects(NULL, (const SDL_Rect*) rects, count, colors);
+    return render_rects(NULL, (const SDL_Rect*) rects, count, FALSE) != 0 ? ERROR_DRAW_RECT : 0;
+}
+
+int S2D_drawRectanglesF(const fRectangle* rects, int count, const Uint32* colors){
+    if (colors != NULL) return draw_colored_rects((const SDL_FRect*) rects, NULL, count, colors);
+    return render_rects((const SDL_FRect*) rects, NULL, count, FALSE) != 0 ? ERROR_DRAW_RECT : 0;
+}
+
+static int draw_colored_lines(const SDL_FPoint* fpoints, const SDL_Point* points, int count, const Uint32* colors){
+    int retcode = 0;
+    int start = 0;
+    // segment i goes from point i to i+1, runs of equal colors share their end points
+    while (start < count - 1 && retcode == 0){
+        int end = start + 1;
+        while (end < count - 1 && colors[end] == colors[start]) end++;
+        set_color_raw(colors[start]);
+        retcode = render_points(fpoints != NULL ? fpoints + start : NULL, points != NULL ? points + start : NULL, end - start + 1, TRUE);
+        start = end;
+    }
+    set_color_raw(g_drawstate.draw_color);
+    return retcode != 0 ? ERROR_DRAW_LINE : 0;
+}
+
+int S2D_drawLines(const Vector* points, int count, const Uint32* colors){
+    if (colors != NULL) return draw_colored_lines(NULL, (const SDL_Point*) points, count, colors);
+    return render_points(NULL, (const SDL_Point*) points, count, TRUE) != 0 ? ERROR_DRAW_LINE : 0;
+}
+
+int S2D_drawLinesF(const fVector* points, int count, const Uint32* colors){
+    if (colors != NULL) return draw_colored_lines((const SDL_FPoint*) points, NULL, count, colors);
+    return render_points((const SDL_FPoint*) points, NULL, count, TRUE) != 0 ? ERROR_DRAW_LINE : 0;
+}
+
+
+
+static internal_texture_data* texture_data_alloc(){
+    texture_data_slot* slot = g_free_texture_data;
+    if (slot != NULL){
+        g_free_texture_data = slot->next;
+        return &slot->data;
+    }
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    return malloc(sizeof(texture_data_slot));
+}
+
+static void texture_data_free(internal_texture_data* idata){
+    texture_data_slot* slot = (texture_data_slot*) idata;
+    slot->next = g_free_texture_data;
+    g_free_texture_data = slot;
+}
+
+// the shared INDEX8 palette, lut maps RGB555 colors to the nearest opaque entry
+static Uint32 g_palette[256];
+static int g_palette_size;
+static int g_palette_transparent = -1;
+static Uint8 g_palette_lut[1 << 15];
+
+void S2D_setTextureStorage(TextureStorage storage){
+    g_texture_storage = storage;
+}
+
+int S2D_setTexturePalette(const Uint32 *colors, int count){
+    if (colors == NULL || count <= 0 || count > 256) return ERROR_CREATE_TEXTURE;
+    g_palette_transparent = -1;
+    for (int i = 0; i < count; i++){
+        g_palette[i] = colors[i];
+        if (g_palette_transparent < 0 && colors[i] >> 24 == 0) g_palette_transparent = i;
+    }
+    for (int i = count; i < 256; i++) g_palette[i] = 0;
+    g_palette_size = count;
+
+    for (int c = 0; c < (1 << 15); c++){
+        int r = (c >> 10) << 3 | 4, g = ((c >> 5) & 0x1F) << 3 | 4, b = (c & 0x1F) << 3 | 4;
+        int best = 0, best_d = 0x7FFFFFFF;
+        for (int i = 0; i < count; i++){
+            if (colors[i] >> 24 < 128) continue;
+            int dr = r - (int)(colors[i] & 0xFF), dg = g - (int)((colors[i] >> 8) & 0xFF), db = b - (int)((colors[i] >> 16) & 0xFF);
+            int d = dr*dr + dg*dg + db*db;
+            if (d < best_d) best_d = d, best = i;
+        }
+        g_palette_lut[c] = (Uint8) best;
+    }
+    return 0;
+}
+
+static Uint8 storage_bytes(TextureStorage storage){
+    switch (storage){
+        case STORAGE_RGB565: case STORAGE_ARGB4444: return 2;
+        case STORAGE_A8: case STORAGE_INDEX8: return 1;
+        default: return INTERNAL_PIXEL_SIZE;
+    }
+}
+
+static Uint32 storage_SDL2(TextureStorage storage){
+    switch (storage){
+        case STORAGE_RGB565: return SDL_PIXELFORMAT_RGB565;
+        case STORAGE_ARGB4444: return SDL_PIXELFORMAT_ARGB4444;
+        case STORAGE_INDEX8: return SDL_PIXELFORMAT_INDEX8;
+        case STORAGE_A8: return SDL_PIXELFORMAT_UNKNOWN;
+        default: return INTERNAL_PIXEL_FORMAT;
+    }
+}
+
+// the most bytes of expanded pixels held at once while uploading A8 and INDEX8 textures
+#define UPLOAD_BAND_BYTES (256*1024)
+
+/*
+    A8 and INDEX8 have no SDL texture format, they are expanded to RGBA32 for the upload. The expansion goes
+    one band of rows at a time through a buffer of the context kept for later uploads, which is bounded by
+    the band size, so a large texture neither leaves a buffer of its full size around nor grows the frame
+    arena of the uploading thread.
+*/
+static int uploadPixels(SDL_Texture *texture, const Texture *txt){
+    if (txt->storage != STORAGE_A8 && txt->storage != STORAGE_INDEX8)
+        return SDL_UpdateTexture(texture, NULL, txt->pixels, txt->pitch);
+    int pitch = txt->width * INTERNAL_PIXEL_SIZE;
+    int band_rows = SDL_max(SDL_min(UPLOAD_BAND_BYTES / pitch, txt->height), 1);
+    size_t size = (size_t) pitch * band_rows;
+    if (g_upload_buffer == NULL || g_upload_size < size){
+        Uint8 *buffer = realloc(g_upload_buffer, size);
+        if (buffer == NULL) return -1;
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+        g_upload_buffer = buffer;
+        g_upload_size = size;
+    }
+    Uint8 *rgba = g_upload_buffer;
+    int retcode = 0;
+    for (int y = 0; y < txt->height && retcode == 0; y += band_rows){
+        int rows = SDL_min(band_rows, txt->height - y);
+        const Uint8 *src = (const Uint8*) txt->pixels + (size_t) y * txt->pitch;
+        if (txt->storage == STORAGE_A8) expand_a8_to_rgba32(src, txt->pitch, rgba, pitch, txt->width, rows);
+        else expand_index8_to_rgba32(src, txt->pitch, rgba, pitch, txt->width, rows, g_palette);
+        SDL_Rect band = {0, y, txt->width, rows};
+        retcode = SDL_UpdateTexture(texture, &band, rgba, pitch);
+    }
+    return retcode;
+}
+
+// converts a surface in INTERNAL_PIXEL_FORMAT into a compact storage copy owned by the texture
+static int compactSurface(SDL_Surface *surf, Texture *text){
+    int pitch = (surf->w * text->bytes_per_pixel + 3) & ~3;
+    Uint8 *pixels = malloc((size_t) pitch * surf->h);
+    if (pixels == NULL) return ERROR_CREATE_TEXTURE;
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    switch (text->storage){
+        case STORAGE_RGB565: convert_rgba32_to_rgb565(surf->pixels, surf->pitch, pixels, pitch, surf->w, surf->h); break;
+        case STORAGE_ARGB4444: convert_rgba32_to_argb4444(surf->pixels, surf->pitch, pixels, pitch, surf->w, surf->h); break;
+        case STORAGE_A8: convert_rgba32_to_a8(surf->pixels, surf->pitch, pixels, pitch, surf->w, surf->h); break;
+        default: convert_rgba32_to_index8(surf->pixels, surf->pitch, pixels, pitch, surf->w, surf->h, g_palette_lut, g_palette_transparent); break;
+    }
+    text->pixels = pixels;
+    text->pitch = pitch;
+    return 0;
+}
+
+typedef struct {
+    const Texture *text;
+    Uint32 format;
+    SDL_Texture *texture;
+} gpu_texture_args;
+
+// creates and fills the SDL texture, on the thread owning the renderer
+static int createGpuTexture(void *data){
+    gpu_texture_args *args = data;
+    args->texture = SDL_CreateTexture(g_RENDERER, args->format, SDL_TEXTUREACCESS_STATIC, args->text->width, args->text->height);
+    if (args->texture == NULL) return -1;
+    if (uploadPixels(args->texture, args->text) != 0){
+        SDL_DestroyTexture(args->texture);
+        args->texture = NULL;
+        return -1;
+    }
+    SDL_SetTextureBlendMode(args->texture, SDL_BLENDMODE_BLEND);
+    return 0;
+}
+
+static int destroyGpuTexture(void *texture){
+    SDL_DestroyTexture(texture);
+    return 0;
+}
+
+/*
+    uploads a surface in INTERNAL_PIXEL_FORMAT stored in the current storage format.
+    RGBA32 keeps the surface as the texture pixel memory, compact formats free it after converting.
+    On failure the caller keeps the surface.
+*/
+static int uploadSurface(SDL_Surface *surf, Texture *text, bool owns_pixels){
+    TextureStorage storage = g_texture_storage;
+    if (storage == STORAGE_INDEX8 && g_palette_size == 0) return ERROR_CREATE_TEXTURE;
+    text->storage = storage;
+    text->formatcode = storage_SDL2(storage);
+    text->width = surf->w;
+    text->height = surf->h;
+    text->bytes_per_pixel = storage_bytes(storage);
+    text->pixels = surf->pixels;
+    text->pitch = surf->pitch;
+    if (storage != STORAGE_RGBA32 && compactSurface(surf, text) != 0) return ERROR_CREATE_TEXTURE;
+
+    gpu_texture_args args = {text, storage == STORAGE_RGB565 || storage == STORAGE_ARGB4444 ? text->formatcode : INTERNAL_PIXEL_FORMAT, NULL};
+    internal_texture_data *idata = NULL;
+    if (rt_call(createGpuTexture, &args) != 0 || (idata = texture_data_alloc()) == NULL){
+        if (args.texture != NULL) rt_call(destroyGpuTexture, args.texture);
+        if (storage != STORAGE_RGBA32) free(text->pixels);
+        text->pixels = NULL;
+        return ERROR_CREATE_TEXTURE;
+    }
+
+    idata->texture = args.texture;
+    idata->surface = storage == STORAGE_RGBA32 ? surf : NULL;
+    idata->owns_pixels = storage == STORAGE_RGBA32 ? owns_pixels : TRUE;
+    idata->mapping = NULL;
+    idata->mapping_size = 0;
+    idata->tiled = NULL;
+    if (storage != STORAGE_RGBA32) SDL_FreeSurface(surf);
+    text->internal_ = (void *)idata;
+    return 0;
+}
 
-static int surfaceToTexture(SDL_Surface *surf, Texture *text){
+/*
+    Converts a surface to the internal format with the specialized blitters, other formats and color keyed
+    surfaces go through SDL's generic conversion. The source surface is not freed.
+*/
+static SDL_Surface* convertSurface(SDL_Surface *surf){
+    int format = pixelformat_S2D(surf->format->format);
+    if (format < 0 || SDL_HasColorKey(surf) || SDL_MUSTLOCK(surf)) return SDL_ConvertSurfaceFormat(surf, INTERNAL_PIXEL_FORMAT, 0);
+    SDL_Surface *converted = SDL_CreateRGBSurfaceWithFormat(0, surf->w, surf->h, 32, INTERNAL_PIXEL_FORMAT);
+    if (converted == NULL) return NULL;
+    if (S2D_blitPixels(surf->pixels, surf->w, surf->h, surf->pitch, format,
+        converted->pixels, surf->w, surf->h, converted->pitch, PIXEL_FORMAT_RGBA32, BLEND_NONE) != 0){
+        SDL_FreeSurface(converted);
+        return NULL;
+    }
+    return converted;
+}
+
+// cache_path: the source file of the surface, the converted pixels are stored in the texture cache under it, or NULL
+static int surfaceToTexture(SDL_Surface *surf, Texture *text, const char *cache_path){
+    int retcode;
     if (surf == NULL)
         return ERROR_CREATE_TEXTURE;
+    TRACE_BEGIN("surfaceToTexture");
 
-    SDL_Surface *converted_surf = SDL_ConvertSurfaceFormat(surf, INTERNAL_PIXEL_FORMAT, 0);
-    if (converted_surf == NULL)
-    {
+    // surfaces already in the internal format are used as they are
+    if (surf->format->format != INTERNAL_PIXEL_FORMAT){
+        SDL_Surface *converted_surf = convertSurface(surf);
         SDL_FreeSurface(surf);
+        if (converted_surf == NULL)
+        {
+            TRACE_END();
+            return ERROR_CREATE_TEXTURE;
+        }
+        surf = converted_surf;
+    }
+    if (cache_path != NULL) texcache_store(cache_path, surf);
+
+    if ((retcode = uploadSurface(surf, text, FALSE)) != 0) SDL_FreeSurface(surf);
+    TRACE_END();
+    return retcode;
+}
+
+int S2D_createTextureFromPixels(void *pixels, int w, int h, int pitch, PixelFormat format, int flags, Texture *txt){
+    int retcode;
+    Uint32 sdl_format = pixelformat_SDL2(format);
+    bool owns_pixels = (flags & TEXTURE_BORROWED) == 0;
+    if (pixels == NULL || (sdl_format == SDL_PIXELFORMAT_UNKNOWN && format != PIXEL_FORMAT_A8)) return ERROR_CREATE_TEXTURE;
+    TRACE_BEGIN("S2D_createTextureFromPixels");
+
+    SDL_Surface *surf;
+    if (sdl_format == INTERNAL_PIXEL_FORMAT){
+        // wraps the caller memory without copying
+        surf = SDL_CreateRGBSurfaceWithFormatFrom(pixels, w, h, SDL_BITSPERPIXEL(sdl_format), pitch, sdl_format);
+    } else {
+        surf = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, INTERNAL_PIXEL_FORMAT);
+        if (surf != NULL && S2D_blitPixels(pixels, w, h, pitch, format, surf->pixels, w, h, surf->pitch, PIXEL_FORMAT_RGBA32, BLEND_NONE) != 0){
+            SDL_FreeSurface(surf);
+            surf = NULL;
+        }
+    }
+    if (surf == NULL){
+        TRACE_END();
         return ERROR_CREATE_TEXTURE;
     }
 
-    text->formatcode = converted_surf->format->format;
-    text->pixels = converted_surf->pixels;
-    text->pitch = converted_surf->pitch;
-    text->width = converted_surf->w;
-    text->height = converted_surf->h;
-    text->bytes_per_pixel = converted_surf->format->BytesPerPixel;
+    bool converted = sdl_format != INTERNAL_PIXEL_FORMAT;
+    if ((retcode = uploadSurface(surf, txt, owns_pixels && !converted)) != 0) SDL_FreeSurface(surf);
+    // a converted or compact copy replaces the caller memory, which is released right away if it was handed over
+    else if (txt->pixels != pixels && owns_pixels) free(pixels);
+    TRACE_END();
+    return retcode;
+}
 
-    SDL_FreeSurface(surf);
+int S2D_createTexture(const char *file, Texture* text){
+    int retcode;
+    TRACE_BEGIN("S2D_createTexture");
+    SDL_RWops* rw = pack_open(file);
+    void* mapping;
+    size_t mapping_size;
+    // a valid texture cache entry is mapped and uploaded without decoding, RGBA32 textures keep the mapping as pixel memory
+    SDL_Surface* surf = rw == NULL ? texcache_load(file, &mapping, &mapping_size) : NULL;
+    if (surf != NULL){
+        if ((retcode = uploadSurface(surf, text, FALSE)) != 0) SDL_FreeSurface(surf);
+        if (retcode != 0 || text->storage != STORAGE_RGBA32) unmap_file(mapping, mapping_size);
+        else {
+            internal_texture_data* idata = (internal_texture_data*) text->internal_;
+            idata->mapping = mapping;
+            idata->mapping_size = mapping_size;
+        }
+        TRACE_END();
+        return retcode;
+    }
+    surf = rw != NULL ? IMG_Load_RW(rw, 1) : IMG_Load(file);
+    retcode = surfaceToTexture(surf, text, rw == NULL ? file : NULL);
+    TRACE_END();
+    return retcode;
+}
 
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(g_RENDERER, converted_surf);
+int S2D_createTiledTexture(const char *file, int tile_size, Texture *txt){
+    TRACE_BEGIN("S2D_createTiledTexture");
+    SDL_RWops* rw = pack_open(file);
+    void* mapping = NULL;
+    size_t mapping_size = 0;
+    SDL_Surface* surf = rw == NULL ? texcache_load(file, &mapping, &mapping_size) : NULL;
+    if (surf == NULL){
+        surf = rw != NULL ? IMG_Load_RW(rw, 1) : IMG_Load(file);
+        if (surf != NULL && surf->format->format != INTERNAL_PIXEL_FORMAT){
+            SDL_Surface *converted = convertSurface(surf);
+            SDL_FreeSurface(surf);
+            surf = converted;
+        }
+        // the decoded copy is replaced by a mapping of its cache entry, which the system can page out
+        if (surf != NULL && rw == NULL){
+            texcache_store(file, surf);
+            SDL_Surface* cached = texcache_load(file, &mapping, &mapping_size);
+            if (cached != NULL){
+                SDL_FreeSurface(surf);
+                surf = cached;
+            }
+        }
+    }
 
-    if (texture == NULL)
+    tiled_texture* tiled = surf != NULL ? tiled_create(surf->w, surf->h, tile_size) : NULL;
+    internal_texture_data *idata = tiled != NULL ? texture_data_alloc() : NULL;
+    if (idata == NULL){
+        if (tiled != NULL) tiled_destroy(tiled);
+        SDL_FreeSurface(surf);
+        unmap_file(mapping, mapping_size);
+        TRACE_END();
         return ERROR_CREATE_TEXTURE;
+    }
+    idata->texture = NULL;
+    idata->surface = surf;
+    idata->owns_pixels = FALSE;
+    idata->mapping = mapping;
+    idata->mapping_size = mapping_size;
+    idata->tiled = tiled;
+    txt->storage = STORAGE_RGBA32;
+    txt->formatcode = INTERNAL_PIXEL_FORMAT;
+    txt->width = surf->w;
+    txt->height = surf->h;
+    txt->bytes_per_pixel = INTERNAL_PIXEL_SIZE;
+    txt->pixels = surf->pixels;
+    txt->pitch = surf->pitch;
+    txt->internal_ = (void *)idata;
+    TRACE_END();
+    return 0;
+}
 
-    internal_texture_data *idata = malloc(sizeof(internal_texture_data));
-    idata->texture = texture;
-    idata->surface = converted_surf;
-    text->internal_ = (void *)idata;
+typedef struct {
+    SDL_Texture *texture;
+    Uint32 rgba;
+} tint_args;
+
+static int setTint(void *data){
+    tint_args *args = data;
+    SDL_Color c = color_SDL2(args->rgba);
+    SDL_SetTextureColorMod(args->texture, c.r, c.g, c.b);
+    SDL_SetTextureAlphaMod(args->texture, c.a);
     return 0;
 }
 
-int S2D_createTexture(const char *file, Texture* text){
-    SDL_Surface* surf = IMG_Load(file);
-    return surfaceToTexture(surf, text);
+int S2D_setTextureTint(Texture *txt, Uint32 rgba){
+    internal_texture_data* idata = (internal_texture_data*) txt->internal_;
+    if (idata == NULL) return ERROR_DESTROYED_TEXTURE;
+    if (idata->tiled != NULL) return tiled_set_tint(idata->tiled, rgba);
+    tint_args args = {idata->texture, rgba};
+    return rt_call(setTint, &args);
 }
 
 void S2D_destroyTexture(Texture *txt){
-    SDL_DestroyTexture(((internal_texture_data*)txt->internal_)->texture);
-    SDL_FreeSurface(((internal_texture_data*)txt->internal_)->surface);
-    free((internal_texture_data*)txt->internal_);
+    internal_texture_data* idata = (internal_texture_data*) txt->internal_;
+    if (idata->tiled != NULL) tiled_destroy(idata->tiled);
+    else rt_call(destroyGpuTexture, idata->texture);
+    SDL_FreeSurface(idata->surface);
+    if (idata->owns_pixels) free(txt->pixels);
+    unmap_file(idata->mapping, idata->mapping_size);
+    texture_data_free(idata);
     txt->internal_ = NULL;
     txt->pixels = NULL;
 }
@@ -318,20 +807,78 @@ void* safeAccessTexturePixel(Texture* txt, unsigned int x_pixel, unsigned int y_
 
 
 int S2D_drawTexture(Texture* txt, Rectangle* rect){
+    internal_texture_data* idata = (internal_texture_data*) txt->internal_;
+    if (idata == NULL) return ERROR_DRAW_TEXTURE;
+    if (idata->tiled != NULL) return tiled_draw(idata->tiled, txt, rect);
+    SDL_Texture* text = idata->texture;
+    SDL_FRect sdlRect = {rect->origin.x, rect->origin.y, rect->w, rect->h};
+    return render_copy(text, NULL, &sdlRect);
+}
+
+int S2D_drawTextureInstances(Texture* txt, const S2D_Instance* inst, int n){
     if (txt->internal_ == NULL) return ERROR_DRAW_TEXTURE;
+    if (n <= 0) return 0;
     SDL_Texture* text = ((internal_texture_data*)txt->internal_)->texture;
-    SDL_Rect sdlRect;
-    convert_rectange_SDL2(rect, &sdlRect);
-    return SDL_RenderCopy(g_RENDERER, text, NULL, &sdlRect);
+    if (text == NULL) return ERROR_DRAW_TEXTURE;
+    if (batch_reserve(&g_batch, 4*n, 6*n) != 0) return ERROR_DRAW_TEXTURE;
+
+    float inv_w = 1.0f / txt->width, inv_h = 1.0f / txt->height;
+    SDL_Vertex* v = g_batch.vertices;
+    int* idx = g_batch.indices;
+    int kept = 0;
+    for (int i = 0; i < n; i++){
+        const S2D_Instance* in = &inst[i];
+        // the circle around a rotated instance bounds it, which is cheaper than rotating the corners
+        float r = in->rotation != 0.0f ? SDL_sqrtf((float) in->dst.w*in->dst.w + (float) in->dst.h*in->dst.h) * 0.5f : 0;
+        float mx = in->dst.origin.x + in->dst.w * 0.5f, my = in->dst.origin.y + in->dst.h * 0.5f;
+        if (r > 0 ? camera_cull(mx - r, my - r, mx + r, my + r)
+                  : camera_cull(in->dst.origin.x, in->dst.origin.y, in->dst.origin.x + in->dst.w, in->dst.origin.y + in->dst.h)) continue;
+
+        float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+        if (in->src.w > 0 && in->src.h > 0){
+            u0 = in->src.origin.x * inv_w, u1 = (in->src.origin.x + in->src.w) * inv_w;
+            v0 = in->src.origin.y * inv_h, v1 = (in->src.origin.y + in->src.h) * inv_h;
+        }
+        if (in->flip & FLIP_HORIZONTAL){ float t = u0; u0 = u1; u1 = t; }
+        if (in->flip & FLIP_VERTICAL){ float t = v0; v0 = v1; v1 = t; }
+
+        // corners relative to the rectangle center, rotated clockwise like SDL_RenderCopyEx
+        float hw = in->dst.w * 0.5f, hh = in->dst.h * 0.5f;
+        float cx = in->dst.origin.x + hw, cy = in->dst.origin.y + hh;
+        float c = 1.0f, s = 0.0f;
+        if (in->rotation != 0.0f){
+            float rad = in->rotation * (float) M_PI / 180.0f;
+            c = SDL_cosf(rad), s = SDL_sinf(rad);
+        }
+        float ax = hw*c, ay = hw*s, bx = -hh*s, by = hh*c;
+        SDL_Color tint = color_SDL2(in->tint);
+        v[0] = (SDL_Vertex){{cx - ax - bx, cy - ay - by}, tint, {u0, v0}};
+        v[1] = (SDL_Vertex){{cx + ax - bx, cy + ay - by}, tint, {u1, v0}};
+        v[2] = (SDL_Vertex){{cx + ax + bx, cy + ay + by}, tint, {u1, v1}};
+        v[3] = (SDL_Vertex){{cx - ax + bx, cy - ay + by}, tint, {u0, v1}};
+        int base = 4*kept;
+        idx[0] = base, idx[1] = base + 1, idx[2] = base + 2;
+        idx[3] = base, idx[4] = base + 2, idx[5] = base + 3;
+        v += 4, idx += 6;
+        kept++;
+    }
+    g_batch.vertex_count = 4*kept;
+    g_batch.index_count = 6*kept;
+    return batch_submit(&g_batch, text, kept) != 0 ? ERROR_DRAW_TEXTURE : 0;
+}
+
+static int updateGpuTexture(void *data){
+    const Texture *txt = data;
+    return uploadPixels(((internal_texture_data*) txt->internal_)->texture, txt);
 }
 
 int S2D_updateTexture(Texture* txt){
     internal_texture_data* idata = (internal_texture_data*) txt->internal_;
-    SDL_Texture* newText = SDL_CreateTextureFromSurface(g_RENDERER,idata->surface);
-    if (newText == NULL) return ERROR_CREATE_TEXTURE;
-    SDL_DestroyTexture(idata->texture);
-    idata->texture = newText;
-    return 0;
+    if (idata == NULL) return ERROR_DESTROYED_TEXTURE;
+    TRACE_BEGIN("S2D_updateTexture");
+    int retcode = idata->tiled != NULL ? tiled_update(idata->tiled, txt) : rt_call(updateGpuTexture, txt);
+    TRACE_END();
+    return retcode != 0 ? ERROR_CREATE_TEXTURE : 0;
 }
 
 
@@ -343,16 +890,26 @@ int S2D_drawTextureNative(Texture* txt, Vector origin){
 
 int S2D_createUTF8Texture (Texture* txt, StringRenderData* d){
     int retcode;
+    TRACE_BEGIN("S2D_createUTF8Texture");
     TTF_Init();
     //TTF_SetDirection(d->string_write_direction); bugged doesnt work
-    TTF_Font* font = TTF_OpenFont(d->font_fpath, d->font_size);
-    if (font == NULL) return ERROR_CREATE_TEXTURE;
+    SDL_RWops* rw = pack_open(d->font_fpath);
+    TTF_Font* font = rw != NULL ? TTF_OpenFontRW(rw, 1, d->font_size) : TTF_OpenFont(d->font_fpath, d->font_size);
+    if (font == NULL) {
+        TRACE_END();
+        return ERROR_CREATE_TEXTURE;
+    }
     Color m = d->foreground_color;
     SDL_Color sdlC= {.r = m.R, .g = m.G, .b = m.B, .a = m.A}; //uughh
     SDL_Surface* surf = TTF_RenderUTF8_Solid_Wrapped(font, d->string, sdlC, d->wrapLength);
-    if (surf == NULL) return ERROR_CREATE_TEXTURE;
-    retcode = surfaceToTexture(surf, txt);
+    if (surf == NULL) {
+        TRACE_END();
+        return ERROR_CREATE_TEXTURE;
+    }
+    retcode = surfaceToTexture(surf, txt, NULL);
+    if (retcode == 0 && txt->storage == STORAGE_A8) S2D_setTextureTint(txt, S2D_colorStructToHex(m));
     TTF_Quit();
+    TRACE_END();
     return retcode;
 }
 
@@ -366,25 +923,54 @@ void S2D_setStringRenderData(StringRenderData* d, char* font_fpath, stringWriteD
 }
 
 void S2D_presentRender (){
-    return SDL_RenderPresent(g_RENDERER);
+    TRACE_BEGIN("S2D_presentRender");
+    internal_res_present();
+    rt_present();
+    input_frame();
+    profiler_frame();
+    internal_res_frame();
+    frame_stats_rollover();
+    frame_arena_advance();
+    TRACE_END();
 }
 
 
+typedef struct {
+    SDL_Rect rect;
+    void *pixels;
+    int pitch;
+} readback_args;
+
+static int readPixels(void *data){
+    readback_args *args = data;
+    return SDL_RenderReadPixels(g_RENDERER, &args->rect, INTERNAL_PIXEL_FORMAT, args->pixels, args->pitch);
+}
+
 int S2D_readRendererPixelData(Rectangle* rect, RendererPixels* rpx){
     void* pixelData;
     int pitch;
     SDL_Rect rectSdl;
     int retcode;
     if(rect == NULL){
+        // the pixels drawn, fewer than the draw size while dynamic resolution lowered it
         rectSdl.x = 0, rectSdl.y = 0;
-        rectSdl.w = g_drawstate.draw_w;
-        rectSdl.h = g_drawstate.draw_h;
+        S2D_getInternalResolution(&rectSdl.w, &rectSdl.h);
     } else {
         convert_rectange_SDL2(rect, &rectSdl);
     }
-    pixelData = malloc(rectSdl.h * rectSdl.w * INTERNAL_PIXEL_SIZE);
+    TRACE_BEGIN("S2D_readRendererPixelData");
+    size_t size = (size_t) rectSdl.h * rectSdl.w * INTERNAL_PIXEL_SIZE;
+    if (g_readback_buffer != NULL && g_readback_size >= size){
+        pixelData = g_readback_buffer;
+        g_readback_buffer = NULL;
+    } else {
+        pixelData = malloc(size);
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+    }
     pitch = rectSdl.w * INTERNAL_PIXEL_SIZE;
-    retcode = SDL_RenderReadPixels(g_RENDERER, &rectSdl, INTERNAL_PIXEL_FORMAT, pixelData, pitch);
+    readback_args args = {rectSdl, pixelData, pitch};
+    retcode = rt_call(readPixels, &args);
+    TRACE_END();
     rpx->h = rectSdl.h, rpx->w = rectSdl.w;
     rpx->origin.x = rectSdl.x, rpx->origin.y = rectSdl.y;
     rpx->pitch = pitch;
@@ -395,7 +981,15 @@ int S2D_readRendererPixelData(Rectangle* rect, RendererPixels* rpx){
 
 void S2D_freeRendererPixelData(RendererPixels* rpx){
     if (rpx->pixelData != NULL){
-        free(rpx->pixelData);
+        // the most recent buffer is cached, so reading back every frame does not allocate
+        size_t size = (size_t) rpx->h * rpx->pitch;
+        if (g_readback_buffer == NULL || size > g_readback_size){
+            free(g_readback_buffer);
+            g_readback_buffer = rpx->pixelData;
+            g_readback_size = size;
+        } else {
+            free(rpx->pixelData);
+        }
         rpx->pixelData = NULL;
     }
 }
@@ -423,7 +1017,13 @@ void S2D_addMouseEventHandler(void (*fun_ptr) (MouseEvent*, void*)){
 }
 
 Uint32 S2D_getTicks(){
-    return SDL_GetTicks();
+    return input_ticks();
+}
+
+Uint64 S2D_getTimeNs(){
+    Uint64 counter = SDL_GetPerformanceCounter(), freq = SDL_GetPerformanceFrequency();
+    // split so the multiplication does not overflow
+    return counter / freq * 1000000000 + counter % freq * 1000000000 / freq;
 }
 
 S2D_timerID S2D_setInterval(Uint32 interval_ms, Uint32 (*callbackFn) (Uint32, void*), void* callBackParam){
@@ -451,5 +1051,6 @@ Uint32 S2D_colorStructToHex (Color color){
 
 
 void S2D_delay(int ms){
+    if (input_replay_fast()) return;
     SDL_Delay(ms);
 }
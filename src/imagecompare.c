@@ -0,0 +1,314 @@
+#include "internal.h"
+#include <SDL2/SDL_image.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/*
+    Image comparison for golden image tests
+
+    Rows are compared on the worker pool, a span of pixels at a time between the masked regions.
+    The per channel absolute difference is taken with saturating subtractions both ways, a pixel
+    differs when any channel exceeds the tolerance after subtracting it. SSE2 handles 4 pixels per
+    iteration, AVX2 8, counting the pixels within tolerance per lane so no movemask is needed.
+    The diff image is only made once the images are known to differ.
+*/
+
+#define COMPARE_ROWS_PER_CHUNK 32
+
+typedef struct {
+    int x0, y0, x1, y1;
+} mask_rect;
+
+typedef struct {
+    Uint64 differing;
+    int max_diff;
+    int first_x, first_y;
+} chunk_result;
+
+typedef struct {
+    const RendererPixels* a;
+    const RendererPixels* b;
+    Uint8 tolerance;
+    const mask_rect* masks;     // sorted by x0
+    int mask_count;
+    chunk_result* results;
+} compare_job;
+
+// counts the pixels with a channel differing by more than tol, raises max_diff to the largest channel difference
+static int diff_span(const Uint8* a, const Uint8* b, int n, Uint8 tol, int* max_diff){
+    int within = 0, i = 0, m = 0;
+#if defined(__AVX2__)
+    __m256i vtol = _mm256_set1_epi8((char) tol), zero = _mm256_setzero_si256();
+    __m256i vmax = zero, count = zero;
+    for (; i + 8 <= n; i += 8){
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + 4*i)), y = _mm256_loadu_si256((const __m256i*)(b + 4*i));
+        __m256i d = _mm256_or_si256(_mm256_subs_epu8(x, y), _mm256_subs_epu8(y, x));
+        vmax = _mm256_max_epu8(vmax, d);
+        // all ones for the pixels with every channel within tolerance, subtracting counts them
+        count = _mm256_sub_epi32(count, _mm256_cmpeq_epi32(_mm256_subs_epu8(d, vtol), zero));
+    }
+    Uint8 maxes[32];
+    Sint32 counts[8];
+    _mm256_storeu_si256((__m256i*) maxes, vmax);
+    _mm256_storeu_si256((__m256i*) counts, count);
+    for (int k = 0; k < 32; k++) m = SDL_max(m, maxes[k]);
+    for (int k = 0; k < 8; k++) within += counts[k];
+#elif defined(__SSE2__)
+    __m128i vtol = _mm_set1_epi8((char) tol), zero = _mm_setzero_si128();
+    __m128i vmax = zero, count = zero;
+    for (; i + 4 <= n; i += 4){
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + 4*i)), y = _mm_loadu_si128((const __m128i*)(b + 4*i));
+        __m128i d = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+        vmax = _mm_max_epu8(vmax, d);
+        count = _mm_sub_epi32(count, _mm_cmpeq_epi32(_mm_subs_epu8(d, vtol), zero));
+    }
+    Uint8 maxes[16];
+    Sint32 counts[4];
+    _mm_storeu_si128((__m128i*) maxes, vmax);
+    _mm_storeu_si128((__m128i*) counts, count);
+    for (int k = 0; k < 16; k++) m = SDL_max(m, maxes[k]);
+    for (int k = 0; k < 4; k++) within += counts[k];
+#endif
+    int differing = i - within;
+    for (; i < n; i++){
+        bool over = FALSE;
+        for (int c = 0; c < 4; c++){
+            int d = SDL_abs(a[4*i + c] - b[4*i + c]);
+            if (d > m) m = d;
+            if (d > tol) over = TRUE;
+        }
+        differing += over;
+    }
+    if (m > *max_diff) *max_diff = m;
+    return differing;
+}
+
+static bool pixel_differs(const Uint8* a, const Uint8* b, Uint8 tol){
+    for (int c = 0; c < 4; c++){
+        if (SDL_abs(a[c] - b[c]) > tol) return TRUE;
+    }
+    return FALSE;
+}
+
+// the first differing pixel of [x0, x1), -1 if none
+static int first_differing(const Uint8* a, const Uint8* b, int x0, int x1, Uint8 tol){
+    for (int x = x0; x < x1; x++){
+        if (pixel_differs(a + 4*x, b + 4*x, tol)) return x;
+    }
+    return -1;
+}
+
+// a range may cover several chunks when it runs on one thread, every row adds to the result of its chunk
+static void compare_rows(int begin, int end, void* arg){
+    compare_job* job = arg;
+    const RendererPixels* a = job->a;
+    const RendererPixels* b = job->b;
+    for (int y = begin; y < end; y++){
+        chunk_result* res = &job->results[y / COMPARE_ROWS_PER_CHUNK];
+        const Uint8* ra = (const Uint8*) a->pixelData + (size_t) y * a->pitch;
+        const Uint8* rb = (const Uint8*) b->pixelData + (size_t) y * b->pitch;
+        // the spans between the masks covering the row, left to right
+        int x = 0;
+        for (int m = 0; m <= job->mask_count; m++){
+            int x0 = a->w, x1 = a->w;
+            if (m < job->mask_count){
+                const mask_rect* r = &job->masks[m];
+                if (y < r->y0 || y >= r->y1) continue;
+                x0 = r->x0, x1 = r->x1;
+            }
+            if (x0 > x){
+                int differing = diff_span(ra + 4*x, rb + 4*x, x0 - x, job->tolerance, &res->max_diff);
+                if (differing > 0 && res->first_y < 0){
+                    res->first_x = first_differing(ra, rb, x, x0, job->tolerance);
+                    res->first_y = y;
+                }
+                res->differing += differing;
+            }
+            x = SDL_max(x, x1);
+        }
+    }
+}
+
+static bool masked(const mask_rect* masks, int count, int x, int y){
+    for (int i = 0; i < count; i++){
+        if (x >= masks[i].x0 && x < masks[i].x1 && y >= masks[i].y0 && y < masks[i].y1) return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+    differing pixels red, brighter the larger the difference, the rest the dimmed reference in gray,
+    masked regions in blue
+*/
+static int write_diff_image(const char* path, const compare_job* job){
+    const RendererPixels* a = job->a;
+    const RendererPixels* b = job->b;
+    SDL_Surface* surf = SDL_CreateRGBSurfaceWithFormat(0, a->w, a->h, 32, INTERNAL_PIXEL_FORMAT);
+    if (surf == NULL) return -1;
+    for (int y = 0; y < a->h; y++){
+        const Uint8* ra = (const Uint8*) a->pixelData + (size_t) y * a->pitch;
+        const Uint8* rb = (const Uint8*) b->pixelData + (size_t) y * b->pitch;
+        Uint8* out = (Uint8*) surf->pixels + (size_t) y * surf->pitch;
+        for (int x = 0; x < a->w; x++){
+            const Uint8* pa = ra + 4*x;
+            const Uint8* pb = rb + 4*x;
+            Uint8* o = out + 4*x;
+            Uint8 gray = (Uint8)((pb[0] * 77 + pb[1] * 150 + pb[2] * 29) >> 10);
+            if (masked(job->masks, job->mask_count, x, y)){
+                o[0] = gray, o[1] = gray, o[2] = 128 + gray;
+            } else if (pixel_differs(pa, pb, job->tolerance)){
+                int d = 0;
+                for (int c = 0; c < 4; c++) d = SDL_max(d, SDL_abs(pa[c] - pb[c]));
+                o[0] = (Uint8)(128 + d / 2), o[1] = 0, o[2] = 0;
+            } else {
+                o[0] = o[1] = o[2] = gray;
+            }
+            o[3] = 255;
+        }
+    }
+    int code = IMG_SavePNG(surf, path);
+    SDL_FreeSurface(surf);
+    return code;
+}
+
+static void clear_diff(S2D_ImageDiff* diff){
+    diff->compared = 0;
+    diff->differing = 0;
+    diff->max_diff = 0;
+    diff->first.x = diff->first.y = -1;
+}
+
+int S2D_compareImages(const RendererPixels* image, const RendererPixels* reference, const S2D_CompareOptions* opt, S2D_ImageDiff* diff){
+    S2D_CompareOptions defaults = {0};
+    if (opt == NULL) opt = &defaults;
+    clear_diff(diff);
+    if (image->pixelData == NULL || reference->pixelData == NULL
+        || image->bytes_per_pixel != INTERNAL_PIXEL_SIZE || reference->bytes_per_pixel != INTERNAL_PIXEL_SIZE
+        || image->w != reference->w || image->h != reference->h
+        || opt->mask_count < 0 || (opt->mask_count > 0 && opt->masks == NULL)){
+        return ERROR_IMAGE_COMPARE;
+    }
+    if (image->w <= 0 || image->h <= 0) return 0;
+    TRACE_BEGIN("S2D_compareImages");
+
+    int chunks = (image->h + COMPARE_ROWS_PER_CHUNK - 1) / COMPARE_ROWS_PER_CHUNK;
+    chunk_result* results = S2D_frameAlloc(sizeof(chunk_result) * chunks, 0);
+    mask_rect* masks = opt->mask_count > 0 ? S2D_frameAlloc(sizeof(mask_rect) * opt->mask_count, 0) : NULL;
+    if (results == NULL || (opt->mask_count > 0 && masks == NULL)){
+        TRACE_END();
+        return ERROR_IMAGE_COMPARE;
+    }
+    // clipped masks sorted by x0, so every row walks them left to right
+    int mask_count = 0;
+    for (int i = 0; i < opt->mask_count; i++){
+        const Rectangle* r = &opt->masks[i];
+        mask_rect m = {SDL_max(r->origin.x, 0), SDL_max(r->origin.y, 0),
+            SDL_min(r->origin.x + r->w, image->w), SDL_min(r->origin.y + r->h, image->h)};
+        if (m.x0 >= m.x1 || m.y0 >= m.y1) continue;
+        int j = mask_count++;
+        for (; j > 0 && masks[j - 1].x0 > m.x0; j--) masks[j] = masks[j - 1];
+        masks[j] = m;
+    }
+
+    for (int i = 0; i < chunks; i++){
+        results[i].differing = 0;
+        results[i].max_diff = 0;
+        results[i].first_x = results[i].first_y = -1;
+    }
+    compare_job job = {image, reference, (Uint8) SDL_clamp(opt->tolerance, 0, 255), masks, mask_count, results};
+    parallel_for(image->h, COMPARE_ROWS_PER_CHUNK, compare_rows, &job);
+
+    for (int i = 0; i < chunks; i++){
+        diff->differing += results[i].differing;
+        diff->max_diff = SDL_max(diff->max_diff, results[i].max_diff);
+        if (diff->first.y < 0 && results[i].first_y >= 0){
+            diff->first.x = results[i].first_x;
+            diff->first.y = results[i].first_y;
+        }
+    }
+    // overlapping masks count once
+    Uint64 masked_pixels = 0;
+    for (int y = 0; y < image->h && mask_count > 0; y++){
+        int covered = 0;
+        for (int m = 0; m < mask_count; m++){
+            if (y < masks[m].y0 || y >= masks[m].y1) continue;
+            int x0 = SDL_max(masks[m].x0, covered);
+            if (masks[m].x1 > x0) masked_pixels += masks[m].x1 - x0;
+            covered = SDL_max(covered, masks[m].x1);
+        }
+    }
+    diff->compared = (Uint64) image->w * image->h - masked_pixels;
+
+    int code = 0;
+    if (diff->differing > opt->max_differing){
+        code = ERROR_IMAGE_MISMATCH;
+        if (opt->diff_path != NULL) write_diff_image(opt->diff_path, &job);
+    }
+    TRACE_END();
+    return code;
+}
+
+int S2D_loadImagePixels(const char* path, RendererPixels* rpx){
+    rpx->pixelData = NULL;
+    SDL_Surface* loaded = IMG_Load(path);
+    if (loaded == NULL) return ERROR_IMAGE_COMPARE;
+    SDL_Surface* surf = SDL_ConvertSurfaceFormat(loaded, INTERNAL_PIXEL_FORMAT, 0);
+    SDL_FreeSurface(loaded);
+    if (surf == NULL) return ERROR_IMAGE_COMPARE;
+
+    int pitch = surf->w * INTERNAL_PIXEL_SIZE;
+    void* pixels = malloc((size_t) surf->h * pitch);
+    if (pixels == NULL){
+        SDL_FreeSurface(surf);
+        return ERROR_IMAGE_COMPARE;
+    }
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    for (int y = 0; y < surf->h; y++){
+        memcpy((Uint8*) pixels + (size_t) y * pitch, (const Uint8*) surf->pixels + (size_t) y * surf->pitch, pitch);
+    }
+    rpx->origin.x = 0, rpx->origin.y = 0;
+    rpx->w = surf->w, rpx->h = surf->h;
+    rpx->pitch = pitch;
+    rpx->bytes_per_pixel = INTERNAL_PIXEL_SIZE;
+    rpx->pixelData = pixels;
+    SDL_FreeSurface(surf);
+    return 0;
+}
+
+int S2D_saveImagePixels(const char* path, const RendererPixels* rpx){
+    if (rpx->pixelData == NULL || rpx->bytes_per_pixel != INTERNAL_PIXEL_SIZE) return ERROR_IMAGE_COMPARE;
+    SDL_Surface* surf = SDL_CreateRGBSurfaceWithFormatFrom(rpx->pixelData, rpx->w, rpx->h, 32, rpx->pitch, INTERNAL_PIXEL_FORMAT);
+    if (surf == NULL) return ERROR_IMAGE_COMPARE;
+    int code = IMG_SavePNG(surf, path);
+    SDL_FreeSurface(surf);
+    return code != 0 ? ERROR_IMAGE_COMPARE : 0;
+}
+
+int S2D_checkGoldenFrame(const char* reference_path, const S2D_CompareOptions* opt, S2D_ImageDiff* diff){
+    RendererPixels frame, reference;
+    clear_diff(diff);
+    int code = S2D_readRendererPixelData(NULL, &frame);
+    if (code != 0){
+        S2D_freeRendererPixelData(&frame);
+        return ERROR_IMAGE_COMPARE;
+    }
+    SDL_RWops* rw = SDL_RWFromFile(reference_path, "rb");
+    if (rw == NULL){
+        // a missing reference is recorded from this frame
+        code = S2D_saveImagePixels(reference_path, &frame);
+    } else {
+        SDL_RWclose(rw);
+        code = S2D_loadImagePixels(reference_path, &reference);
+        if (code == 0){
+            code = S2D_compareImages(&frame, &reference, opt, diff);
+            S2D_freeRendererPixelData(&reference);
+        }
+    }
+    S2D_freeRendererPixelData(&frame);
+    return code;
+}
@@ -0,0 +1,478 @@
+#include "internal.h"
+#include <stdio.h>
+
+/*
+    Input recording and replay
+
+    A recording is the sequence of everything the application observed from the outside: the events
+    passed to the event handlers, the frame boundaries of S2D_presentRender and the results of
+    S2D_getTicks. Replaying hands them back in the same order, so an application whose behaviour only
+    depends on its input and S2D_getTicks runs the same frames again. Replay is kept in step by position,
+    not by time: polling returns the recorded events up to the next other record, S2D_getTicks returns
+    the recorded values, S2D_presentRender moves past the next frame boundary.
+
+    Only the thread that started the recording or replay records and replays S2D_getTicks, other
+    threads read the current recorded time.
+
+    File layout: the magic "S2DINPT1", the starting time in ms as a varint, then the records.
+    A record is a kind byte, the ms since the previous record as a varint, then its fields as varints,
+    signed fields zigzag encoded, floats as their 4 bytes little endian. Repeated S2D_getTicks results
+    are run length encoded, a TICKS record holds the number of calls that returned its time.
+*/
+
+#define MAGIC "S2DINPT1"
+#define MAGIC_SIZE 8
+#define RECORD_MAX 64
+#define MAX_FIELDS 7
+
+enum {
+    REC_FRAME, REC_TICKS, REC_QUIT, REC_KEY_DOWN, REC_KEY_UP,
+    REC_BUTTON_DOWN, REC_BUTTON_UP, REC_MOTION, REC_WHEEL
+};
+
+typedef struct {
+    FILE* file;
+    SDL_threadID owner;
+    Uint32 last;            // time of the previous record
+    Uint32 ticks;           // S2D_getTicks result not yet written
+    Uint32 ticks_calls;     // the number of calls that returned it, 0 for none
+} record_state;
+
+typedef struct {
+    void* mapping;
+    size_t size;
+    size_t pos;
+    SDL_threadID owner;
+    ReplayMode mode;
+    Uint32 time;            // time of the last consumed record
+    Uint32 ticks_calls;     // S2D_getTicks calls left to return time
+    Uint32 start;
+    Uint64 start_ns;
+} replay_state;
+
+static record_state g_record;
+static replay_state g_replay;
+static SDL_atomic_t g_replaying;
+static SDL_atomic_t g_replay_time;
+// added to SDL_GetTicks so the time continues from the recorded time once a replay ended
+static SDL_atomic_t g_ticks_offset;
+static bool g_atexit_registered = FALSE;
+
+static int put_varint(Uint8* p, Uint32 v){
+    int n = 0;
+    while (v >= 0x80){
+        p[n++] = (Uint8)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (Uint8) v;
+    return n;
+}
+
+static bool get_varint(const Uint8* p, size_t size, size_t* pos, Uint32* v){
+    Uint32 result = 0;
+    for (int shift = 0; shift < 35; shift += 7){
+        if (*pos >= size) return FALSE;
+        Uint8 b = p[(*pos)++];
+        result |= (Uint32)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0){
+            *v = result;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static Uint32 zigzag(Sint32 v){
+    return ((Uint32) v << 1) ^ (Uint32)(v >> 31);
+}
+
+static Sint32 unzigzag(Uint32 v){
+    return (Sint32)(v >> 1) ^ -(Sint32)(v & 1);
+}
+
+static Uint32 float_bits(float f){
+    Uint32 bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static Uint32 real_ticks(){
+    return SDL_GetTicks() + (Uint32) SDL_AtomicGet(&g_ticks_offset);
+}
+
+// the time events and frame boundaries are recorded with
+static Uint32 current_ticks(){
+    return SDL_AtomicGet(&g_replaying) ? (Uint32) SDL_AtomicGet(&g_replay_time) : real_ticks();
+}
+
+
+static void write_record(int kind, Uint32 time, const Uint32* fields, int count, const float* floats, int float_count){
+    Uint8 buf[RECORD_MAX];
+    int n = 0;
+    buf[n++] = (Uint8) kind;
+    n += put_varint(buf + n, time >= g_record.last ? time - g_record.last : 0);
+    for (int i = 0; i < count; i++) n += put_varint(buf + n, fields[i]);
+    for (int i = 0; i < float_count; i++){
+        Uint32 bits = float_bits(floats[i]);
+        for (int b = 0; b < 4; b++) buf[n++] = (Uint8)(bits >> (8 * b));
+    }
+    if (time > g_record.last) g_record.last = time;
+    fwrite(buf, 1, n, g_record.file);
+}
+
+static void flush_ticks(){
+    if (g_record.ticks_calls == 0) return;
+    Uint32 calls = g_record.ticks_calls;
+    g_record.ticks_calls = 0;
+    write_record(REC_TICKS, g_record.ticks, &calls, 1, NULL, 0);
+}
+
+// called by EventQueueFilter with every event passed to the event handlers
+void input_record_event(const SDL_Event* event){
+    if (g_record.file == NULL) return;
+    Uint32 f[MAX_FIELDS];
+    float precise[2];
+    int kind, count, float_count = 0;
+    switch (event->type){
+        case SDL_QUIT:
+            kind = REC_QUIT;
+            count = 0;
+            break;
+        case SDL_KEYDOWN: case SDL_KEYUP:
+            kind = event->type == SDL_KEYDOWN ? REC_KEY_DOWN : REC_KEY_UP;
+            f[0] = event->key.windowID;
+            f[1] = event->key.state;
+            f[2] = event->key.repeat;
+            f[3] = event->key.keysym.scancode;
+            f[4] = zigzag(event->key.keysym.sym);
+            f[5] = event->key.keysym.mod;
+            count = 6;
+            break;
+        case SDL_MOUSEBUTTONDOWN: case SDL_MOUSEBUTTONUP:
+            kind = event->type == SDL_MOUSEBUTTONDOWN ? REC_BUTTON_DOWN : REC_BUTTON_UP;
+            f[0] = event->button.windowID;
+            f[1] = event->button.which;
+            f[2] = event->button.button;
+            f[3] = event->button.state;
+            f[4] = event->button.clicks;
+            f[5] = zigzag(event->button.x);
+            f[6] = zigzag(event->button.y);
+            count = 7;
+            break;
+        case SDL_MOUSEMOTION:
+            kind = REC_MOTION;
+            f[0] = event->motion.windowID;
+            f[1] = event->motion.state;
+            f[2] = zigzag(event->motion.x);
+            f[3] = zigzag(event->motion.y);
+            f[4] = zigzag(event->motion.xrel);
+            f[5] = zigzag(event->motion.yrel);
+            f[6] = event->motion.which;
+            count = 7;
+            break;
+        case SDL_MOUSEWHEEL:
+            kind = REC_WHEEL;
+            f[0] = event->wheel.windowID;
+            f[1] = event->wheel.which;
+            f[2] = zigzag(event->wheel.x);
+            f[3] = zigzag(event->wheel.y);
+            f[4] = event->wheel.direction;
+            count = 5;
+            precise[0] = event->wheel.preciseX;
+            precise[1] = event->wheel.preciseY;
+            float_count = 2;
+            break;
+        default:
+            // the event handlers only see the kinds above
+            return;
+    }
+    flush_ticks();
+    write_record(kind, current_ticks(), f, count, precise, float_count);
+}
+
+
+static void replay_end(){
+    if (!SDL_AtomicGet(&g_replaying)) return;
+    // continue from the recorded time instead of jumping to the real one
+    SDL_AtomicSet(&g_ticks_offset, (int)(g_replay.time - SDL_GetTicks()));
+    SDL_AtomicSet(&g_replaying, 0);
+    unmap_file(g_replay.mapping, g_replay.size);
+    g_replay.mapping = NULL;
+}
+
+// reads the kind and time of the next record, body is set to the position of its fields
+static bool peek_record(int* kind, Uint32* time, size_t* body){
+    const Uint8* data = g_replay.mapping;
+    size_t pos = g_replay.pos;
+    Uint32 delta;
+    if (pos >= g_replay.size) return FALSE;
+    *kind = data[pos++];
+    if (!get_varint(data, g_replay.size, &pos, &delta)) return FALSE;
+    *time = g_replay.time + delta;
+    *body = pos;
+    return TRUE;
+}
+
+static bool read_fields(Uint32* f, int count, float* floats, int float_count){
+    const Uint8* data = g_replay.mapping;
+    for (int i = 0; i < count; i++){
+        if (!get_varint(data, g_replay.size, &g_replay.pos, &f[i])) return FALSE;
+    }
+    for (int i = 0; i < float_count; i++){
+        if (g_replay.size - g_replay.pos < 4) return FALSE;
+        const Uint8* p = data + g_replay.pos;
+        Uint32 bits = p[0] | (Uint32) p[1] << 8 | (Uint32) p[2] << 16 | (Uint32) p[3] << 24;
+        memcpy(&floats[i], &bits, sizeof(bits));
+        g_replay.pos += 4;
+    }
+    return TRUE;
+}
+
+static void consume(size_t body, Uint32 time){
+    g_replay.pos = body;
+    g_replay.time = time;
+    g_replay.ticks_calls = 0;
+    SDL_AtomicSet(&g_replay_time, (int) time);
+}
+
+static bool decode_event(int kind, SDL_Event* event){
+    Uint32 f[MAX_FIELDS];
+    float precise[2];
+    SDL_zerop(event);
+    switch (kind){
+        case REC_QUIT:
+            event->type = SDL_QUIT;
+            break;
+        case REC_KEY_DOWN: case REC_KEY_UP:
+            if (!read_fields(f, 6, NULL, 0)) return FALSE;
+            event->type = kind == REC_KEY_DOWN ? SDL_KEYDOWN : SDL_KEYUP;
+            event->key.windowID = f[0];
+            event->key.state = (Uint8) f[1];
+            event->key.repeat = (Uint8) f[2];
+            event->key.keysym.scancode = (SDL_Scancode) f[3];
+            event->key.keysym.sym = unzigzag(f[4]);
+            event->key.keysym.mod = (Uint16) f[5];
+            break;
+        case REC_BUTTON_DOWN: case REC_BUTTON_UP:
+            if (!read_fields(f, 7, NULL, 0)) return FALSE;
+            event->type = kind == REC_BUTTON_DOWN ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+            event->button.windowID = f[0];
+            event->button.which = f[1];
+            event->button.button = (Uint8) f[2];
+            event->button.state = (Uint8) f[3];
+            event->button.clicks = (Uint8) f[4];
+            event->button.x = unzigzag(f[5]);
+            event->button.y = unzigzag(f[6]);
+            break;
+        case REC_MOTION:
+            if (!read_fields(f, 7, NULL, 0)) return FALSE;
+            event->type = SDL_MOUSEMOTION;
+            event->motion.windowID = f[0];
+            event->motion.state = f[1];
+            event->motion.x = unzigzag(f[2]);
+            event->motion.y = unzigzag(f[3]);
+            event->motion.xrel = unzigzag(f[4]);
+            event->motion.yrel = unzigzag(f[5]);
+            event->motion.which = f[6];
+            break;
+        case REC_WHEEL:
+            if (!read_fields(f, 5, precise, 2)) return FALSE;
+            event->type = SDL_MOUSEWHEEL;
+            event->wheel.windowID = f[0];
+            event->wheel.which = f[1];
+            event->wheel.x = unzigzag(f[2]);
+            event->wheel.y = unzigzag(f[3]);
+            event->wheel.direction = f[4];
+            event->wheel.preciseX = precise[0];
+            event->wheel.preciseY = precise[1];
+            break;
+        default:
+            return FALSE;
+    }
+    event->common.timestamp = g_replay.time;
+    return TRUE;
+}
+
+// sleeps until the recorded time has passed since the replay started, real time replays only
+static void pace(Uint32 time, int timeout_ms){
+    if (g_replay.mode != REPLAY_REALTIME) return;
+    Uint64 target = g_replay.start_ns + (Uint64)(time - g_replay.start) * 1000000;
+    Uint64 now = S2D_getTimeNs();
+    if (target <= now) return;
+    Uint64 ms = (target - now) / 1000000;
+    if (timeout_ms >= 0 && ms > (Uint64) timeout_ms) ms = timeout_ms;
+    SDL_Delay((Uint32) ms);
+}
+
+bool input_replaying(){
+    return SDL_AtomicGet(&g_replaying) ? TRUE : FALSE;
+}
+
+bool input_replay_fast(){
+    return SDL_AtomicGet(&g_replaying) && g_replay.mode != REPLAY_REALTIME ? TRUE : FALSE;
+}
+
+/*
+    Polls the next event while replaying, returns 0 once the next record is not an event
+    Live input is dropped, quit and user events still come through so the window can be closed
+    and S2D_wakeEventLoop works.
+*/
+int input_replay_poll(SDL_Event* event){
+    while (SDL_PollEvent(event)){
+        if (event->type == SDL_QUIT || event->type >= SDL_USEREVENT) return 1;
+    }
+    int kind;
+    Uint32 time;
+    size_t body;
+    if (!peek_record(&kind, &time, &body)){
+        replay_end();
+        return 0;
+    }
+    if (kind == REC_FRAME || kind == REC_TICKS) return 0;
+    consume(body, time);
+    if (!decode_event(kind, event)){
+        replay_end();
+        return 0;
+    }
+    return 1;
+}
+
+// called by S2D_waitEvents while replaying when no event was due, waits as long as the recording did
+void input_replay_idle(int timeout_ms){
+    int kind;
+    Uint32 time;
+    size_t body;
+    if (peek_record(&kind, &time, &body)) pace(time, timeout_ms);
+}
+
+// called by S2D_presentRender
+void input_frame(){
+    if (g_record.file != NULL){
+        flush_ticks();
+        write_record(REC_FRAME, current_ticks(), NULL, 0, NULL, 0);
+    }
+    if (!SDL_AtomicGet(&g_replaying) || SDL_ThreadID() != g_replay.owner) return;
+
+    // records the application did not ask for are skipped to stay in step with the frames
+    int kind;
+    Uint32 time;
+    size_t body;
+    while (peek_record(&kind, &time, &body)){
+        consume(body, time);
+        if (kind == REC_FRAME){
+            pace(time, -1);
+            if (g_replay.pos >= g_replay.size) replay_end();
+            return;
+        }
+        if (kind == REC_TICKS){
+            Uint32 calls;
+            if (!read_fields(&calls, 1, NULL, 0)) break;
+        } else {
+            SDL_Event skipped;
+            if (!decode_event(kind, &skipped)) break;
+        }
+    }
+    replay_end();
+}
+
+// S2D_getTicks
+Uint32 input_ticks(){
+    if (SDL_AtomicGet(&g_replaying)){
+        if (SDL_ThreadID() != g_replay.owner) return (Uint32) SDL_AtomicGet(&g_replay_time);
+        if (g_replay.ticks_calls > 0){
+            g_replay.ticks_calls--;
+            return g_replay.time;
+        }
+        int kind;
+        Uint32 time, calls;
+        size_t body;
+        if (!peek_record(&kind, &time, &body)){
+            replay_end();
+            return input_ticks();
+        }
+        // the application asks more often than it did while recording, keep the time
+        if (kind != REC_TICKS) return g_replay.time;
+        consume(body, time);
+        if (!read_fields(&calls, 1, NULL, 0) || calls == 0){
+            replay_end();
+            return time;
+        }
+        g_replay.ticks_calls = calls - 1;
+        if (g_replay.pos >= g_replay.size && g_replay.ticks_calls == 0) replay_end();
+        return time;
+    }
+
+    Uint32 ticks = real_ticks();
+    if (g_record.file != NULL && SDL_ThreadID() == g_record.owner){
+        if (g_record.ticks_calls > 0 && ticks != g_record.ticks) flush_ticks();
+        g_record.ticks = ticks;
+        g_record.ticks_calls++;
+    }
+    return ticks;
+}
+
+
+int S2D_startInputRecording(const char* path){
+    if (g_record.file != NULL) return ERROR_INPUT_RECORDING;
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) return ERROR_INPUT_RECORDING;
+    Uint8 header[MAGIC_SIZE + 5];
+    memcpy(header, MAGIC, MAGIC_SIZE);
+    Uint32 start = current_ticks();
+    int n = MAGIC_SIZE + put_varint(header + MAGIC_SIZE, start);
+    if (fwrite(header, 1, n, file) != (size_t) n){
+        fclose(file);
+        return ERROR_INPUT_RECORDING;
+    }
+
+    g_record.file = file;
+    g_record.owner = SDL_ThreadID();
+    g_record.last = start;
+    g_record.ticks_calls = 0;
+    if (!g_atexit_registered){
+        atexit(S2D_stopInputRecording);
+        g_atexit_registered = TRUE;
+    }
+    return 0;
+}
+
+void S2D_stopInputRecording(){
+    if (g_record.file == NULL) return;
+    flush_ticks();
+    fclose(g_record.file);
+    g_record.file = NULL;
+}
+
+int S2D_replayInput(const char* path, ReplayMode mode){
+    if (SDL_AtomicGet(&g_replaying)) return ERROR_INPUT_RECORDING;
+    void* mapping;
+    size_t size;
+    if (map_file(path, FALSE, &mapping, &size) != 0) return ERROR_INPUT_RECORDING;
+
+    size_t pos = MAGIC_SIZE;
+    Uint32 start;
+    if (size < MAGIC_SIZE || memcmp(mapping, MAGIC, MAGIC_SIZE) != 0 || !get_varint(mapping, size, &pos, &start)){
+        unmap_file(mapping, size);
+        return ERROR_INPUT_RECORDING;
+    }
+
+    // without a display, the dummy video driver only works when chosen before the video subsystem starts
+    if (mode == REPLAY_HEADLESS && SDL_WasInit(SDL_INIT_VIDEO) == 0) SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+
+    g_replay.mapping = mapping;
+    g_replay.size = size;
+    g_replay.pos = pos;
+    g_replay.owner = SDL_ThreadID();
+    g_replay.mode = mode;
+    g_replay.time = start;
+    g_replay.ticks_calls = 0;
+    g_replay.start = start;
+    g_replay.start_ns = S2D_getTimeNs();
+    SDL_AtomicSet(&g_replay_time, (int) start);
+    SDL_AtomicSet(&g_replaying, 1);
+    return 0;
+}
+
+bool S2D_isReplayingInput(){
+    return input_replaying();
+}
@@ -0,0 +1,314 @@
+#ifndef S2D_INTERNAL_H
+#define S2D_INTERNAL_H
+
+/*
+    Declarations shared between the library translation units.
+    Not part of the public interface, do not include from user programs.
+*/
+
+#include "../graphics.h"
+#include <SDL2/SDL.h>
+
+#define INTERNAL_PIXEL_FORMAT (SDL_PIXELFORMAT_RGBA32)
+#define INTERNAL_PIXEL_SIZE 4
+
+/*
+    surface: the RGBA32 surface holding the pixels, NULL for compact storage formats
+    owns_pixels: the pixel memory is freed with the texture, either caller memory handed over
+    to the library or a compact storage copy
+    mapping: the texture cache file mapping holding the surface pixels, unmapped with the texture, or NULL
+    tiled: the streamed tiles of a texture created with S2D_createTiledTexture, texture is NULL then
+*/
+typedef struct tiled_texture tiled_texture;
+
+typedef struct {
+    SDL_Texture* texture;
+    SDL_Surface* surface;
+    bool owns_pixels;
+    void* mapping;
+    size_t mapping_size;
+    tiled_texture* tiled;
+} internal_texture_data;
+
+static inline SDL_BlendMode blendmode_SDL2(BlendMode mode){
+    switch (mode){
+        case BLEND_ALPHA: return SDL_BLENDMODE_BLEND;
+        case BLEND_ADD: return SDL_BLENDMODE_ADD;
+        case BLEND_MOD: return SDL_BLENDMODE_MOD;
+        default: return SDL_BLENDMODE_NONE;
+    }
+}
+
+static inline Uint32 pixelformat_SDL2(PixelFormat format){
+    switch (format){
+        case PIXEL_FORMAT_RGBA32: return SDL_PIXELFORMAT_RGBA32;
+        case PIXEL_FORMAT_BGRA32: return SDL_PIXELFORMAT_BGRA32;
+        case PIXEL_FORMAT_ARGB8888: return SDL_PIXELFORMAT_ARGB8888;
+        case PIXEL_FORMAT_RGB24: return SDL_PIXELFORMAT_RGB24;
+        case PIXEL_FORMAT_RGB565: return SDL_PIXELFORMAT_RGB565;
+        default: return SDL_PIXELFORMAT_UNKNOWN;
+    }
+}
+
+// mapfile.c, file mappings, writable mappings are private copy on write
+int map_file(const char* path, bool writable, void** base, size_t* size);
+void unmap_file(void* base, size_t size);
+
+/*
+    texcache.c, decoded texture cache, both do nothing while no cache directory is set
+    texcache_load returns a surface wrapping the pixels of a valid cache file, mapped at mapping
+*/
+SDL_Surface* texcache_load(const char* path, void** mapping, size_t* mapping_size);
+void texcache_store(const char* path, SDL_Surface* surf);
+
+/*
+    assetpack.c, lookup in the mounted asset pack
+    pack_find returns the mapped bytes of a path, pack_open a read only RWops on them, NULL if the path is not packed
+*/
+const void* pack_find(const char* path, size_t* size);
+SDL_RWops* pack_open(const char* path);
+
+/*
+    tiledtexture.c, tiles of textures larger than the renderer allows, uploaded from the texture pixels when drawn
+    tiled_update uploads the resident tiles again after the texture pixels changed
+*/
+tiled_texture* tiled_create(int width, int height, int tile_size);
+void tiled_destroy(tiled_texture* tt);
+int tiled_draw(tiled_texture* tt, const Texture* txt, const Rectangle* rect);
+int tiled_update(tiled_texture* tt, const Texture* txt);
+int tiled_set_tint(tiled_texture* tt, Uint32 rgba);
+
+// pixelconv.c, conversions from RGBA32 into compact storage and back for upload
+void convert_rgba32_to_rgb565(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h);
+void convert_rgba32_to_argb4444(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h);
+void convert_rgba32_to_a8(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h);
+void convert_rgba32_to_index8(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h, const Uint8* lut, int transparent_index);
+void expand_a8_to_rgba32(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h);
+void expand_index8_to_rgba32(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h, const Uint32* palette);
+
+// the caller pixel format of an SDL format, -1 if there is none, BGRA32 and ARGB8888 are the same format on little endian
+static inline int pixelformat_S2D(Uint32 format){
+    if (format == SDL_PIXELFORMAT_RGBA32) return PIXEL_FORMAT_RGBA32;
+    if (format == SDL_PIXELFORMAT_ARGB8888) return PIXEL_FORMAT_ARGB8888;
+    if (format == SDL_PIXELFORMAT_BGRA32) return PIXEL_FORMAT_BGRA32;
+    if (format == SDL_PIXELFORMAT_RGB24) return PIXEL_FORMAT_RGB24;
+    if (format == SDL_PIXELFORMAT_RGB565) return PIXEL_FORMAT_RGB565;
+    return -1;
+}
+
+static inline SDL_Color color_SDL2(Uint32 rgba){
+    SDL_Color c = {.r = rgba&0xFF, .g = (rgba>>8)&0xFF, .b = (rgba>>16)&0xFF, .a = rgba>>24};
+    return c;
+}
+
+
+/*
+    Growable vertex and index buffer for SDL_RenderGeometry submissions, see batch.c
+    Vertices are appended until batch_submit draws them in a single call and resets the buffer.
+    The buffer memory is kept between submissions so steady state batching does not allocate.
+*/
+typedef struct {
+    SDL_Vertex* vertices;
+    int* indices;
+    int vertex_count, vertex_capacity;
+    int index_count, index_capacity;
+} batch_buffer;
+
+int batch_reserve(batch_buffer* b, int vertices, int indices);
+int batch_quad(batch_buffer* b, const SDL_FRect* dst, SDL_Color color, float u0, float v0, float u1, float v1);
+int batch_submit(batch_buffer* b, SDL_Texture* texture, int items);
+int batch_submit_raw(batch_buffer* b, SDL_Texture* texture);
+void batch_reset(batch_buffer* b);
+
+// geometry.c, ear clipping index scratch kept between polygons
+typedef struct {
+    int* indices;
+    int capacity;
+} polygon_scratch;
+
+// geometry.c, appends a filled ellipse to a batch buffer, returns -1 if the buffer can not grow
+int tess_fill_ellipse(batch_buffer* b, fVector c, float rx, float ry, SDL_Color color);
+// geometry.c, appends a line one draw unit wide on screen, unit_x and unit_y from camera_screen_axes
+int tess_line(batch_buffer* b, fVector p0, fVector p1, fVector unit_x, fVector unit_y, SDL_Color color);
+
+
+/*
+    Frame arena, see arena.c
+    g_heap_allocs counts heap allocations made by the library, reported in the frame statistics.
+    Transient buffers needed only until the end of the frame come from S2D_frameAlloc.
+*/
+extern SDL_atomic_t g_heap_allocs;
+
+void frame_arena_advance();
+
+
+/*
+    Camera transform, culling and frame counters, see camera.c
+    All drawing goes through the render_* functions, which return the SDL status code.
+    Coordinates passed in are world coordinates when a camera is set and screen coordinates otherwise.
+*/
+typedef struct {
+    bool enabled;
+    float x, y;
+    float zoom;
+    float rotation;
+    float cos_r, sin_r;
+    float center_x, center_y;
+    // render scale, kept here as the renderer may belong to the render thread
+    float scale_x, scale_y;
+    // target pixels per draw unit at render scale 1, below 1 while dynamic resolution reduced it
+    float res_scale;
+    // visible region, in world coordinates when the camera is enabled
+    float view_x0, view_y0, view_x1, view_y1;
+} camera_state;
+
+void camera_update();
+bool camera_enabled();
+void camera_view_bounds(float* x0, float* y0, float* x1, float* y1);
+// output pixels per world unit, with camera zoom and render scale
+float camera_pixel_scale();
+// world vectors of one draw unit along the screen axes, for geometry sized in screen units
+void camera_screen_axes(fVector* unit_x, fVector* unit_y);
+bool camera_cull(float x0, float y0, float x1, float y1);
+void frame_stats_rollover();
+
+int render_rect(const SDL_FRect* r, bool fill);
+int render_rects(const SDL_FRect* frects, const SDL_Rect* rects, int n, bool fill);
+int render_line(float x0, float y0, float x1, float y1);
+int render_points(const SDL_FPoint* fpoints, const SDL_Point* points, int n, bool strip);
+int render_copy(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect* dst);
+int render_geometry(SDL_Texture* texture, SDL_Vertex* v, int nv, const int* idx, int ni, int items);
+
+
+/*
+    Trace span recording, see trace.c
+    TRACE_BEGIN/TRACE_END are compiled out when S2D_DISABLE_TRACE is defined,
+    otherwise they cost a single atomic load while tracing is not started.
+    name must be a string literal or otherwise outlive the trace file flush
+*/
+extern SDL_atomic_t g_trace_enabled;
+void trace_push(const char* name, char phase);
+
+#ifndef S2D_DISABLE_TRACE
+#define TRACE_BEGIN(name) do { if (SDL_AtomicGet(&g_trace_enabled)) trace_push((name), 'B'); } while (0)
+#define TRACE_END() do { if (SDL_AtomicGet(&g_trace_enabled)) trace_push(NULL, 'E'); } while (0)
+#else
+#define TRACE_BEGIN(name) do { } while (0)
+#define TRACE_END() do { } while (0)
+#endif
+
+
+/*
+    Rendering context, see context.c
+    Everything a window or offscreen renderer needs lives in its context. Each thread draws into its
+    current context, the default context unless another one is bound with S2D_setCurrentContext.
+    The names of the former globals resolve to the fields of the current context.
+*/
+
+typedef struct render_thread render_thread;
+typedef struct frame_profiler frame_profiler;
+typedef struct internal_res internal_res;
+
+// destroyed texture data is kept for reuse instead of freed
+typedef union texture_data_slot {
+    internal_texture_data data;
+    union texture_data_slot* next;
+} texture_data_slot;
+
+struct S2D_Context {
+    SDL_Window* window;
+    SDL_Renderer* renderer;
+    SDL_Surface* target;            // pixels of an offscreen context
+    Drawstate drawstate;
+    EventHandler evh;
+    TextureStorage texture_storage;
+    batch_buffer batch;
+    camera_state camera;
+    S2D_FrameStats frame_stats;
+    S2D_FrameStats last_frame_stats;
+    texture_data_slot* free_texture_data;
+    void* readback_buffer;
+    size_t readback_size;
+    Uint8* upload_buffer;           // expanded pixel band of A8 and INDEX8 uploads
+    size_t upload_size;
+    polygon_scratch polygon_scratch; // ear clipping of S2D_fillPolygon
+    render_thread* render_thread;   // set while threaded rendering is enabled
+    frame_profiler* profiler;       // set while the frame profiler is started
+    SDL_Texture* field_texture;     // streaming texture of S2D_drawScalarField
+    int field_w, field_h;
+    Uint32 frame;                   // presented frames, dates the last use of streamed texture tiles
+    internal_res* internal_res;     // set while drawing goes to a target of the internal resolution
+};
+
+extern S2D_Context g_default_context;
+extern _Thread_local S2D_Context* t_context;
+
+static inline S2D_Context* current_context(){
+    return t_context != NULL ? t_context : &g_default_context;
+}
+
+#define g_WINDOW (current_context()->window)
+#define g_RENDERER (current_context()->renderer)
+#define g_drawstate (current_context()->drawstate)
+#define g_batch (current_context()->batch)
+#define g_frame_stats (current_context()->frame_stats)
+
+/*
+    Renderer calls, see renderthread.c
+    Drawing goes through the rt_ functions, which record into the frame stream while threaded rendering
+    is enabled and call SDL otherwise. Any other use of the SDL renderer is wrapped in rt_call, which
+    runs fn on the thread owning the renderer once everything recorded before is drawn.
+*/
+
+int rt_call(int (*fn)(void*), void* arg);
+int rt_draw_color(Uint32 rgba);
+int rt_blend_mode(BlendMode mode);
+int rt_clip(const SDL_Rect* clip);
+int rt_clear();
+int rt_scale(float x_scale, float y_scale);
+int rt_rects(const SDL_FRect* frects, const SDL_Rect* rects, int n, bool fill);
+int rt_points(const SDL_FPoint* fpoints, const SDL_Point* points, int n, bool strip);
+int rt_copy(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect* dst, double angle, const SDL_FPoint* pivot);
+int rt_geometry(SDL_Texture* texture, const SDL_Vertex* v, int nv, const int* idx, int ni);
+int rt_target(SDL_Texture* texture);
+void rt_present();
+void rt_shutdown(S2D_Context* ctx);
+
+/*
+    Worker pool, see parallel.c
+    Runs fn over [0, count) split into chunks of grain items, on the pool and the calling thread.
+    fn must not call parallel_for itself.
+*/
+typedef void (*parallel_fn)(int begin, int end, void* arg);
+void parallel_for(int count, int grain, parallel_fn fn, void* arg);
+
+/*
+    internalres.c, drawing at the internal resolution, see S2D_setInternalResolution
+    internal_res_present upscales the target into the window before presenting, internal_res_frame binds it
+    again afterwards. render_target_restore switches the target back after drawing into another texture
+    on the thread owning the renderer, with the render scale SDL resets on the switch.
+*/
+void internal_res_present();
+void internal_res_frame();
+void internal_res_map_mouse(Sint32* x, Sint32* y, Sint32* xrel, Sint32* yrel);
+void internal_res_free(S2D_Context* ctx);
+int render_target_restore(SDL_Texture* target);
+
+// frame profiler, see profiler.c
+void profiler_frame();
+void profiler_free(S2D_Context* ctx);
+
+/*
+    Input recording and replay, see inputrecord.c
+    While replaying, events come from input_replay_poll instead of SDL and input_ticks returns the recorded
+    S2D_getTicks results. input_replay_fast is set when waits are skipped.
+*/
+void input_record_event(const SDL_Event* event);
+bool input_replaying();
+bool input_replay_fast();
+int input_replay_poll(SDL_Event* event);
+void input_replay_idle(int timeout_ms);
+void input_frame();
+Uint32 input_ticks();
+
+#endif
@@ -0,0 +1,219 @@
+#include "internal.h"
+
+/*
+    Internal resolution
+
+    While set, the context draws into a target texture of the internal size instead of the window.
+    S2D_presentRender upscales the target into the window, centered at the largest size keeping the aspect
+    ratio, and binds it again for the next frame. Draw coordinates, the draw state size and mouse positions
+    are those of the internal resolution, so a program is written against it regardless of the window size.
+
+    Dynamic resolution lowers the render scale of the target instead of recreating it, drawing then covers
+    only its top left part, which is the part upscaled. The fill cost of a frame is taken as proportional to
+    the pixel count, the square of the scale, to pick the scale bringing the smoothed frame time under budget.
+*/
+
+// weight of the newest frame in the smoothed frame time
+#define DYNAMIC_SMOOTHING 0.1
+// the frame time aimed at, as a fraction of the budget, lower than 1 so the scale does not oscillate around it
+#define DYNAMIC_HEADROOM 0.85
+#define DYNAMIC_MAX_STEP_UP 1.1f
+// scales are multiples of 1 / DYNAMIC_STEPS
+#define DYNAMIC_STEPS 64
+// frames after a change before the scale changes again, so the smoothed time reflects the new scale
+#define DYNAMIC_COOLDOWN_FRAMES 10
+#define DYNAMIC_DEFAULT_MIN_SCALE 0.5f
+
+struct internal_res {
+    SDL_Texture* target;
+    int w, h;
+    int output_w, output_h;
+    UpscaleFilter filter;
+    // dynamic resolution, disabled while budget_ns is 0
+    Uint64 budget_ns;
+    float min_scale;
+    double average_ns;
+    Uint64 last_present;
+    int cooldown;
+};
+
+// the window rectangle the target is upscaled into
+static SDL_FRect output_rect(const internal_res* r){
+    float f = SDL_min((float) r->output_w / r->w, (float) r->output_h / r->h);
+    if (r->filter == UPSCALE_INTEGER && f >= 1.0f) f = SDL_floorf(f);
+    float w = r->w * f, h = r->h * f;
+    return (SDL_FRect){SDL_floorf((r->output_w - w) / 2), SDL_floorf((r->output_h - h) / 2), w, h};
+}
+
+// the target pixels drawn at the current scale
+static SDL_Rect drawn_rect(const internal_res* r){
+    float s = current_context()->camera.res_scale;
+    return (SDL_Rect){0, 0, SDL_max((int)(r->w * s + 0.5f), 1), SDL_max((int)(r->h * s + 0.5f), 1)};
+}
+
+// renderer work runs through rt_call, on the render thread in threaded mode
+static int create_target(void* data){
+    internal_res* r = data;
+    r->target = SDL_CreateTexture(g_RENDERER, INTERNAL_PIXEL_FORMAT, SDL_TEXTUREACCESS_TARGET, r->w, r->h);
+    if (r->target == NULL) return -1;
+    SDL_SetTextureBlendMode(r->target, SDL_BLENDMODE_NONE);
+    SDL_SetTextureScaleMode(r->target, r->filter == UPSCALE_LINEAR ? SDL_ScaleModeLinear : SDL_ScaleModeNearest);
+    return 0;
+}
+
+static int destroy_target(void* texture){
+    SDL_DestroyTexture(texture);
+    return 0;
+}
+
+// SDL resets the render scale on every target switch, the scale of the context is applied again
+static int bind_target(SDL_Texture* target){
+    camera_state* c = &current_context()->camera;
+    if (rt_target(target) != 0) return -1;
+    if (target == NULL) return rt_scale(c->scale_x, c->scale_y);
+    return rt_scale(c->scale_x * c->res_scale, c->scale_y * c->res_scale);
+}
+
+int render_target_restore(SDL_Texture* target){
+    camera_state* c = &current_context()->camera;
+    if (SDL_SetRenderTarget(g_RENDERER, target) != 0) return -1;
+    if (target == NULL) return 0;
+    return SDL_RenderSetScale(g_RENDERER, c->scale_x * c->res_scale, c->scale_y * c->res_scale);
+}
+
+int S2D_setInternalResolution(int w, int h, UpscaleFilter filter){
+    S2D_Context* ctx = current_context();
+    if (w < 0 || h < 0 || (w == 0) != (h == 0) || ctx->renderer == NULL) return ERROR_INTERNAL_RESOLUTION;
+
+    // back to drawing into the window first, also when only the size changes
+    internal_res* r = ctx->internal_res;
+    if (r != NULL){
+        ctx->internal_res = NULL;
+        ctx->camera.res_scale = 1.0f;
+        g_drawstate.draw_w = r->output_w;
+        g_drawstate.draw_h = r->output_h;
+        bind_target(NULL);
+        rt_call(destroy_target, r->target);
+        free(r);
+    }
+    int retcode = 0;
+    if (w > 0){
+        r = calloc(1, sizeof(internal_res));
+        if (r != NULL){
+            SDL_AtomicAdd(&g_heap_allocs, 1);
+            r->w = w, r->h = h;
+            r->output_w = g_drawstate.draw_w, r->output_h = g_drawstate.draw_h;
+            r->filter = filter;
+        }
+        if (r == NULL || rt_call(create_target, r) != 0 || bind_target(r->target) != 0){
+            if (r != NULL && r->target != NULL){
+                bind_target(NULL);
+                rt_call(destroy_target, r->target);
+            }
+            free(r);
+            retcode = ERROR_INTERNAL_RESOLUTION;
+        } else {
+            ctx->internal_res = r;
+            g_drawstate.draw_w = w;
+            g_drawstate.draw_h = h;
+        }
+    }
+    camera_update();
+    return retcode;
+}
+
+int S2D_setDynamicResolution(Uint64 budget_ns, float min_scale){
+    S2D_Context* ctx = current_context();
+    internal_res* r = ctx->internal_res;
+    if (r == NULL) return ERROR_INTERNAL_RESOLUTION;
+    r->budget_ns = budget_ns;
+    r->min_scale = min_scale > 0.0f ? SDL_min(min_scale, 1.0f) : DYNAMIC_DEFAULT_MIN_SCALE;
+    r->average_ns = 0;
+    r->last_present = 0;
+    r->cooldown = 0;
+    if (budget_ns == 0 && ctx->camera.res_scale != 1.0f){
+        ctx->camera.res_scale = 1.0f;
+        return bind_target(r->target) != 0 ? ERROR_INTERNAL_RESOLUTION : 0;
+    }
+    return 0;
+}
+
+void S2D_getInternalResolution(int* w, int* h){
+    internal_res* r = current_context()->internal_res;
+    if (r == NULL){
+        *w = g_drawstate.draw_w;
+        *h = g_drawstate.draw_h;
+        return;
+    }
+    SDL_Rect drawn = drawn_rect(r);
+    *w = drawn.w;
+    *h = drawn.h;
+}
+
+// called by S2D_presentRender before presenting
+void internal_res_present(){
+    internal_res* r = current_context()->internal_res;
+    if (r == NULL) return;
+    TRACE_BEGIN("internal_res_present");
+    SDL_Rect src = drawn_rect(r);
+    SDL_FRect dst = output_rect(r);
+    rt_target(NULL);
+    rt_scale(1.0f, 1.0f);
+    rt_draw_color(0xFF000000);
+    rt_clear();
+    rt_copy(r->target, &src, &dst, 0, NULL);
+    TRACE_END();
+}
+
+// picks the scale for the next frame from the smoothed frame time
+static void adapt_scale(internal_res* r){
+    camera_state* c = &current_context()->camera;
+    Uint64 now = S2D_getTimeNs();
+    Uint64 last = r->last_present;
+    r->last_present = now;
+    if (last == 0) return;
+    double ns = (double)(now - last);
+    r->average_ns = r->average_ns == 0 ? ns : r->average_ns + (ns - r->average_ns) * DYNAMIC_SMOOTHING;
+    if (r->cooldown > 0){
+        r->cooldown--;
+        return;
+    }
+
+    float scale = c->res_scale * SDL_sqrtf((float)(DYNAMIC_HEADROOM * r->budget_ns / r->average_ns));
+    scale = SDL_min(scale, c->res_scale * DYNAMIC_MAX_STEP_UP);
+    scale = SDL_floorf(scale * DYNAMIC_STEPS) / DYNAMIC_STEPS;
+    scale = SDL_max(SDL_min(scale, 1.0f), r->min_scale);
+    // lowering waits until the budget is exceeded, raising already aims below it
+    if (scale == c->res_scale || (scale < c->res_scale && r->average_ns <= r->budget_ns)) return;
+    r->average_ns *= (double) (scale * scale) / (c->res_scale * c->res_scale);
+    c->res_scale = scale;
+    r->cooldown = DYNAMIC_COOLDOWN_FRAMES;
+}
+
+// called by S2D_presentRender after presenting, binds the target for the next frame
+void internal_res_frame(){
+    internal_res* r = current_context()->internal_res;
+    if (r == NULL) return;
+    if (r->budget_ns > 0) adapt_scale(r);
+    bind_target(r->target);
+    rt_draw_color(g_drawstate.draw_color);
+}
+
+void internal_res_map_mouse(Sint32* x, Sint32* y, Sint32* xrel, Sint32* yrel){
+    internal_res* r = current_context()->internal_res;
+    if (r == NULL) return;
+    SDL_FRect dst = output_rect(r);
+    float fx = r->w / dst.w, fy = r->h / dst.h;
+    *x = (Sint32) SDL_floorf((*x - dst.x) * fx);
+    *y = (Sint32) SDL_floorf((*y - dst.y) * fy);
+    if (xrel != NULL) *xrel = (Sint32) SDL_floorf(*xrel * fx + 0.5f);
+    if (yrel != NULL) *yrel = (Sint32) SDL_floorf(*yrel * fy + 0.5f);
+}
+
+// called by S2D_destroyContext once the render thread is stopped
+void internal_res_free(S2D_Context* ctx){
+    if (ctx->internal_res == NULL) return;
+    SDL_DestroyTexture(ctx->internal_res->target);
+    free(ctx->internal_res);
+    ctx->internal_res = NULL;
+}
@@ -0,0 +1,56 @@
+#include "internal.h"
+
+#ifdef _WIN32
+#include <stdlib.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+    Read only file mappings, writable ones are private copy on write mappings whose changes never reach the file.
+    Windows reads the file into heap memory instead.
+*/
+
+int map_file(const char* path, bool writable, void** base, size_t* size){
+#ifdef _WIN32
+    SDL_RWops* rw = SDL_RWFromFile(path, "rb");
+    if (rw == NULL) return -1;
+    Sint64 len = SDL_RWsize(rw);
+    void* mem = len > 0 ? malloc((size_t) len) : NULL;
+    if (mem == NULL || SDL_RWread(rw, mem, 1, (size_t) len) != (size_t) len){
+        free(mem);
+        SDL_RWclose(rw);
+        return -1;
+    }
+    SDL_RWclose(rw);
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    *base = mem;
+    *size = (size_t) len;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0){
+        close(fd);
+        return -1;
+    }
+    void* mem = mmap(NULL, (size_t) st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return -1;
+    *base = mem;
+    *size = (size_t) st.st_size;
+#endif
+    return 0;
+}
+
+void unmap_file(void* base, size_t size){
+    if (base == NULL) return;
+#ifdef _WIN32
+    free(base);
+#else
+    munmap(base, size);
+#endif
+}
@@ -0,0 +1,103 @@
+#include "internal.h"
+
+/*
+    Worker pool for data parallel loops
+
+    The workers are started on first use, one per CPU core besides the calling thread, and stay
+    parked on a condition variable between jobs. A job is a range of items handed out in chunks
+    through an atomic counter, the calling thread works on it as well and returns once every
+    worker that took part has finished. Jobs from different threads run one after another.
+*/
+
+#define MAX_WORKERS 15
+
+typedef struct {
+    parallel_fn fn;
+    void* arg;
+    int count;
+    int grain;
+    SDL_atomic_t next;
+} parallel_job;
+
+static SDL_SpinLock g_init_lock;
+static bool g_started = FALSE;
+static int g_worker_count;
+static SDL_mutex* g_job_lock;       // serializes parallel_for callers
+static SDL_mutex* g_lock;
+static SDL_cond* g_wake;
+static SDL_cond* g_idle;
+static parallel_job g_job;
+static Uint32 g_generation;
+static bool g_active;
+static int g_busy;
+
+static void run_chunks(parallel_job* job){
+    for (;;){
+        int begin = SDL_AtomicAdd(&job->next, job->grain);
+        if (begin >= job->count) return;
+        job->fn(begin, SDL_min(begin + job->grain, job->count), job->arg);
+    }
+}
+
+static int worker_proc(void* unused){
+    Uint32 seen = 0;
+    SDL_LockMutex(g_lock);
+    for (;;){
+        while (!g_active || seen == g_generation) SDL_CondWait(g_wake, g_lock);
+        seen = g_generation;
+        g_busy++;
+        SDL_UnlockMutex(g_lock);
+        run_chunks(&g_job);
+        SDL_LockMutex(g_lock);
+        if (--g_busy == 0) SDL_CondSignal(g_idle);
+    }
+    return 0;
+}
+
+static void start_workers(){
+    SDL_AtomicLock(&g_init_lock);
+    if (!g_started){
+        g_job_lock = SDL_CreateMutex();
+        g_lock = SDL_CreateMutex();
+        g_wake = SDL_CreateCond();
+        g_idle = SDL_CreateCond();
+        int count = SDL_min(SDL_GetCPUCount() - 1, MAX_WORKERS);
+        if (g_job_lock != NULL && g_lock != NULL && g_wake != NULL && g_idle != NULL){
+            for (int i = 0; i < count; i++){
+                SDL_Thread* t = SDL_CreateThread(worker_proc, "S2D worker", NULL);
+                if (t == NULL) break;
+                SDL_DetachThread(t);
+                g_worker_count++;
+            }
+        }
+        g_started = TRUE;
+    }
+    SDL_AtomicUnlock(&g_init_lock);
+}
+
+void parallel_for(int count, int grain, parallel_fn fn, void* arg){
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    start_workers();
+    if (g_worker_count == 0 || count <= grain){
+        fn(0, count, arg);
+        return;
+    }
+    SDL_LockMutex(g_job_lock);
+    SDL_LockMutex(g_lock);
+    g_job.fn = fn, g_job.arg = arg, g_job.count = count, g_job.grain = grain;
+    SDL_AtomicSet(&g_job.next, 0);
+    g_generation++;
+    g_active = TRUE;
+    SDL_CondBroadcast(g_wake);
+    SDL_UnlockMutex(g_lock);
+
+    run_chunks(&g_job);
+
+    // workers that have not picked up the job by now find it inactive and keep sleeping
+    SDL_LockMutex(g_lock);
+    g_active = FALSE;
+    while (g_busy > 0) SDL_CondWait(g_idle, g_lock);
+    SDL_UnlockMutex(g_lock);
+    SDL_UnlockMutex(g_job_lock);
+}
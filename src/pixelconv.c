@@ -0,0 +1,132 @@
+#include "internal.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+    Conversions between the internal RGBA32 format and the compact texture storage formats
+    RGBA32 pixels are read as bytes R,G,B,A so the scalar paths are endian independent,
+    the SSE2 paths convert 8 or 16 pixels per iteration on x86.
+*/
+
+#ifdef __SSE2__
+// 32 bit lanes holding 16 bit values, packed without the signed saturation of _mm_packs_epi32
+static inline __m128i pack_u16(__m128i lo, __m128i hi){
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+}
+
+static inline __m128i rgb565_lanes(__m128i px){
+    __m128i r = _mm_slli_epi32(_mm_and_si128(px, _mm_set1_epi32(0xF8)), 8);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(px, 5), _mm_set1_epi32(0x7E0));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(px, 19), _mm_set1_epi32(0x1F));
+    return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+static inline __m128i argb4444_lanes(__m128i px){
+    __m128i a = _mm_slli_epi32(_mm_srli_epi32(px, 28), 12);
+    __m128i r = _mm_and_si128(_mm_slli_epi32(px, 4), _mm_set1_epi32(0xF00));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(px, 8), _mm_set1_epi32(0xF0));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(px, 20), _mm_set1_epi32(0xF));
+    return _mm_or_si128(_mm_or_si128(a, r), _mm_or_si128(g, b));
+}
+#endif
+
+void convert_rgba32_to_rgb565(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h){
+    for (int y = 0; y < h; y++){
+        const Uint8* s = src + (size_t) y * src_pitch;
+        Uint16* d = (Uint16*)(dst + (size_t) y * dst_pitch);
+        int x = 0;
+#ifdef __SSE2__
+        for (; x + 8 <= w; x += 8){
+            __m128i p0 = _mm_loadu_si128((const __m128i*)(s + 4*x));
+            __m128i p1 = _mm_loadu_si128((const __m128i*)(s + 4*x + 16));
+            _mm_storeu_si128((__m128i*)(d + x), pack_u16(rgb565_lanes(p0), rgb565_lanes(p1)));
+        }
+#endif
+        for (; x < w; x++){
+            const Uint8* p = s + 4*x;
+            d[x] = (Uint16)(((p[0] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) | (p[2] >> 3));
+        }
+    }
+}
+
+void convert_rgba32_to_argb4444(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h){
+    for (int y = 0; y < h; y++){
+        const Uint8* s = src + (size_t) y * src_pitch;
+        Uint16* d = (Uint16*)(dst + (size_t) y * dst_pitch);
+        int x = 0;
+#ifdef __SSE2__
+        for (; x + 8 <= w; x += 8){
+            __m128i p0 = _mm_loadu_si128((const __m128i*)(s + 4*x));
+            __m128i p1 = _mm_loadu_si128((const __m128i*)(s + 4*x + 16));
+            _mm_storeu_si128((__m128i*)(d + x), pack_u16(argb4444_lanes(p0), argb4444_lanes(p1)));
+        }
+#endif
+        for (; x < w; x++){
+            const Uint8* p = s + 4*x;
+            d[x] = (Uint16)(((p[3] >> 4) << 12) | ((p[0] >> 4) << 8) | ((p[1] >> 4) << 4) | (p[2] >> 4));
+        }
+    }
+}
+
+void convert_rgba32_to_a8(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h){
+    for (int y = 0; y < h; y++){
+        const Uint8* s = src + (size_t) y * src_pitch;
+        Uint8* d = dst + (size_t) y * dst_pitch;
+        int x = 0;
+#ifdef __SSE2__
+        for (; x + 16 <= w; x += 16){
+            __m128i a0 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(s + 4*x)), 24);
+            __m128i a1 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(s + 4*x + 16)), 24);
+            __m128i a2 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(s + 4*x + 32)), 24);
+            __m128i a3 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(s + 4*x + 48)), 24);
+            __m128i lo = _mm_packs_epi32(a0, a1), hi = _mm_packs_epi32(a2, a3);
+            _mm_storeu_si128((__m128i*)(d + x), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; x < w; x++) d[x] = s[4*x + 3];
+    }
+}
+
+// lut maps RGB555 colors to palette indices, transparent pixels map to transparent_index
+void convert_rgba32_to_index8(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h, const Uint8* lut, int transparent_index){
+    for (int y = 0; y < h; y++){
+        const Uint8* s = src + (size_t) y * src_pitch;
+        Uint8* d = dst + (size_t) y * dst_pitch;
+        for (int x = 0; x < w; x++){
+            const Uint8* p = s + 4*x;
+            if (p[3] < 128 && transparent_index >= 0){
+                d[x] = (Uint8) transparent_index;
+                continue;
+            }
+            d[x] = lut[((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3)];
+        }
+    }
+}
+
+// alpha only pixels become white with that alpha, the color comes from the texture tint
+void expand_a8_to_rgba32(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h){
+    for (int y = 0; y < h; y++){
+        const Uint8* s = src + (size_t) y * src_pitch;
+        Uint8* d = dst + (size_t) y * dst_pitch;
+        for (int x = 0; x < w; x++){
+            d[4*x] = 255, d[4*x + 1] = 255, d[4*x + 2] = 255;
+            d[4*x + 3] = s[x];
+        }
+    }
+}
+
+void expand_index8_to_rgba32(const Uint8* src, int src_pitch, Uint8* dst, int dst_pitch, int w, int h, const Uint32* palette){
+    for (int y = 0; y < h; y++){
+        const Uint8* s = src + (size_t) y * src_pitch;
+        Uint8* d = dst + (size_t) y * dst_pitch;
+        for (int x = 0; x < w; x++){
+            Uint32 c = palette[s[x]];
+            d[4*x] = c & 0xFF, d[4*x + 1] = (c >> 8) & 0xFF, d[4*x + 2] = (c >> 16) & 0xFF;
+            d[4*x + 3] = c >> 24;
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#include "internal.h"
+#include <stdio.h>
+
+/*
+    Frame time profiler
+
+    Frame durations are the time between successive S2D_presentRender calls, recorded into a log-linear
+    histogram like HdrHistogram: values below 2^SUB_BITS ns get a bucket each, above that every power of
+    two is split into 2^SUB_BITS linear sub-buckets, so a bucket is never wider than 1/32 of its value.
+    Recording is a bit scan and an increment, percentiles are read by walking the counts.
+*/
+
+#define SUB_BITS 5
+#define SUB_COUNT (1 << SUB_BITS)
+// durations from 2^MAX_BITS ns (18 minutes) up land in the last bucket
+#define MAX_BITS 40
+#define BUCKET_COUNT ((MAX_BITS - SUB_BITS + 1) * SUB_COUNT)
+
+struct frame_profiler {
+    Uint32 counts[BUCKET_COUNT];
+    Uint64 frames;
+    Uint64 over_budget;
+    Uint64 total_ns;
+    Uint64 max_ns;
+    Uint64 budget_ns;
+    Uint64 last_present;
+    char* dump_path;
+};
+
+static bool g_atexit_registered = FALSE;
+
+static int bucket_index(Uint64 ns){
+    if (ns < SUB_COUNT) return (int) ns;
+    if (ns >= (Uint64) 1 << MAX_BITS) return BUCKET_COUNT - 1;
+    int msb = ns >> 32 ? 32 + SDL_MostSignificantBitIndex32(ns >> 32) : SDL_MostSignificantBitIndex32((Uint32) ns);
+    int shift = msb - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + (int)((ns >> shift) & (SUB_COUNT - 1));
+}
+
+// the largest duration falling into the bucket
+static Uint64 bucket_high(int index){
+    if (index < SUB_COUNT) return index;
+    int shift = index / SUB_COUNT - 1;
+    Uint64 low = (Uint64)(SUB_COUNT + index % SUB_COUNT) << shift;
+    return low + ((Uint64) 1 << shift) - 1;
+}
+
+static Uint64 percentile(const frame_profiler* p, double pct){
+    if (p->frames == 0) return 0;
+    Uint64 rank = (Uint64)(pct / 100.0 * p->frames + 0.5);
+    if (rank < 1) rank = 1;
+    Uint64 seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++){
+        seen += p->counts[i];
+        if (seen >= rank) return SDL_min(bucket_high(i), p->max_ns);
+    }
+    return p->max_ns;
+}
+
+// called by S2D_presentRender
+void profiler_frame(){
+    frame_profiler* p = current_context()->profiler;
+    if (p == NULL) return;
+    Uint64 now = S2D_getTimeNs();
+    if (p->last_present != 0){
+        Uint64 ns = now - p->last_present;
+        p->counts[bucket_index(ns)]++;
+        p->frames++;
+        p->total_ns += ns;
+        if (ns > p->max_ns) p->max_ns = ns;
+        if (ns > p->budget_ns) p->over_budget++;
+    }
+    p->last_present = now;
+}
+
+static void dump_at_exit(){
+    frame_profiler* p = g_default_context.profiler;
+    if (p != NULL) S2D_dumpFrameProfile(p->dump_path);
+}
+
+int S2D_startFrameProfiler(Uint64 budget_ns, const char* dump_path){
+    S2D_Context* ctx = current_context();
+    frame_profiler* p = ctx->profiler;
+    if (p == NULL){
+        p = calloc(1, sizeof(frame_profiler));
+        if (p == NULL) return ERROR_PROFILER;
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+        ctx->profiler = p;
+    }
+    SDL_free(p->dump_path);
+    p->dump_path = dump_path != NULL ? SDL_strdup(dump_path) : NULL;
+    p->budget_ns = budget_ns;
+    S2D_resetFrameProfile();
+    if (!g_atexit_registered){
+        atexit(dump_at_exit);
+        g_atexit_registered = TRUE;
+    }
+    return 0;
+}
+
+void profiler_free(S2D_Context* ctx){
+    if (ctx->profiler == NULL) return;
+    SDL_free(ctx->profiler->dump_path);
+    free(ctx->profiler);
+    ctx->profiler = NULL;
+}
+
+void S2D_stopFrameProfiler(){
+    S2D_Context* ctx = current_context();
+    if (ctx->profiler == NULL) return;
+    S2D_dumpFrameProfile(ctx->profiler->dump_path);
+    profiler_free(ctx);
+}
+
+void S2D_resetFrameProfile(){
+    frame_profiler* p = current_context()->profiler;
+    if (p == NULL) return;
+    memset(p->counts, 0, sizeof(p->counts));
+    p->frames = p->over_budget = p->total_ns = p->max_ns = 0;
+    // the next present starts a new interval instead of measuring the time since the reset
+    p->last_present = 0;
+}
+
+S2D_FrameProfile S2D_getFrameProfile(){
+    S2D_FrameProfile fp = {0};
+    const frame_profiler* p = current_context()->profiler;
+    if (p == NULL) return fp;
+    fp.frames = p->frames;
+    fp.over_budget = p->over_budget;
+    fp.budget_ns = p->budget_ns;
+    fp.mean_ns = p->frames > 0 ? p->total_ns / p->frames : 0;
+    fp.p50_ns = percentile(p, 50);
+    fp.p95_ns = percentile(p, 95);
+    fp.p99_ns = percentile(p, 99);
+    fp.max_ns = p->max_ns;
+    return fp;
+}
+
+Uint64 S2D_getFramePercentile(double pct){
+    const frame_profiler* p = current_context()->profiler;
+    if (p == NULL) return 0;
+    return percentile(p, SDL_clamp(pct, 0.0, 100.0));
+}
+
+int S2D_dumpFrameProfile(const char* path){
+    const frame_profiler* p = current_context()->profiler;
+    if (p == NULL) return ERROR_PROFILER;
+    FILE* f = path != NULL ? fopen(path, "w") : stdout;
+    if (f == NULL) return ERROR_PROFILER;
+    S2D_FrameProfile fp = S2D_getFrameProfile();
+    fprintf(f, "frame profile: %llu frames, budget %.3f ms, %llu over budget (%.2f%%)\n",
+        (unsigned long long) fp.frames, fp.budget_ns / 1e6, (unsigned long long) fp.over_budget,
+        fp.frames > 0 ? 100.0 * fp.over_budget / fp.frames : 0.0);
+    fprintf(f, "mean %.3f ms  p50 %.3f ms  p95 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+        fp.mean_ns / 1e6, fp.p50_ns / 1e6, fp.p95_ns / 1e6, fp.p99_ns / 1e6, fp.max_ns / 1e6);
+    fprintf(f, "%12s %10s %11s\n", "<= ms", "frames", "cumulative");
+    Uint64 seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++){
+        if (p->counts[i] == 0) continue;
+        seen += p->counts[i];
+        fprintf(f, "%12.3f %10u %10.2f%%\n", SDL_min(bucket_high(i), p->max_ns) / 1e6, p->counts[i], 100.0 * seen / p->frames);
+    }
+    if (f != stdout) fclose(f);
+    else fflush(f);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "internal.h"
+
+typedef enum {ITEM_FILL, ITEM_OUTLINE, ITEM_TEXTURE} queue_item_kind;
+
+typedef struct {
+    int layer;
+    int z;
+    SDL_Texture* texture;
+    BlendMode blend;
+    queue_item_kind kind;
+    Uint32 color;
+    Uint32 seq;
+    SDL_Rect rect;
+} queue_item;
+
+struct S2D_RenderQueue {
+    queue_item* items;
+    int count;
+    int capacity;
+};
+
+S2D_RenderQueue* S2D_createRenderQueue(){
+    S2D_RenderQueue* q = calloc(1, sizeof(S2D_RenderQueue));
+    return q;
+}
+
+void S2D_destroyRenderQueue(S2D_RenderQueue* q){
+    if (q == NULL) return;
+    free(q->items);
+    free(q);
+}
+
+static queue_item* queue_push(S2D_RenderQueue* q){
+    if (q->count == q->capacity){
+        int cap = q->capacity > 0 ? 2*q->capacity : 256;
+        queue_item* n = realloc(q->items, cap * sizeof(queue_item));
+        if (n == NULL) return NULL;
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+        q->items = n;
+        q->capacity = cap;
+    }
+    queue_item* it = &q->items[q->count];
+    it->seq = q->count++;
+    return it;
+}
+
+static int queue_rect(S2D_RenderQueue* q, queue_item_kind kind, int layer, int z, const Rectangle* rect, Uint32 rgba){
+    queue_item* it = queue_push(q);
+    if (it == NULL) return ERROR_RENDER_QUEUE;
+    it->layer = layer, it->z = z;
+    it->texture = NULL;
+    it->blend = g_drawstate.blend_mode;
+    it->kind = kind;
+    it->color = rgba;
+    it->rect = (SDL_Rect){rect->origin.x, rect->origin.y, rect->w, rect->h};
+    return 0;
+}
+
+int S2D_queueFillRectangle(S2D_RenderQueue* q, int layer, int z, const Rectangle* rect, Uint32 rgba){
+    return queue_rect(q, ITEM_FILL, layer, z, rect, rgba);
+}
+
+int S2D_queueDrawRectangle(S2D_RenderQueue* q, int layer, int z, const Rectangle* rect, Uint32 rgba){
+    return queue_rect(q, ITEM_OUTLINE, layer, z, rect, rgba);
+}
+
+int S2D_queueTexture(S2D_RenderQueue* q, int layer, int z, Texture* txt, const Rectangle* rect){
+    // tiled textures have no single texture to queue
+    if (txt->internal_ == NULL || ((internal_texture_data*)txt->internal_)->tiled != NULL) return ERROR_DRAW_TEXTURE;
+    queue_item* it = queue_push(q);
+    if (it == NULL) return ERROR_RENDER_QUEUE;
+    it->layer = layer, it->z = z;
+    // textures blend with their own blend mode, so it is not part of the sort key
+    it->texture = ((internal_texture_data*)txt->internal_)->texture;
+    it->blend = BLEND_NONE;
+    it->kind = ITEM_TEXTURE;
+    it->color = DRAW_COLOR_WHITE;
+    it->rect = (SDL_Rect){rect->origin.x, rect->origin.y, rect->w, rect->h};
+    return 0;
+}
+
+#define CMP(a, b) if ((a) != (b)) return (a) < (b) ? -1 : 1
+
+// sequence number is the last key, which makes qsort behave as a stable sort
+static int item_compare(const void* p0, const void* p1){
+    const queue_item* a = p0;
+    const queue_item* b = p1;
+    CMP(a->layer, b->layer);
+    CMP(a->z, b->z);
+    CMP((uintptr_t) a->texture, (uintptr_t) b->texture);
+    CMP(a->blend, b->blend);
+    CMP(a->kind, b->kind);
+    CMP(a->color, b->color);
+    CMP(a->seq, b->seq);
+    return 0;
+}
+
+static bool same_batch(const queue_item* a, const queue_item* b){
+    return a->layer == b->layer && a->z == b->z && a->texture == b->texture && a->blend == b->blend && a->kind == b->kind;
+}
+
+static int set_draw_state(Uint32 rgba, BlendMode blend){
+    if (rt_draw_color(rgba) != 0) return ERROR_SET_DRAW_COLOR;
+    if (rt_blend_mode(blend) != 0) return ERROR_SET_BLEND_MODE;
+    return 0;
+}
+
+// Run of items with the same state apart from color. Rectangles of a single color go through
+// SDL_RenderFillRects/SDL_RenderDrawRects, fills of mixed colors and textures through one geometry batch
+static int flush_run(const queue_item* run, int n){
+    int retcode = 0;
+    if (run->kind == ITEM_TEXTURE || (run->kind == ITEM_FILL && run[0].color != run[n-1].color)){
+        if (run->kind == ITEM_FILL && (retcode = set_draw_state(run->color, run->blend)) != 0) return retcode;
+        for (int i = 0; i < n; i++){
+            SDL_FRect dst = {run[i].rect.x, run[i].rect.y, run[i].rect.w, run[i].rect.h};
+            if (batch_quad(&g_batch, &dst, color_SDL2(run[i].color), 0.0f, 0.0f, 1.0f, 1.0f) != 0) return ERROR_RENDER_QUEUE;
+        }
+        if (batch_submit(&g_batch, run->texture, n) != 0) return run->kind == ITEM_FILL ? ERROR_RECT_FILL : ERROR_DRAW_TEXTURE;
+        return 0;
+    }
+
+    SDL_Rect* rects = S2D_frameAlloc(n * sizeof(SDL_Rect), 0);
+    if (rects == NULL) return ERROR_RENDER_QUEUE;
+    for (int i = 0; i < n; i++) rects[i] = run[i].rect;
+
+    if ((retcode = set_draw_state(run->color, run->blend)) != 0) return retcode;
+    if (run->kind == ITEM_FILL){
+        return render_rects(NULL, rects, n, TRUE) != 0 ? ERROR_RECT_FILL : 0;
+    }
+    return render_rects(NULL, rects, n, FALSE) != 0 ? ERROR_DRAW_RECT : 0;
+}
+
+int S2D_flushRenderQueue(S2D_RenderQueue* q){
+    int retcode = 0;
+    qsort(q->items, q->count, sizeof(queue_item), item_compare);
+
+    int start = 0;
+    while (start < q->count && retcode == 0){
+        int end = start + 1;
+        // outlines only merge within a single color, fills and textures merge across colors
+        while (end < q->count && same_batch(&q->items[start], &q->items[end])
+            && (q->items[start].kind != ITEM_OUTLINE || q->items[start].color == q->items[end].color)){
+            end++;
+        }
+        retcode = flush_run(&q->items[start], end - start);
+        start = end;
+    }
+    q->count = 0;
+    batch_reset(&g_batch);
+
+    int code = set_draw_state(g_drawstate.draw_color, g_drawstate.blend_mode);
+    return retcode != 0 ? retcode : code;
+}
@@ -0,0 +1,373 @@
+#include "internal.h"
+
+/*
+    Threaded rendering
+
+    In threaded mode the SDL renderer calls of a context are recorded into a command stream instead of
+    executed. S2D_presentRender hands the stream of the finished frame to a render thread owned by the
+    library, which replays it to SDL and presents while the application builds the next frame.
+    At most frames_in_flight frames are queued, S2D_presentRender blocks beyond that.
+
+    SDL calls that can not be deferred, texture creation and updates, read back and render target
+    drawing, go through rt_call. It submits the commands recorded so far, waits for the render thread
+    to replay everything queued and runs the call on the render thread, which keeps the renderer and
+    its graphics context on a single thread.
+*/
+
+typedef enum {RT_COLOR, RT_BLEND, RT_CLIP, RT_CLEAR, RT_SCALE, RT_RECTS, RT_POINTS, RT_COPY, RT_GEOMETRY, RT_TARGET, RT_PRESENT} rt_op;
+
+// records are 16 byte aligned, the payload follows the header
+typedef struct {
+    Uint16 op;
+    Uint8 flag;
+    Uint8 flag2;
+    Uint32 size;
+    Uint32 count;
+    Uint32 count2;
+} rt_record;
+
+typedef struct {
+    SDL_Texture* texture;
+    SDL_Rect src;
+    SDL_FRect dst;
+    double angle;
+    SDL_FPoint pivot;
+} rt_copy_payload;
+
+typedef struct {
+    Uint8* data;
+    size_t size;
+    size_t capacity;
+} rt_stream;
+
+struct render_thread {
+    S2D_Context* ctx;
+    SDL_Thread* thread;
+    SDL_threadID thread_id;
+    SDL_mutex* lock;
+    SDL_cond* cond;
+    rt_stream* streams;
+    int stream_count;
+    Uint64 submitted;
+    Uint64 completed;
+    int (*call_fn)(void*);
+    void* call_arg;
+    int call_result;
+    bool call_pending;
+    bool quit;
+};
+
+#define RT_ALIGN 16
+
+// the render thread of the current context while commands are recorded, NULL when calls go to SDL directly
+static render_thread* recording_thread(){
+    render_thread* rt = current_context()->render_thread;
+    if (rt == NULL || SDL_ThreadID() == rt->thread_id) return NULL;
+    return rt;
+}
+
+static void* record(render_thread* rt, rt_op op, Uint8 flag, Uint32 count, Uint32 count2, size_t payload){
+    rt_stream* s = &rt->streams[rt->submitted % rt->stream_count];
+    size_t size = (sizeof(rt_record) + payload + RT_ALIGN - 1) & ~(size_t)(RT_ALIGN - 1);
+    if (s->size + size > s->capacity){
+        size_t cap = s->capacity > 0 ? s->capacity : 1 << 16;
+        while (cap < s->size + size) cap *= 2;
+        Uint8* n = realloc(s->data, cap);
+        if (n == NULL) return NULL;
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+        s->data = n;
+        s->capacity = cap;
+    }
+    rt_record* r = (rt_record*)(s->data + s->size);
+    *r = (rt_record){.op = op, .flag = flag, .size = (Uint32) size, .count = count, .count2 = count2};
+    s->size += size;
+    return r + 1;
+}
+
+static void replay(SDL_Renderer* renderer, const rt_stream* s){
+    for (size_t off = 0; off < s->size;){
+        const rt_record* r = (const rt_record*)(s->data + off);
+        const void* p = r + 1;
+        off += r->size;
+        switch (r->op){
+            case RT_COLOR: {
+                Uint32 c = r->count;
+                SDL_SetRenderDrawColor(renderer, c&0xFF, (c>>8)&0xFF, (c>>16)&0xFF, c>>24);
+                break;
+            }
+            case RT_BLEND: SDL_SetRenderDrawBlendMode(renderer, (SDL_BlendMode) r->count); break;
+            case RT_CLIP: SDL_RenderSetClipRect(renderer, r->flag ? p : NULL); break;
+            case RT_CLEAR: SDL_RenderClear(renderer); break;
+            case RT_SCALE: SDL_RenderSetScale(renderer, ((const float*) p)[0], ((const float*) p)[1]); break;
+            case RT_RECTS:
+                if (r->flag) SDL_RenderFillRectsF(renderer, p, r->count);
+                else SDL_RenderDrawRectsF(renderer, p, r->count);
+                break;
+            case RT_POINTS:
+                if (r->flag) SDL_RenderDrawLinesF(renderer, p, r->count);
+                else SDL_RenderDrawPointsF(renderer, p, r->count);
+                break;
+            case RT_COPY: {
+                const rt_copy_payload* c = p;
+                const SDL_Rect* src = r->flag ? &c->src : NULL;
+                if (r->flag2) SDL_RenderCopyExF(renderer, c->texture, src, &c->dst, c->angle, &c->pivot, SDL_FLIP_NONE);
+                else SDL_RenderCopyF(renderer, c->texture, src, &c->dst);
+                break;
+            }
+            case RT_GEOMETRY: {
+                SDL_Texture* texture = *(SDL_Texture* const*) p;
+                const SDL_Vertex* v = (const SDL_Vertex*)((const Uint8*) p + RT_ALIGN);
+                const int* idx = (const int*)(v + r->count);
+                SDL_RenderGeometry(renderer, texture, v, r->count, idx, r->count2);
+                break;
+            }
+            case RT_TARGET: SDL_SetRenderTarget(renderer, *(SDL_Texture* const*) p); break;
+            case RT_PRESENT: SDL_RenderPresent(renderer); break;
+        }
+    }
+}
+
+static int render_thread_proc(void* data){
+    render_thread* rt = data;
+    // library calls made by rt_call functions resolve to the context of this thread
+    t_context = rt->ctx;
+    SDL_LockMutex(rt->lock);
+    for (;;){
+        if (rt->completed < rt->submitted){
+            const rt_stream* s = &rt->streams[rt->completed % rt->stream_count];
+            SDL_UnlockMutex(rt->lock);
+            TRACE_BEGIN("render thread replay");
+            replay(rt->ctx->renderer, s);
+            TRACE_END();
+            SDL_LockMutex(rt->lock);
+            rt->completed++;
+            SDL_CondBroadcast(rt->cond);
+        } else if (rt->call_pending){
+            SDL_UnlockMutex(rt->lock);
+            int result = rt->call_fn(rt->call_arg);
+            SDL_LockMutex(rt->lock);
+            rt->call_result = result;
+            rt->call_pending = FALSE;
+            SDL_CondBroadcast(rt->cond);
+        } else if (rt->quit){
+            break;
+        } else {
+            SDL_CondWait(rt->cond, rt->lock);
+        }
+    }
+    SDL_UnlockMutex(rt->lock);
+    S2D_frameArenaRelease();
+    return 0;
+}
+
+// hands the recorded stream to the render thread, waiting for a free stream if too many frames are queued
+static void submit(render_thread* rt){
+    SDL_LockMutex(rt->lock);
+    rt->submitted++;
+    SDL_CondBroadcast(rt->cond);
+    while (rt->submitted - rt->completed >= (Uint64) rt->stream_count) SDL_CondWait(rt->cond, rt->lock);
+    SDL_UnlockMutex(rt->lock);
+    rt->streams[rt->submitted % rt->stream_count].size = 0;
+}
+
+static int call_on(render_thread* rt, int (*fn)(void*), void* arg){
+    TRACE_BEGIN("rt_call");
+    if (rt->streams[rt->submitted % rt->stream_count].size > 0) submit(rt);
+    SDL_LockMutex(rt->lock);
+    rt->call_fn = fn;
+    rt->call_arg = arg;
+    rt->call_pending = TRUE;
+    SDL_CondBroadcast(rt->cond);
+    while (rt->call_pending) SDL_CondWait(rt->cond, rt->lock);
+    int result = rt->call_result;
+    SDL_UnlockMutex(rt->lock);
+    TRACE_END();
+    return result;
+}
+
+int rt_call(int (*fn)(void*), void* arg){
+    render_thread* rt = recording_thread();
+    if (rt == NULL) return fn(arg);
+    return call_on(rt, fn, arg);
+}
+
+int rt_draw_color(Uint32 rgba){
+    render_thread* rt = recording_thread();
+    if (rt == NULL) return SDL_SetRenderDrawColor(g_RENDERER, rgba&0xFF, (rgba>>8)&0xFF, (rgba>>16)&0xFF, rgba>>24);
+    return record(rt, RT_COLOR, 0, rgba, 0, 0) != NULL ? 0 : -1;
+}
+
+int rt_blend_mode(BlendMode mode){
+    render_thread* rt = recording_thread();
+    if (rt == NULL) return SDL_SetRenderDrawBlendMode(g_RENDERER, blendmode_SDL2(mode));
+    return record(rt, RT_BLEND, 0, blendmode_SDL2(mode), 0, 0) != NULL ? 0 : -1;
+}
+
+int rt_clip(const SDL_Rect* clip){
+    render_thread* rt = recording_thread();
+    if (rt == NULL) return SDL_RenderSetClipRect(g_RENDERER, clip);
+    SDL_Rect* p = record(rt, RT_CLIP, clip != NULL, 0, 0, sizeof(SDL_Rect));
+    if (p == NULL) return -1;
+    if (clip != NULL) *p = *clip;
+    return 0;
+}
+
+int rt_clear(){
+    render_thread* rt = recording_thread();
+    if (rt == NULL) return SDL_RenderClear(g_RENDERER);
+    return record(rt, RT_CLEAR, 0, 0, 0, 0) != NULL ? 0 : -1;
+}
+
+int rt_scale(float x_scale, float y_scale){
+    render_thread* rt = recording_thread();
+    if (rt == NULL) return SDL_RenderSetScale(g_RENDERER, x_scale, y_scale);
+    float* p = record(rt, RT_SCALE, 0, 0, 0, 2 * sizeof(float));
+    if (p == NULL) return -1;
+    p[0] = x_scale, p[1] = y_scale;
+    return 0;
+}
+
+int rt_rects(const SDL_FRect* frects, const SDL_Rect* rects, int n, bool fill){
+    render_thread* rt = recording_thread();
+    if (rt == NULL){
+        if (frects != NULL) return fill ? SDL_RenderFillRectsF(g_RENDERER, frects, n) : SDL_RenderDrawRectsF(g_RENDERER, frects, n);
+        return fill ? SDL_RenderFillRects(g_RENDERER, rects, n) : SDL_RenderDrawRects(g_RENDERER, rects, n);
+    }
+    SDL_FRect* p = record(rt, RT_RECTS, fill, n, 0, n * sizeof(SDL_FRect));
+    if (p == NULL) return -1;
+    for (int i = 0; i < n; i++) p[i] = frects != NULL ? frects[i] : (SDL_FRect){rects[i].x, rects[i].y, rects[i].w, rects[i].h};
+    return 0;
+}
+
+int rt_points(const SDL_FPoint* fpoints, const SDL_Point* points, int n, bool strip){
+    render_thread* rt = recording_thread();
+    if (rt == NULL){
+        if (fpoints != NULL) return strip ? SDL_RenderDrawLinesF(g_RENDERER, fpoints, n) : SDL_RenderDrawPointsF(g_RENDERER, fpoints, n);
+        return strip ? SDL_RenderDrawLines(g_RENDERER, points, n) : SDL_RenderDrawPoints(g_RENDERER, points, n);
+    }
+    SDL_FPoint* p = record(rt, RT_POINTS, strip, n, 0, n * sizeof(SDL_FPoint));
+    if (p == NULL) return -1;
+    for (int i = 0; i < n; i++) p[i] = fpoints != NULL ? fpoints[i] : (SDL_FPoint){points[i].x, points[i].y};
+    return 0;
+}
+
+// pivot NULL draws without rotation
+int rt_copy(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect* dst, double angle, const SDL_FPoint* pivot){
+    render_thread* rt = recording_thread();
+    if (rt == NULL){
+        if (pivot == NULL) return SDL_RenderCopyF(g_RENDERER, texture, src, dst);
+        return SDL_RenderCopyExF(g_RENDERER, texture, src, dst, angle, pivot, SDL_FLIP_NONE);
+    }
+    rt_copy_payload* p = record(rt, RT_COPY, src != NULL, 0, 0, sizeof(rt_copy_payload));
+    if (p == NULL) return -1;
+    ((rt_record*) p - 1)->flag2 = pivot != NULL;
+    *p = (rt_copy_payload){.texture = texture, .dst = *dst, .angle = angle};
+    if (src != NULL) p->src = *src;
+    if (pivot != NULL) p->pivot = *pivot;
+    return 0;
+}
+
+int rt_geometry(SDL_Texture* texture, const SDL_Vertex* v, int nv, const int* idx, int ni){
+    render_thread* rt = recording_thread();
+    if (rt == NULL) return SDL_RenderGeometry(g_RENDERER, texture, v, nv, idx, ni);
+    Uint8* p = record(rt, RT_GEOMETRY, 0, nv, ni, RT_ALIGN + nv * sizeof(SDL_Vertex) + ni * sizeof(int));
+    if (p == NULL) return -1;
+    *(SDL_Texture**) p = texture;
+    SDL_memcpy(p + RT_ALIGN, v, nv * sizeof(SDL_Vertex));
+    SDL_memcpy(p + RT_ALIGN + nv * sizeof(SDL_Vertex), idx, ni * sizeof(int));
+    return 0;
+}
+
+// SDL resets the render scale and clip rectangle of the target on every switch
+int rt_target(SDL_Texture* texture){
+    render_thread* rt = recording_thread();
+    if (rt == NULL) return SDL_SetRenderTarget(g_RENDERER, texture);
+    SDL_Texture** p = record(rt, RT_TARGET, 0, 0, 0, sizeof(SDL_Texture*));
+    if (p == NULL) return -1;
+    *p = texture;
+    return 0;
+}
+
+static int present_proc(void* renderer){
+    SDL_RenderPresent(renderer);
+    return 0;
+}
+
+void rt_present(){
+    render_thread* rt = recording_thread();
+    if (rt == NULL){
+        SDL_RenderPresent(g_RENDERER);
+        return;
+    }
+    if (record(rt, RT_PRESENT, 0, 0, 0, 0) == NULL){
+        // without memory for the record the frame is presented once everything queued is replayed
+        call_on(rt, present_proc, g_RENDERER);
+        return;
+    }
+    submit(rt);
+}
+
+// GL contexts can only be current on one thread, the thread giving up the renderer releases it
+static void release_gl_context(S2D_Context* ctx){
+    SDL_RendererInfo info;
+    if (ctx->window != NULL && SDL_GetRendererInfo(ctx->renderer, &info) == 0 && SDL_strncmp(info.name, "opengl", 6) == 0){
+        SDL_GL_MakeCurrent(ctx->window, NULL);
+    }
+}
+
+static int release_proc(void* ctx){
+    release_gl_context(ctx);
+    return 0;
+}
+
+static void stop_render_thread(render_thread* rt){
+    if (rt->thread != NULL){
+        call_on(rt, release_proc, rt->ctx);
+        SDL_LockMutex(rt->lock);
+        rt->quit = TRUE;
+        SDL_CondBroadcast(rt->cond);
+        SDL_UnlockMutex(rt->lock);
+        SDL_WaitThread(rt->thread, NULL);
+    }
+    for (int i = 0; i < rt->stream_count; i++) free(rt->streams[i].data);
+    free(rt->streams);
+    if (rt->cond != NULL) SDL_DestroyCond(rt->cond);
+    if (rt->lock != NULL) SDL_DestroyMutex(rt->lock);
+    free(rt);
+}
+
+// draws everything queued and joins the render thread, the renderer goes back to the calling thread
+void rt_shutdown(S2D_Context* ctx){
+    if (ctx->render_thread == NULL) return;
+    stop_render_thread(ctx->render_thread);
+    ctx->render_thread = NULL;
+}
+
+int S2D_setThreadedRendering(bool enabled, int frames_in_flight){
+    S2D_Context* ctx = current_context();
+    rt_shutdown(ctx);
+    if (!enabled) return 0;
+    if (ctx->renderer == NULL || frames_in_flight < 0) return ERROR_RENDER_THREAD;
+    if (frames_in_flight == 0) frames_in_flight = 2;
+
+    render_thread* rt = calloc(1, sizeof(render_thread));
+    if (rt == NULL) return ERROR_RENDER_THREAD;
+    rt->ctx = ctx;
+    rt->stream_count = frames_in_flight + 1;
+    rt->streams = calloc(rt->stream_count, sizeof(rt_stream));
+    rt->lock = SDL_CreateMutex();
+    rt->cond = SDL_CreateCond();
+    if (rt->streams == NULL || rt->lock == NULL || rt->cond == NULL){
+        stop_render_thread(rt);
+        return ERROR_RENDER_THREAD;
+    }
+    release_gl_context(ctx);
+    rt->thread = SDL_CreateThread(render_thread_proc, "S2D render", rt);
+    if (rt->thread == NULL){
+        stop_render_thread(rt);
+        return ERROR_RENDER_THREAD;
+    }
+    rt->thread_id = SDL_GetThreadID(rt->thread);
+    ctx->render_thread = rt;
+    return 0;
+}
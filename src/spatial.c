@@ -0,0 +1,385 @@
+#include "internal.h"
+
+/*
+    Uniform grid spatial hash over axis aligned boxes
+
+    Entity bounds are stored as structure of arrays so queries only touch the data they test.
+    Each entity remembers the range of cells it covers, a move that stays within the same range
+    only updates the bounds. Cells live in an open addressing hash table keyed by cell coordinates,
+    so the grid is unbounded. A cell whose last entity leaves is deleted from the table by shifting
+    its probe chain back and its bucket is recycled, so memory follows the largest occupied area
+    rather than every cell an entity has ever passed through.
+*/
+
+// bucket index of an unused table slot, every 64 bit value is the key of some cell
+#define CELL_EMPTY (-1)
+
+typedef struct {
+    int* ids;
+    int count;
+    int capacity;
+    int next_free;      // next recycled bucket while this one is unused
+} cell_bucket;
+
+struct S2D_SpatialGrid {
+    float cell_size;
+    float inv_cell_size;
+
+    // entity data, indexed by entity id
+    float *minx, *miny, *maxx, *maxy;
+    int *cx0, *cy0, *cx1, *cy1;
+    Uint32* stamp;
+    bool* alive;
+    int entity_capacity;
+    int entity_count;
+    int* free_ids;
+    int free_count;
+    Uint32 query_stamp;
+
+    // cell coordinates -> bucket
+    Uint64* keys;
+    int* bucket_index;
+    int table_capacity;
+    int table_count;
+    cell_bucket* buckets;
+    int bucket_count;
+    int bucket_capacity;
+    int free_bucket;    // head of the recycled buckets, -1 if none
+};
+
+static inline Uint64 cell_key(int cx, int cy){
+    return ((Uint64)(Uint32) cx << 32) | (Uint32) cy;
+}
+
+static inline Uint32 cell_hash(Uint64 key){
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (Uint32) key;
+}
+
+static inline int cell_coord(const S2D_SpatialGrid* g, float v){
+    return (int) SDL_floorf(v * g->inv_cell_size);
+}
+
+static int table_grow(S2D_SpatialGrid* g){
+    int cap = g->table_capacity > 0 ? 2*g->table_capacity : 1024;
+    Uint64* keys = malloc(cap * sizeof(Uint64));
+    int* index = malloc(cap * sizeof(int));
+    if (keys == NULL || index == NULL){
+        free(keys);
+        free(index);
+        return -1;
+    }
+    memset(index, 0xFF, cap * sizeof(int));
+    for (int i = 0; i < g->table_capacity; i++){
+        if (g->bucket_index[i] == CELL_EMPTY) continue;
+        Uint32 slot = cell_hash(g->keys[i]) & (cap - 1);
+        while (index[slot] != CELL_EMPTY) slot = (slot + 1) & (cap - 1);
+        keys[slot] = g->keys[i];
+        index[slot] = g->bucket_index[i];
+    }
+    free(g->keys);
+    free(g->bucket_index);
+    g->keys = keys;
+    g->bucket_index = index;
+    g->table_capacity = cap;
+    return 0;
+}
+
+// the table slot of a cell, -1 if the cell has no bucket
+static int cell_slot(const S2D_SpatialGrid* g, Uint64 key){
+    if (g->table_capacity == 0) return -1;
+    Uint32 slot = cell_hash(key) & (g->table_capacity - 1);
+    while (g->bucket_index[slot] != CELL_EMPTY){
+        if (g->keys[slot] == key) return (int) slot;
+        slot = (slot + 1) & (g->table_capacity - 1);
+    }
+    return -1;
+}
+
+// returns the bucket of a cell, NULL if the cell has none and create is FALSE
+static cell_bucket* cell_lookup(S2D_SpatialGrid* g, int cx, int cy, bool create){
+    Uint64 key = cell_key(cx, cy);
+    int found = cell_slot(g, key);
+    if (found >= 0) return &g->buckets[g->bucket_index[found]];
+    if (!create) return NULL;
+
+    if (2*(g->table_count + 1) > g->table_capacity && table_grow(g) != 0) return NULL;
+    int index;
+    if (g->free_bucket >= 0){
+        // recycled buckets keep their id arrays
+        index = g->free_bucket;
+        g->free_bucket = g->buckets[index].next_free;
+    } else {
+        if (g->bucket_count == g->bucket_capacity){
+        int cap = g->bucket_capacity > 0 ? 2*g->bucket_capacity : 512;
+            cell_bucket* b = realloc(g->buckets, cap * sizeof(cell_bucket));
+            if (b == NULL) return NULL;
+            g->buckets = b;
+            g->bucket_capacity = cap;
+        }
+        index = g->bucket_count++;
+        g->buckets[index].ids = NULL;
+        g->buckets[index].capacity = 0;
+    }
+    Uint32 slot = cell_hash(key) & (g->table_capacity - 1);
+    while (g->bucket_index[slot] != CELL_EMPTY) slot = (slot + 1) & (g->table_capacity - 1);
+    g->keys[slot] = key;
+    g->bucket_index[slot] = index;
+    g->table_count++;
+    cell_bucket* b = &g->buckets[index];
+    b->count = 0;
+    b->next_free = -1;
+    return b;
+}
+
+/*
+    deletes a cell from the table with backward shift deletion, entries after the hole move into it
+    when their home slot does not lie between the hole and their position, which keeps every probe
+    chain unbroken without tombstones. The bucket goes onto the recycled list.
+*/
+static void cell_delete(S2D_SpatialGrid* g, int slot){
+    Uint32 mask = g->table_capacity - 1;
+    int index = g->bucket_index[slot];
+    g->buckets[index].next_free = g->free_bucket;
+    g->free_bucket = index;
+
+    Uint32 hole = slot, j = slot;
+    for (;;){
+        j = (j + 1) & mask;
+        if (g->bucket_index[j] == CELL_EMPTY) break;
+        Uint32 home = cell_hash(g->keys[j]) & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)){
+            g->keys[hole] = g->keys[j];
+            g->bucket_index[hole] = g->bucket_index[j];
+            hole = j;
+        }
+    }
+    g->bucket_index[hole] = CELL_EMPTY;
+    g->table_count--;
+}
+
+static int cell_add(S2D_SpatialGrid* g, int cx, int cy, int id){
+    cell_bucket* b = cell_lookup(g, cx, cy, TRUE);
+    if (b == NULL) return -1;
+    if (b->count == b->capacity){
+        int cap = b->capacity > 0 ? 2*b->capacity : 4;
+        int* ids = realloc(b->ids, cap * sizeof(int));
+        if (ids == NULL){
+            // a cell created for this id is not left behind empty
+            if (b->count == 0) cell_delete(g, cell_slot(g, cell_key(cx, cy)));
+            return -1;
+        }
+        b->ids = ids;
+        b->capacity = cap;
+    }
+    b->ids[b->count++] = id;
+    return 0;
+}
+
+static void cell_remove(S2D_SpatialGrid* g, int cx, int cy, int id){
+    int slot = cell_slot(g, cell_key(cx, cy));
+    if (slot < 0) return;
+    cell_bucket* b = &g->buckets[g->bucket_index[slot]];
+    for (int i = 0; i < b->count; i++){
+        if (b->ids[i] == id){
+            b->ids[i] = b->ids[--b->count];
+            if (b->count == 0) cell_delete(g, slot);
+            return;
+        }
+    }
+}
+
+static int entities_grow(S2D_SpatialGrid* g, int cap){
+    #define GROW(field) { void* p = realloc(g->field, cap * sizeof(*g->field)); if (p == NULL) return -1; g->field = p; }
+    GROW(minx) GROW(miny) GROW(maxx) GROW(maxy)
+    GROW(cx0) GROW(cy0) GROW(cx1) GROW(cy1)
+    GROW(stamp) GROW(alive) GROW(free_ids)
+    #undef GROW
+    memset(g->stamp + g->entity_capacity, 0, (cap - g->entity_capacity) * sizeof(Uint32));
+    g->entity_capacity = cap;
+    return 0;
+}
+
+S2D_SpatialGrid* S2D_createSpatialGrid(float cell_size, int expected_entities){
+    if (cell_size <= 0) return NULL;
+    S2D_SpatialGrid* g = calloc(1, sizeof(S2D_SpatialGrid));
+    if (g == NULL) return NULL;
+    g->cell_size = cell_size;
+    g->inv_cell_size = 1.0f / cell_size;
+    g->free_bucket = -1;
+    if (entities_grow(g, expected_entities > 0 ? expected_entities : 256) != 0){
+        S2D_destroySpatialGrid(g);
+        return NULL;
+    }
+    return g;
+}
+
+void S2D_destroySpatialGrid(S2D_SpatialGrid* g){
+    if (g == NULL) return;
+    free(g->minx), free(g->miny), free(g->maxx), free(g->maxy);
+    free(g->cx0), free(g->cy0), free(g->cx1), free(g->cy1);
+    free(g->stamp), free(g->alive), free(g->free_ids);
+    for (int i = 0; i < g->bucket_count; i++) free(g->buckets[i].ids);
+    free(g->buckets);
+    free(g->keys);
+    free(g->bucket_index);
+    free(g);
+}
+
+static void set_bounds(S2D_SpatialGrid* g, int id, const fRectangle* box){
+    g->minx[id] = box->origin.x;
+    g->miny[id] = box->origin.y;
+    g->maxx[id] = box->origin.x + box->w;
+    g->maxy[id] = box->origin.y + box->h;
+}
+
+int S2D_gridInsertF(S2D_SpatialGrid* g, const fRectangle* box){
+    int id;
+    if (g->free_count > 0){
+        id = g->free_ids[--g->free_count];
+    } else {
+        if (g->entity_count == g->entity_capacity && entities_grow(g, 2*g->entity_capacity) != 0) return -1;
+        id = g->entity_count++;
+    }
+    set_bounds(g, id, box);
+    g->cx0[id] = cell_coord(g, g->minx[id]);
+    g->cy0[id] = cell_coord(g, g->miny[id]);
+    g->cx1[id] = cell_coord(g, g->maxx[id]);
+    g->cy1[id] = cell_coord(g, g->maxy[id]);
+    for (int cy = g->cy0[id]; cy <= g->cy1[id]; cy++){
+        for (int cx = g->cx0[id]; cx <= g->cx1[id]; cx++){
+            if (cell_add(g, cx, cy, id) == 0) continue;
+            // undo the cells added so far, row major up to the failing one
+            for (int uy = g->cy0[id]; uy <= cy; uy++){
+                for (int ux = g->cx0[id]; ux <= g->cx1[id] && (uy < cy || ux < cx); ux++) cell_remove(g, ux, uy, id);
+            }
+            g->alive[id] = FALSE;
+            g->free_ids[g->free_count++] = id;
+            return -1;
+        }
+    }
+    g->alive[id] = TRUE;
+    return id;
+}
+
+int S2D_gridInsert(S2D_SpatialGrid* g, const Rectangle* box){
+    fRectangle f = {{box->origin.x, box->origin.y}, box->w, box->h};
+    return S2D_gridInsertF(g, &f);
+}
+
+int S2D_gridMoveF(S2D_SpatialGrid* g, int id, const fRectangle* box){
+    if (id < 0 || id >= g->entity_count || !g->alive[id]) return -1;
+    set_bounds(g, id, box);
+    int ncx0 = cell_coord(g, g->minx[id]), ncy0 = cell_coord(g, g->miny[id]);
+    int ncx1 = cell_coord(g, g->maxx[id]), ncy1 = cell_coord(g, g->maxy[id]);
+    int ocx0 = g->cx0[id], ocy0 = g->cy0[id], ocx1 = g->cx1[id], ocy1 = g->cy1[id];
+    if (ncx0 == ocx0 && ncy0 == ocy0 && ncx1 == ocx1 && ncy1 == ocy1) return 0;
+
+    // only cells entering or leaving the covered range are touched
+    for (int cy = ocy0; cy <= ocy1; cy++){
+        for (int cx = ocx0; cx <= ocx1; cx++){
+            if (cx < ncx0 || cx > ncx1 || cy < ncy0 || cy > ncy1) cell_remove(g, cx, cy, id);
+        }
+    }
+    for (int cy = ncy0; cy <= ncy1; cy++){
+        for (int cx = ncx0; cx <= ncx1; cx++){
+            if (cx < ocx0 || cx > ocx1 || cy < ocy0 || cy > ocy1){
+                if (cell_add(g, cx, cy, id) != 0) return -1;
+            }
+        }
+    }
+    g->cx0[id] = ncx0, g->cy0[id] = ncy0, g->cx1[id] = ncx1, g->cy1[id] = ncy1;
+    return 0;
+}
+
+int S2D_gridMove(S2D_SpatialGrid* g, int id, const Rectangle* box){
+    fRectangle f = {{box->origin.x, box->origin.y}, box->w, box->h};
+    return S2D_gridMoveF(g, id, &f);
+}
+
+void S2D_gridRemove(S2D_SpatialGrid* g, int id){
+    if (id < 0 || id >= g->entity_count || !g->alive[id]) return;
+    for (int cy = g->cy0[id]; cy <= g->cy1[id]; cy++){
+        for (int cx = g->cx0[id]; cx <= g->cx1[id]; cx++){
+            cell_remove(g, cx, cy, id);
+        }
+    }
+    g->alive[id] = FALSE;
+    g->free_ids[g->free_count++] = id;
+}
+
+static Uint32 next_stamp(S2D_SpatialGrid* g){
+    if (++g->query_stamp == 0){
+        memset(g->stamp, 0, g->entity_capacity * sizeof(Uint32));
+        g->query_stamp = 1;
+    }
+    return g->query_stamp;
+}
+
+static int query_box(S2D_SpatialGrid* g, float x0, float y0, float x1, float y1, bool point, int* out, int max){
+    Uint32 stamp = next_stamp(g);
+    int found = 0;
+    int cx0 = cell_coord(g, x0), cy0 = cell_coord(g, y0);
+    int cx1 = cell_coord(g, x1), cy1 = cell_coord(g, y1);
+    for (int cy = cy0; cy <= cy1; cy++){
+        for (int cx = cx0; cx <= cx1; cx++){
+            cell_bucket* b = cell_lookup(g, cx, cy, FALSE);
+            if (b == NULL) continue;
+            for (int i = 0; i < b->count; i++){
+                int id = b->ids[i];
+                if (g->stamp[id] == stamp) continue;
+                g->stamp[id] = stamp;
+                bool hit = point
+                    ? (x0 >= g->minx[id] && x0 < g->maxx[id] && y0 >= g->miny[id] && y0 < g->maxy[id])
+                    : (x0 < g->maxx[id] && g->minx[id] < x1 && y0 < g->maxy[id] && g->miny[id] < y1);
+                if (!hit) continue;
+                if (found < max) out[found] = id;
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+int S2D_gridQueryF(S2D_SpatialGrid* g, const fRectangle* box, int* out, int max){
+    return query_box(g, box->origin.x, box->origin.y, box->origin.x + box->w, box->origin.y + box->h, FALSE, out, max);
+}
+
+int S2D_gridQuery(S2D_SpatialGrid* g, const Rectangle* box, int* out, int max){
+    fRectangle f = {{box->origin.x, box->origin.y}, box->w, box->h};
+    return S2D_gridQueryF(g, &f, out, max);
+}
+
+int S2D_gridQueryPointF(S2D_SpatialGrid* g, fVector p, int* out, int max){
+    return query_box(g, p.x, p.y, p.x, p.y, TRUE, out, max);
+}
+
+int S2D_gridQueryPoint(S2D_SpatialGrid* g, Vector p, int* out, int max){
+    return S2D_gridQueryPointF(g, (fVector){p.x, p.y}, out, max);
+}
+
+int S2D_gridForEachPair(S2D_SpatialGrid* g, void (*callback)(int, int, void*), void* data){
+    int pairs = 0;
+    for (int slot = 0; slot < g->table_capacity; slot++){
+        if (g->bucket_index[slot] == CELL_EMPTY) continue;
+        int cx = (int)(Uint32)(g->keys[slot] >> 32);
+        int cy = (int)(Uint32) g->keys[slot];
+        cell_bucket* b = &g->buckets[g->bucket_index[slot]];
+        for (int i = 0; i < b->count; i++){
+            int a = b->ids[i];
+            for (int j = i + 1; j < b->count; j++){
+                int c = b->ids[j];
+                if (!(g->minx[a] < g->maxx[c] && g->minx[c] < g->maxx[a] && g->miny[a] < g->maxy[c] && g->miny[c] < g->maxy[a])) continue;
+                // a pair sharing several cells is reported only from the first cell they share
+                int fx = g->cx0[a] > g->cx0[c] ? g->cx0[a] : g->cx0[c];
+                int fy = g->cy0[a] > g->cy0[c] ? g->cy0[a] : g->cy0[c];
+                if (fx != cx || fy != cy) continue;
+                if (callback != NULL) callback(a < c ? a : c, a < c ? c : a, data);
+                pairs++;
+            }
+        }
+    }
+    return pairs;
+}
@@ -0,0 +1,121 @@
+#include "internal.h"
+#include <stdio.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_dir(path) _mkdir(path)
+#else
+#define make_dir(path) mkdir(path, 0755)
+#endif
+
+/*
+    Cache of decoded textures, one file per source image named after the hash of its path.
+    A cache file holds a header, the source path and the pixels in INTERNAL_PIXEL_FORMAT at a 64 byte aligned offset.
+    It is valid while the source path, size and modification time match the header, stale files are overwritten.
+    The files use the byte order of the machine that wrote them, the cache is not meant to be shared between machines.
+*/
+
+#define CACHE_MAGIC "S2DTEX1"
+#define CACHE_ALIGN 64
+
+typedef struct {
+    char magic[8];
+    Uint32 format;
+    Uint32 width;
+    Uint32 height;
+    Uint32 pitch;
+    Uint64 source_size;
+    Sint64 source_mtime;
+    Uint32 path_len;
+    Uint32 reserved;
+} cache_header;
+
+static char* g_cache_dir;
+
+int S2D_setTextureCache(const char* dir){
+    SDL_free(g_cache_dir);
+    g_cache_dir = NULL;
+    if (dir == NULL) return 0;
+    if (make_dir(dir) != 0 && errno != EEXIST) return ERROR_TEXTURE_CACHE;
+    g_cache_dir = SDL_strdup(dir);
+    return g_cache_dir == NULL ? ERROR_TEXTURE_CACHE : 0;
+}
+
+static Uint64 hash_path(const char* path){
+    Uint64 h = 0xcbf29ce484222325ULL;
+    for (; *path != '\0'; path++){
+        h ^= (Uint8) *path;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void cache_file(const char* path, char* out, size_t out_size){
+    SDL_snprintf(out, out_size, "%s/%016llx.s2dtex", g_cache_dir, (unsigned long long) hash_path(path));
+}
+
+static size_t pixel_offset(Uint32 path_len){
+    return (sizeof(cache_header) + path_len + CACHE_ALIGN - 1) & ~(size_t)(CACHE_ALIGN - 1);
+}
+
+SDL_Surface* texcache_load(const char* path, void** mapping, size_t* mapping_size){
+    char file[4096];
+    struct stat st;
+    if (g_cache_dir == NULL || stat(path, &st) != 0) return NULL;
+    cache_file(path, file, sizeof(file));
+
+    void* base;
+    size_t size;
+    if (map_file(file, TRUE, &base, &size) != 0) return NULL;
+    cache_header h;
+    size_t path_len = SDL_strlen(path);
+    if (size >= sizeof(h)) SDL_memcpy(&h, base, sizeof(h));
+    bool valid = size >= sizeof(h) && SDL_memcmp(h.magic, CACHE_MAGIC, 8) == 0 && h.format == INTERNAL_PIXEL_FORMAT
+        && h.source_size == (Uint64) st.st_size && h.source_mtime == (Sint64) st.st_mtime
+        && h.path_len == path_len && size >= pixel_offset(h.path_len) + (size_t) h.pitch * h.height
+        && h.pitch >= h.width * INTERNAL_PIXEL_SIZE
+        && SDL_memcmp((Uint8*) base + sizeof(h), path, path_len) == 0;
+    SDL_Surface* surf = valid ? SDL_CreateRGBSurfaceWithFormatFrom((Uint8*) base + pixel_offset(h.path_len),
+        h.width, h.height, SDL_BITSPERPIXEL(INTERNAL_PIXEL_FORMAT), h.pitch, INTERNAL_PIXEL_FORMAT) : NULL;
+    if (surf == NULL){
+        unmap_file(base, size);
+        return NULL;
+    }
+    *mapping = base;
+    *mapping_size = size;
+    return surf;
+}
+
+void texcache_store(const char* path, SDL_Surface* surf){
+    char file[4096], tmp[4224];
+    struct stat st;
+    if (g_cache_dir == NULL || stat(path, &st) != 0) return;
+    TRACE_BEGIN("texcache_store");
+    cache_file(path, file, sizeof(file));
+    // per thread temporary names, contexts on several threads may decode the same image at once
+    SDL_snprintf(tmp, sizeof(tmp), "%s.%lu.tmp", file, SDL_ThreadID());
+
+    cache_header h = {.magic = CACHE_MAGIC, .format = INTERNAL_PIXEL_FORMAT, .width = surf->w, .height = surf->h,
+        .pitch = surf->pitch, .source_size = st.st_size, .source_mtime = st.st_mtime, .path_len = SDL_strlen(path)};
+    static const Uint8 zeros[CACHE_ALIGN];
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL){
+        TRACE_END();
+        return;
+    }
+    size_t pad = pixel_offset(h.path_len) - sizeof(h) - h.path_len;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(path, 1, h.path_len, f) == h.path_len
+        && fwrite(zeros, 1, pad, f) == pad
+        && fwrite(surf->pixels, surf->pitch, surf->h, f) == (size_t) surf->h;
+    // written under a temporary name and renamed so readers never map a partial file
+    if (fclose(f) != 0 || !ok) remove(tmp);
+    else {
+#ifdef _WIN32
+        remove(file);
+#endif
+        if (rename(tmp, file) != 0) remove(tmp);
+    }
+    TRACE_END();
+}
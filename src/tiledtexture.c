@@ -0,0 +1,343 @@
+#include "internal.h"
+
+/*
+    Tiled textures, for images larger than the maximum texture size of the renderer
+
+    The decoded image stays in CPU memory, preferably as a mapping of its texture cache file which the
+    system can page out, and is uploaded in square tiles. Only tiles overlapping the visible part of a
+    drawn texture get a GPU texture, plus a few around it prefetched per draw so scrolling rarely waits
+    on uploads. The least recently drawn tiles are released once the resident tile budget is exceeded.
+
+    Zoomed out draws use coarser levels, level l has one pixel per 2^l source pixels, so the number of
+    visible tiles stays bounded at any zoom. Their tiles are sampled from the source when uploaded,
+    averaging 2x2 source pixels, which reads a fraction of the image instead of building a full pyramid.
+    Every tile texture includes a one pixel border copied from its neighbours, so linear filtering
+    blends across tile edges instead of clamping and the tiles join without seams.
+*/
+
+#define TILED_DEFAULT_TILE_SIZE 512
+#define TILED_MIN_RESIDENT_TILES 16
+#define TILED_PREFETCH_PER_DRAW 2
+#define TILED_MAX_LEVELS 16
+
+typedef struct {
+    SDL_Texture* texture;
+    Uint32 last_used;
+    int prev, next;         // resident tile list, most recently drawn first
+} image_tile;
+
+typedef struct {
+    int width, height;      // in level pixels
+    int tiles_x, tiles_y;
+    int first;              // index of the level's first tile
+} tile_level;
+
+struct tiled_texture {
+    int width, height;
+    int tile_size;
+    tile_level levels[TILED_MAX_LEVELS];
+    int level_count;
+    image_tile* tiles;
+    int lru_head, lru_tail;
+    int resident;
+    int max_resident;
+    Uint32 tint;
+    Uint8* staging;         // pixels of a coarse level tile while it is uploaded
+};
+
+static int max_texture_size(void* data){
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(g_RENDERER, &info) != 0) return -1;
+    *(int*) data = SDL_min(info.max_texture_width, info.max_texture_height);
+    return 0;
+}
+
+static int default_budget(const tiled_texture* tt){
+    // enough tiles to cover the window twice over with a margin for scrolling
+    int budget = 2 * (g_drawstate.draw_w / tt->tile_size + 2) * (g_drawstate.draw_h / tt->tile_size + 2);
+    return SDL_max(budget, TILED_MIN_RESIDENT_TILES);
+}
+
+tiled_texture* tiled_create(int width, int height, int tile_size){
+    if (width <= 0 || height <= 0) return NULL;
+    if (tile_size <= 0) tile_size = TILED_DEFAULT_TILE_SIZE;
+    // tiles and their border have to fit the renderer, 0 means no limit
+    int max_size = 0;
+    if (rt_call(max_texture_size, &max_size) == 0 && max_size > 2 && tile_size + 2 > max_size) tile_size = max_size - 2;
+
+    tiled_texture* tt = calloc(1, sizeof(tiled_texture));
+    if (tt == NULL) return NULL;
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    tt->width = width, tt->height = height;
+    tt->tile_size = tile_size;
+    // levels halve the size until one tile covers the image
+    int tile_count = 0;
+    do {
+        tile_level* l = &tt->levels[tt->level_count];
+        l->width = ((width - 1) >> tt->level_count) + 1;
+        l->height = ((height - 1) >> tt->level_count) + 1;
+        l->tiles_x = (l->width + tile_size - 1) / tile_size;
+        l->tiles_y = (l->height + tile_size - 1) / tile_size;
+        l->first = tile_count;
+        tile_count += l->tiles_x * l->tiles_y;
+        tt->level_count++;
+    } while (tt->level_count < TILED_MAX_LEVELS && (tt->levels[tt->level_count - 1].tiles_x > 1 || tt->levels[tt->level_count - 1].tiles_y > 1));
+
+    tt->tiles = calloc(tile_count, sizeof(image_tile));
+    if (tt->tiles == NULL){
+        free(tt);
+        return NULL;
+    }
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    tt->lru_head = tt->lru_tail = -1;
+    tt->tint = 0xFFFFFFFF;
+    tt->max_resident = default_budget(tt);
+    return tt;
+}
+
+// renderer work runs through rt_call, on the render thread in threaded mode
+static int destroy_tile_textures(void* data){
+    tiled_texture* tt = data;
+    for (int i = tt->lru_head; i >= 0; i = tt->tiles[i].next) SDL_DestroyTexture(tt->tiles[i].texture);
+    return 0;
+}
+
+void tiled_destroy(tiled_texture* tt){
+    rt_call(destroy_tile_textures, tt);
+    free(tt->staging);
+    free(tt->tiles);
+    free(tt);
+}
+
+void S2D_setTiledTextureBudget(Texture* txt, int max_resident){
+    internal_texture_data* idata = (internal_texture_data*) txt->internal_;
+    if (idata == NULL || idata->tiled == NULL) return;
+    idata->tiled->max_resident = max_resident > 0 ? max_resident : default_budget(idata->tiled);
+}
+
+int S2D_getTiledTextureResidentTiles(const Texture* txt){
+    const internal_texture_data* idata = (const internal_texture_data*) txt->internal_;
+    return idata != NULL && idata->tiled != NULL ? idata->tiled->resident : 0;
+}
+
+static void lru_unlink(tiled_texture* tt, int i){
+    image_tile* t = &tt->tiles[i];
+    if (t->prev >= 0) tt->tiles[t->prev].next = t->next;
+    else tt->lru_head = t->next;
+    if (t->next >= 0) tt->tiles[t->next].prev = t->prev;
+    else tt->lru_tail = t->prev;
+}
+
+static void lru_push_front(tiled_texture* tt, int i){
+    image_tile* t = &tt->tiles[i];
+    t->prev = -1;
+    t->next = tt->lru_head;
+    if (tt->lru_head >= 0) tt->tiles[tt->lru_head].prev = i;
+    else tt->lru_tail = i;
+    tt->lru_head = i;
+}
+
+static int destroy_tile_texture(void* texture){
+    SDL_DestroyTexture(texture);
+    return 0;
+}
+
+// releases the least recently drawn tile unless it was drawn in the current frame, returns FALSE if none was released
+static bool evict_oldest(tiled_texture* tt){
+    int i = tt->lru_tail;
+    if (i < 0 || tt->tiles[i].last_used == current_context()->frame) return FALSE;
+    lru_unlink(tt, i);
+    rt_call(destroy_tile_texture, tt->tiles[i].texture);
+    tt->tiles[i].texture = NULL;
+    tt->resident--;
+    return TRUE;
+}
+
+// the level pixel rectangle of a tile including its border, clamped to the level
+static SDL_Rect tile_bounds(const tiled_texture* tt, int level, int tx, int ty){
+    const tile_level* l = &tt->levels[level];
+    int x0 = SDL_max(tx * tt->tile_size - 1, 0), y0 = SDL_max(ty * tt->tile_size - 1, 0);
+    int x1 = SDL_min((tx + 1) * tt->tile_size + 1, l->width), y1 = SDL_min((ty + 1) * tt->tile_size + 1, l->height);
+    return (SDL_Rect){x0, y0, x1 - x0, y1 - y0};
+}
+
+static int tile_level_of(const tiled_texture* tt, int index){
+    int level = tt->level_count - 1;
+    while (tt->levels[level].first > index) level--;
+    return level;
+}
+
+// averages 2x2 source pixels per level pixel, the second sample of each axis half a level pixel further
+static void sample_level(const Texture* txt, int level, const SDL_Rect* b, Uint8* dst){
+    int half = 1 << (level - 1);
+    for (int y = 0; y < b->h; y++){
+        int sy0 = (b->y + y) << level, sy1 = SDL_min(sy0 + half, txt->height - 1);
+        const Uint8* row0 = (const Uint8*) txt->pixels + (size_t) sy0 * txt->pitch;
+        const Uint8* row1 = (const Uint8*) txt->pixels + (size_t) sy1 * txt->pitch;
+        Uint8* out = dst + (size_t) y * b->w * INTERNAL_PIXEL_SIZE;
+        for (int x = 0; x < b->w; x++){
+            int sx0 = (b->x + x) << level, sx1 = SDL_min(sx0 + half, txt->width - 1);
+            const Uint8 *a = row0 + sx0 * INTERNAL_PIXEL_SIZE, *c = row0 + sx1 * INTERNAL_PIXEL_SIZE;
+            const Uint8 *d = row1 + sx0 * INTERNAL_PIXEL_SIZE, *e = row1 + sx1 * INTERNAL_PIXEL_SIZE;
+            for (int ch = 0; ch < INTERNAL_PIXEL_SIZE; ch++) out[ch] = (a[ch] + c[ch] + d[ch] + e[ch] + 2) >> 2;
+            out += INTERNAL_PIXEL_SIZE;
+        }
+    }
+}
+
+typedef struct {
+    tiled_texture* tt;
+    const Texture* txt;
+    int index;
+    SDL_Texture* texture;
+} tile_args;
+
+// level 0 tiles upload straight from the texture pixels, coarse levels are sampled into the staging buffer first
+static int upload_tile(const tile_args* args){
+    tiled_texture* tt = args->tt;
+    int level = tile_level_of(tt, args->index);
+    const tile_level* l = &tt->levels[level];
+    int local = args->index - l->first;
+    SDL_Rect b = tile_bounds(tt, level, local % l->tiles_x, local / l->tiles_x);
+    if (level == 0){
+        const Uint8* pixels = (const Uint8*) args->txt->pixels + (size_t) b.y * args->txt->pitch + (size_t) b.x * INTERNAL_PIXEL_SIZE;
+        return SDL_UpdateTexture(args->texture, NULL, pixels, args->txt->pitch);
+    }
+    if (tt->staging == NULL){
+        tt->staging = malloc((size_t) (tt->tile_size + 2) * (tt->tile_size + 2) * INTERNAL_PIXEL_SIZE);
+        if (tt->staging == NULL) return -1;
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+    }
+    sample_level(args->txt, level, &b, tt->staging);
+    return SDL_UpdateTexture(args->texture, NULL, tt->staging, b.w * INTERNAL_PIXEL_SIZE);
+}
+
+static int create_tile_texture(void* data){
+    tile_args* args = data;
+    tiled_texture* tt = args->tt;
+    int level = tile_level_of(tt, args->index);
+    const tile_level* l = &tt->levels[level];
+    int local = args->index - l->first;
+    SDL_Rect b = tile_bounds(tt, level, local % l->tiles_x, local / l->tiles_x);
+    args->texture = SDL_CreateTexture(g_RENDERER, INTERNAL_PIXEL_FORMAT, SDL_TEXTUREACCESS_STATIC, b.w, b.h);
+    if (args->texture == NULL) return -1;
+    if (upload_tile(args) != 0){
+        SDL_DestroyTexture(args->texture);
+        return -1;
+    }
+    SDL_Color c = color_SDL2(tt->tint);
+    SDL_SetTextureBlendMode(args->texture, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureColorMod(args->texture, c.r, c.g, c.b);
+    SDL_SetTextureAlphaMod(args->texture, c.a);
+    tt->tiles[args->index].texture = args->texture;
+    return 0;
+}
+
+// makes a tile resident and marks it drawn in the current frame
+static int touch_tile(tiled_texture* tt, const Texture* txt, int index){
+    image_tile* t = &tt->tiles[index];
+    if (t->texture == NULL){
+        if (tt->resident >= tt->max_resident) evict_oldest(tt);
+        tile_args args = {tt, txt, index, NULL};
+        if (rt_call(create_tile_texture, &args) != 0) return ERROR_CREATE_TEXTURE;
+        tt->resident++;
+    } else lru_unlink(tt, index);
+    lru_push_front(tt, index);
+    t->last_used = current_context()->frame;
+    return 0;
+}
+
+/*
+    uploads up to TILED_PREFETCH_PER_DRAW missing tiles of the ring around the visible tile range,
+    only into free budget or in place of tiles not drawn in this frame
+*/
+static int prefetch_ring(tiled_texture* tt, const Texture* txt, int level, int tx0, int ty0, int tx1, int ty1){
+    const tile_level* l = &tt->levels[level];
+    int uploaded = 0;
+    for (int ty = SDL_max(ty0 - 1, 0); ty <= SDL_min(ty1 + 1, l->tiles_y - 1); ty++){
+        for (int tx = SDL_max(tx0 - 1, 0); tx <= SDL_min(tx1 + 1, l->tiles_x - 1); tx++){
+            if (tx >= tx0 && tx <= tx1 && ty >= ty0 && ty <= ty1) continue;
+            int index = l->first + ty * l->tiles_x + tx;
+            if (tt->tiles[index].texture != NULL) continue;
+            if (uploaded == TILED_PREFETCH_PER_DRAW || (tt->resident >= tt->max_resident && !evict_oldest(tt))) return 0;
+            int retcode = touch_tile(tt, txt, index);
+            if (retcode != 0) return retcode;
+            uploaded++;
+        }
+    }
+    return 0;
+}
+
+int tiled_draw(tiled_texture* tt, const Texture* txt, const Rectangle* rect){
+    if (rect->w <= 0 || rect->h <= 0) return 0;
+    float sx = (float) rect->w / tt->width, sy = (float) rect->h / tt->height;
+
+    // the finest level with at most one level pixel per output pixel
+    float pixel_scale = SDL_min(sx, sy) * camera_pixel_scale();
+    int level = 0;
+    while (level + 1 < tt->level_count && pixel_scale * (1 << (level + 1)) <= 1.0f) level++;
+    const tile_level* l = &tt->levels[level];
+    float span = (float) (tt->tile_size << level);
+
+    // only tiles intersecting the visible region are drawn
+    float x0, y0, x1, y1;
+    camera_view_bounds(&x0, &y0, &x1, &y1);
+    int tx0 = SDL_max((int) SDL_floorf((x0 - rect->origin.x) / sx / span), 0);
+    int ty0 = SDL_max((int) SDL_floorf((y0 - rect->origin.y) / sy / span), 0);
+    int tx1 = SDL_min((int) SDL_floorf((x1 - rect->origin.x) / sx / span), l->tiles_x - 1);
+    int ty1 = SDL_min((int) SDL_floorf((y1 - rect->origin.y) / sy / span), l->tiles_y - 1);
+    if (tx0 > tx1 || ty0 > ty1){
+        g_frame_stats.culled++;
+        return 0;
+    }
+
+    for (int ty = ty0; ty <= ty1; ty++){
+        // edges come from the same source pixel expression for neighbouring tiles, so they meet exactly
+        int py0 = ty * tt->tile_size, py1 = SDL_min(py0 + tt->tile_size, l->height);
+        float dy0 = rect->origin.y + SDL_min(py0 << level, tt->height) * sy;
+        float dy1 = rect->origin.y + SDL_min(py1 << level, tt->height) * sy;
+        for (int tx = tx0; tx <= tx1; tx++){
+            int index = l->first + ty * l->tiles_x + tx;
+            int retcode = touch_tile(tt, txt, index);
+            if (retcode != 0) return retcode;
+            int px0 = tx * tt->tile_size, px1 = SDL_min(px0 + tt->tile_size, l->width);
+            float dx0 = rect->origin.x + SDL_min(px0 << level, tt->width) * sx;
+            float dx1 = rect->origin.x + SDL_min(px1 << level, tt->width) * sx;
+            SDL_Rect b = tile_bounds(tt, level, tx, ty);
+            SDL_Rect src = {px0 - b.x, py0 - b.y, px1 - px0, py1 - py0};
+            SDL_FRect dst = {dx0, dy0, dx1 - dx0, dy1 - dy0};
+            if (render_copy(tt->tiles[index].texture, &src, &dst) != 0) return ERROR_DRAW_TEXTURE;
+        }
+    }
+    return prefetch_ring(tt, txt, level, tx0, ty0, tx1, ty1);
+}
+
+static int update_tile_textures(void* data){
+    tile_args* args = data;
+    for (int i = args->tt->lru_head; i >= 0; i = args->tt->tiles[i].next){
+        args->index = i;
+        args->texture = args->tt->tiles[i].texture;
+        if (upload_tile(args) != 0) return -1;
+    }
+    return 0;
+}
+
+int tiled_update(tiled_texture* tt, const Texture* txt){
+    tile_args args = {tt, txt, 0, NULL};
+    return rt_call(update_tile_textures, &args);
+}
+
+static int tint_tile_textures(void* data){
+    tiled_texture* tt = data;
+    SDL_Color c = color_SDL2(tt->tint);
+    for (int i = tt->lru_head; i >= 0; i = tt->tiles[i].next){
+        SDL_SetTextureColorMod(tt->tiles[i].texture, c.r, c.g, c.b);
+        SDL_SetTextureAlphaMod(tt->tiles[i].texture, c.a);
+    }
+    return 0;
+}
+
+int tiled_set_tint(tiled_texture* tt, Uint32 rgba){
+    tt->tint = rgba;
+    return rt_call(tint_tile_textures, tt);
+}
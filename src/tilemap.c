@@ -0,0 +1,251 @@
+#include "internal.h"
+
+/*
+    Chunked tilemap renderer
+
+    The map is split into square chunks of tiles. A chunk is drawn into its own target texture the
+    first time it becomes visible and again only after one of its tiles changed, so a frame costs one
+    texture copy per visible chunk. Chunk textures are created lazily and the least recently drawn
+    ones are released when the resident chunk budget is exceeded, which keeps the memory of large
+    maps proportional to the visible area.
+
+    Every chunk texture has a one pixel gutter holding the edge pixels of the neighbouring tiles, so
+    linear filtering under zoom blends across chunk edges instead of clamping and chunks join without
+    seams. Changing a tile on a chunk edge therefore also redraws the neighbouring chunks.
+*/
+
+#define TILEMAP_DEFAULT_CHUNK_TILES 32
+#define TILEMAP_MIN_RESIDENT_CHUNKS 64
+#define TILEMAP_GUTTER 1
+
+typedef struct {
+    SDL_Texture* texture;
+    bool dirty;
+    int tile_count;
+    Uint32 last_used;
+    int prev, next;         // resident chunk list, most recently drawn first
+} tile_chunk;
+
+struct S2D_Tilemap {
+    int width, height;
+    int tile_w, tile_h;
+    int chunk_tiles;
+    int chunks_x, chunks_y;
+    Uint16* tiles;
+    tile_chunk* chunks;
+    Texture* atlas;
+    int atlas_columns;
+    int lru_head, lru_tail;
+    int resident;
+    int max_resident;
+    Uint32 frame;
+};
+
+S2D_Tilemap* S2D_createTilemap(int width, int height, int tile_w, int tile_h, Texture* atlas, int chunk_tiles){
+    if (width <= 0 || height <= 0 || tile_w <= 0 || tile_h <= 0 || atlas == NULL || atlas->internal_ == NULL) return NULL;
+    if (((internal_texture_data*) atlas->internal_)->tiled != NULL) return NULL;
+    if (chunk_tiles <= 0) chunk_tiles = TILEMAP_DEFAULT_CHUNK_TILES;
+
+    S2D_Tilemap* map = calloc(1, sizeof(S2D_Tilemap));
+    if (map == NULL) return NULL;
+    map->width = width, map->height = height;
+    map->tile_w = tile_w, map->tile_h = tile_h;
+    map->chunk_tiles = chunk_tiles;
+    map->chunks_x = (width + chunk_tiles - 1) / chunk_tiles;
+    map->chunks_y = (height + chunk_tiles - 1) / chunk_tiles;
+    map->atlas = atlas;
+    map->atlas_columns = atlas->width / tile_w > 0 ? atlas->width / tile_w : 1;
+    map->tiles = calloc((size_t) width * height, sizeof(Uint16));
+    map->chunks = calloc((size_t) map->chunks_x * map->chunks_y, sizeof(tile_chunk));
+    if (map->tiles == NULL || map->chunks == NULL){
+        S2D_destroyTilemap(map);
+        return NULL;
+    }
+    map->lru_head = map->lru_tail = -1;
+    S2D_setTilemapChunkBudget(map, 0);
+    return map;
+}
+
+// renderer work runs through rt_call, on the render thread in threaded mode
+static int destroy_chunk_textures(void* data){
+    S2D_Tilemap* map = data;
+    for (int i = map->lru_head; i >= 0; i = map->chunks[i].next) SDL_DestroyTexture(map->chunks[i].texture);
+    return 0;
+}
+
+void S2D_destroyTilemap(S2D_Tilemap* map){
+    if (map == NULL) return;
+    if (map->chunks != NULL) rt_call(destroy_chunk_textures, map);
+    free(map->chunks);
+    free(map->tiles);
+    free(map);
+}
+
+void S2D_setTilemapChunkBudget(S2D_Tilemap* map, int max_resident){
+    if (max_resident <= 0){
+        // enough chunks to cover the window twice over with a margin for scrolling
+        int cw = map->chunk_tiles * map->tile_w, ch = map->chunk_tiles * map->tile_h;
+        max_resident = 2 * (g_drawstate.draw_w / cw + 2) * (g_drawstate.draw_h / ch + 2);
+        if (max_resident < TILEMAP_MIN_RESIDENT_CHUNKS) max_resident = TILEMAP_MIN_RESIDENT_CHUNKS;
+    }
+    map->max_resident = max_resident;
+}
+
+void S2D_setTile(S2D_Tilemap* map, int x, int y, Uint16 tile){
+    if (x < 0 || y < 0 || x >= map->width || y >= map->height) return;
+    Uint16* t = &map->tiles[(size_t) y * map->width + x];
+    if (*t == tile) return;
+    int chunk_x = x / map->chunk_tiles, chunk_y = y / map->chunk_tiles;
+    tile_chunk* c = &map->chunks[chunk_y * map->chunks_x + chunk_x];
+    if (*t == 0) c->tile_count++;
+    if (tile == 0) c->tile_count--;
+    *t = tile;
+    // tiles on a chunk edge are also in the gutter of the neighbouring chunks
+    int lx = x - chunk_x * map->chunk_tiles, ly = y - chunk_y * map->chunk_tiles;
+    int dx0 = lx == 0 ? -1 : 0, dx1 = lx == map->chunk_tiles - 1 ? 1 : 0;
+    int dy0 = ly == 0 ? -1 : 0, dy1 = ly == map->chunk_tiles - 1 ? 1 : 0;
+    for (int cy = SDL_max(chunk_y + dy0, 0); cy <= SDL_min(chunk_y + dy1, map->chunks_y - 1); cy++){
+        for (int cx = SDL_max(chunk_x + dx0, 0); cx <= SDL_min(chunk_x + dx1, map->chunks_x - 1); cx++){
+            map->chunks[cy * map->chunks_x + cx].dirty = TRUE;
+        }
+    }
+}
+
+Uint16 S2D_getTile(const S2D_Tilemap* map, int x, int y){
+    if (x < 0 || y < 0 || x >= map->width || y >= map->height) return 0;
+    return map->tiles[(size_t) y * map->width + x];
+}
+
+static int destroy_chunk_texture(void* texture){
+    SDL_DestroyTexture(texture);
+    return 0;
+}
+
+static void lru_unlink(S2D_Tilemap* map, int i){
+    tile_chunk* c = &map->chunks[i];
+    if (c->prev >= 0) map->chunks[c->prev].next = c->next;
+    else map->lru_head = c->next;
+    if (c->next >= 0) map->chunks[c->next].prev = c->prev;
+    else map->lru_tail = c->prev;
+}
+
+static void lru_push_front(S2D_Tilemap* map, int i){
+    tile_chunk* c = &map->chunks[i];
+    c->prev = -1;
+    c->next = map->lru_head;
+    if (map->lru_head >= 0) map->chunks[map->lru_head].prev = i;
+    else map->lru_tail = i;
+    map->lru_head = i;
+}
+
+// releases the least recently drawn chunk unless it was drawn in the current frame
+static void evict_oldest(S2D_Tilemap* map){
+    int i = map->lru_tail;
+    if (i < 0 || map->chunks[i].last_used == map->frame) return;
+    lru_unlink(map, i);
+    rt_call(destroy_chunk_texture, map->chunks[i].texture);
+    map->chunks[i].texture = NULL;
+    map->resident--;
+}
+
+typedef struct {
+    S2D_Tilemap* map;
+    tile_chunk* chunk;
+} chunk_args;
+
+static int create_chunk_texture(void* data){
+    chunk_args* args = data;
+    int cw = args->map->chunk_tiles * args->map->tile_w + 2*TILEMAP_GUTTER;
+    int ch = args->map->chunk_tiles * args->map->tile_h + 2*TILEMAP_GUTTER;
+    args->chunk->texture = SDL_CreateTexture(g_RENDERER, INTERNAL_PIXEL_FORMAT, SDL_TEXTUREACCESS_TARGET, cw, ch);
+    if (args->chunk->texture == NULL) return -1;
+    SDL_SetTextureBlendMode(args->chunk->texture, SDL_BLENDMODE_BLEND);
+    return 0;
+}
+
+// draws the batched tiles into the chunk texture, restoring the render target and draw color
+static int draw_chunk_texture(void* data){
+    chunk_args* args = data;
+    int retcode = 0;
+    SDL_Texture* atlas = ((internal_texture_data*) args->map->atlas->internal_)->texture;
+    SDL_Texture* prev_target = SDL_GetRenderTarget(g_RENDERER);
+    if (SDL_SetRenderTarget(g_RENDERER, args->chunk->texture) != 0){
+        batch_reset(&g_batch);
+        return ERROR_DRAW_TEXTURE;
+    }
+    SDL_SetRenderDrawColor(g_RENDERER, 0, 0, 0, 0);
+    SDL_RenderClear(g_RENDERER);
+    if (batch_submit_raw(&g_batch, atlas) != 0) retcode = ERROR_DRAW_TEXTURE;
+    render_target_restore(prev_target);
+    Uint32 rgba = g_drawstate.draw_color;
+    SDL_SetRenderDrawColor(g_RENDERER, rgba&0xFF, (rgba>>8)&0xFF, (rgba>>16)&0xFF, rgba>>24);
+    return retcode;
+}
+
+static int render_chunk(S2D_Tilemap* map, int chunk_x, int chunk_y){
+    int index = chunk_y * map->chunks_x + chunk_x;
+    tile_chunk* c = &map->chunks[index];
+    chunk_args args = {map, c};
+    if (c->texture == NULL){
+        if (map->resident >= map->max_resident) evict_oldest(map);
+        if (rt_call(create_chunk_texture, &args) != 0) return ERROR_CREATE_TEXTURE;
+        lru_push_front(map, index);
+        map->resident++;
+    }
+
+    float inv_w = 1.0f / map->atlas->width, inv_h = 1.0f / map->atlas->height;
+    SDL_Color white = {255, 255, 255, 255};
+    int tx0 = chunk_x * map->chunk_tiles, ty0 = chunk_y * map->chunk_tiles;
+    // the ring of neighbouring tiles fills the gutter, the target clips the rest of them
+    int gx0 = SDL_max(tx0 - 1, 0), gy0 = SDL_max(ty0 - 1, 0);
+    int gx1 = SDL_min(tx0 + map->chunk_tiles + 1, map->width), gy1 = SDL_min(ty0 + map->chunk_tiles + 1, map->height);
+    for (int ty = gy0; ty < gy1; ty++){
+        for (int tx = gx0; tx < gx1; tx++){
+            Uint16 tile = map->tiles[(size_t) ty * map->width + tx];
+            if (tile == 0) continue;
+            int ax = ((tile - 1) % map->atlas_columns) * map->tile_w;
+            int ay = ((tile - 1) / map->atlas_columns) * map->tile_h;
+            SDL_FRect dst = {(tx - tx0) * map->tile_w + TILEMAP_GUTTER, (ty - ty0) * map->tile_h + TILEMAP_GUTTER, map->tile_w, map->tile_h};
+            if (batch_quad(&g_batch, &dst, white, ax * inv_w, ay * inv_h, (ax + map->tile_w) * inv_w, (ay + map->tile_h) * inv_h) != 0){
+                batch_reset(&g_batch);
+                return ERROR_DRAW_TEXTURE;
+            }
+        }
+    }
+
+    int retcode = rt_call(draw_chunk_texture, &args);
+    c->dirty = FALSE;
+    return retcode;
+}
+
+int S2D_drawTilemap(S2D_Tilemap* map, Vector view_origin){
+    int retcode = 0;
+    int cw = map->chunk_tiles * map->tile_w, ch = map->chunk_tiles * map->tile_h;
+    SDL_Rect src = {TILEMAP_GUTTER, TILEMAP_GUTTER, cw, ch};
+    map->frame++;
+
+    // only chunks intersecting the visible region are touched
+    float x0, y0, x1, y1;
+    camera_view_bounds(&x0, &y0, &x1, &y1);
+    int cx0 = SDL_max((int) SDL_floorf((x0 + view_origin.x) / cw), 0);
+    int cy0 = SDL_max((int) SDL_floorf((y0 + view_origin.y) / ch), 0);
+    int cx1 = SDL_min((int) SDL_floorf((x1 + view_origin.x) / cw), map->chunks_x - 1);
+    int cy1 = SDL_min((int) SDL_floorf((y1 + view_origin.y) / ch), map->chunks_y - 1);
+
+    for (int cy = cy0; cy <= cy1; cy++){
+        for (int cx = cx0; cx <= cx1; cx++){
+            int index = cy * map->chunks_x + cx;
+            tile_chunk* c = &map->chunks[index];
+            if (c->tile_count == 0) continue;
+            if ((c->texture == NULL || c->dirty) && (retcode = render_chunk(map, cx, cy)) != 0) return retcode;
+            c->last_used = map->frame;
+            if (map->lru_head != index){
+                lru_unlink(map, index);
+                lru_push_front(map, index);
+            }
+            SDL_FRect dst = {cx * cw - view_origin.x, cy * ch - view_origin.y, cw, ch};
+            if (render_copy(c->texture, &src, &dst) != 0) return ERROR_DRAW_TEXTURE;
+        }
+    }
+    return 0;
+}
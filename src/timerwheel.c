@@ -0,0 +1,266 @@
+#include "internal.h"
+
+/*
+    Hierarchical timer wheel
+
+    Timers live in doubly linked lists threaded through a node pool, hanging off the slots of four
+    wheels with a resolution of 1 ms: 256 slots of 1 ms, then three wheels of 64 slots each covering
+    64 times the range of the one below, about 18.6 hours in total. Longer delays park in the last slot
+    of the outermost wheel until they come into range. Inserting and cancelling is a list operation.
+    Whenever the innermost wheel wraps, the next slot of the wheel above is cascaded down, so every
+    timer is moved at most three times before it fires.
+
+    Timer ids carry a generation next to the pool index, so cancelling a timer that already fired or
+    was cancelled is detected instead of hitting the timer that reused its node.
+*/
+
+#define WHEEL0_BITS 8
+#define WHEEL_BITS 6
+#define WHEEL0_SLOTS (1 << WHEEL0_BITS)
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_COUNT 4
+#define SLOT_COUNT (WHEEL0_SLOTS + (WHEEL_COUNT - 1) * WHEEL_SLOTS)
+#define MAX_DELTA (((Uint64) 1 << (WHEEL0_BITS + (WHEEL_COUNT - 1) * WHEEL_BITS)) - 1)
+// timers due in the tick being processed, detached so callbacks can add timers to the current slot
+#define EXPIRED_LIST SLOT_COUNT
+
+#define INDEX_BITS 22
+#define INDEX_MASK ((1 << INDEX_BITS) - 1)
+#define GENERATION_MASK ((1 << (31 - INDEX_BITS)) - 1)
+#define NIL (-1)
+
+typedef struct {
+    Uint64 deadline;                // in ticks
+    Uint32 repeat_ms;
+    void (*callback)(S2D_timerID, void*);
+    void* data;
+    int next, prev;
+    int list;                       // slot the node is linked into, NIL when free or running
+    Uint16 generation;
+    bool active;
+} timer_node;
+
+typedef struct {
+    int head, tail;
+} timer_list;
+
+struct S2D_TimerWheel {
+    timer_node* nodes;
+    int capacity;
+    int free_head;
+    int count;
+    Uint64 tick;                    // next tick to process
+    Uint64 remainder_ns;
+    timer_list lists[SLOT_COUNT + 1];
+};
+
+static S2D_timerID make_id(const S2D_TimerWheel* w, int index){
+    return (S2D_timerID)(((Uint32)(w->nodes[index].generation & GENERATION_MASK) << INDEX_BITS) | (Uint32) index);
+}
+
+static int node_of(const S2D_TimerWheel* w, S2D_timerID id){
+    if (id < 0) return NIL;
+    int index = id & INDEX_MASK;
+    if (index >= w->capacity) return NIL;
+    const timer_node* n = &w->nodes[index];
+    if (!n->active || (n->generation & GENERATION_MASK) != ((Uint32) id >> INDEX_BITS)) return NIL;
+    return index;
+}
+
+static void list_append(S2D_TimerWheel* w, int list, int index){
+    timer_list* l = &w->lists[list];
+    timer_node* n = &w->nodes[index];
+    n->list = list;
+    n->next = NIL;
+    n->prev = l->tail;
+    if (l->tail != NIL) w->nodes[l->tail].next = index;
+    else l->head = index;
+    l->tail = index;
+}
+
+static void list_unlink(S2D_TimerWheel* w, int index){
+    timer_node* n = &w->nodes[index];
+    timer_list* l = &w->lists[n->list];
+    if (n->prev != NIL) w->nodes[n->prev].next = n->next;
+    else l->head = n->next;
+    if (n->next != NIL) w->nodes[n->next].prev = n->prev;
+    else l->tail = n->prev;
+    n->list = NIL;
+}
+
+// links the node into the slot its deadline falls in, relative to the next tick to process
+static void place(S2D_TimerWheel* w, int index){
+    Uint64 deadline = w->nodes[index].deadline;
+    if (deadline < w->tick) deadline = w->tick;
+    if (deadline - w->tick > MAX_DELTA) deadline = w->tick + MAX_DELTA;
+    Uint64 delta = deadline - w->tick;
+    int slot;
+    if (delta < WHEEL0_SLOTS){
+        slot = deadline & (WHEEL0_SLOTS - 1);
+    } else {
+        int wheel = 1;
+        while (delta >= (Uint64) 1 << (WHEEL0_BITS + wheel * WHEEL_BITS)) wheel++;
+        int shift = WHEEL0_BITS + (wheel - 1) * WHEEL_BITS;
+        slot = WHEEL0_SLOTS + (wheel - 1) * WHEEL_SLOTS + (int)((deadline >> shift) & (WHEEL_SLOTS - 1));
+    }
+    list_append(w, slot, index);
+}
+
+// moves the timers of the current slot of a wheel above the innermost one down a level
+static int cascade(S2D_TimerWheel* w, int wheel){
+    int shift = WHEEL0_BITS + (wheel - 1) * WHEEL_BITS;
+    int index = (int)((w->tick >> shift) & (WHEEL_SLOTS - 1));
+    timer_list* l = &w->lists[WHEEL0_SLOTS + (wheel - 1) * WHEEL_SLOTS + index];
+    int i = l->head;
+    l->head = l->tail = NIL;
+    while (i != NIL){
+        int next = w->nodes[i].next;
+        place(w, i);
+        i = next;
+    }
+    return index;
+}
+
+static void node_free(S2D_TimerWheel* w, int index){
+    timer_node* n = &w->nodes[index];
+    n->active = FALSE;
+    n->generation++;
+    n->list = NIL;
+    n->next = w->free_head;
+    w->free_head = index;
+    w->count--;
+}
+
+S2D_TimerWheel* S2D_createTimerWheel(int expected_timers){
+    S2D_TimerWheel* w = calloc(1, sizeof(S2D_TimerWheel));
+    if (w == NULL) return NULL;
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    for (int i = 0; i <= SLOT_COUNT; i++) w->lists[i].head = w->lists[i].tail = NIL;
+    w->free_head = NIL;
+    if (expected_timers < 64) expected_timers = 64;
+    w->nodes = malloc(expected_timers * sizeof(timer_node));
+    if (w->nodes == NULL){
+        free(w);
+        return NULL;
+    }
+    SDL_AtomicAdd(&g_heap_allocs, 1);
+    w->capacity = expected_timers;
+    for (int i = w->capacity - 1; i >= 0; i--){
+        w->nodes[i] = (timer_node){.list = NIL, .next = w->free_head};
+        w->free_head = i;
+    }
+    return w;
+}
+
+void S2D_destroyTimerWheel(S2D_TimerWheel* w){
+    if (w == NULL) return;
+    free(w->nodes);
+    free(w);
+}
+
+static int node_alloc(S2D_TimerWheel* w){
+    if (w->free_head == NIL){
+        if (w->capacity > INDEX_MASK / 2) return NIL;
+        int capacity = w->capacity * 2;
+        timer_node* nodes = realloc(w->nodes, capacity * sizeof(timer_node));
+        if (nodes == NULL) return NIL;
+        SDL_AtomicAdd(&g_heap_allocs, 1);
+        w->nodes = nodes;
+        for (int i = capacity - 1; i >= w->capacity; i--){
+            w->nodes[i] = (timer_node){.list = NIL, .next = w->free_head};
+            w->free_head = i;
+        }
+        w->capacity = capacity;
+    }
+    int index = w->free_head;
+    w->free_head = w->nodes[index].next;
+    w->count++;
+    return index;
+}
+
+S2D_timerID S2D_wheelAddTimer(S2D_TimerWheel* w, Uint32 delay_ms, Uint32 repeat_ms, void (*callback)(S2D_timerID, void*), void* data){
+    if (callback == NULL) return -1;
+    int index = node_alloc(w);
+    if (index == NIL) return -1;
+    timer_node* n = &w->nodes[index];
+    // tick n is processed once n + 1 ms have passed, a delay of d ms is due at tick d - 1
+    n->deadline = w->tick + SDL_max(delay_ms, 1) - 1;
+    n->repeat_ms = repeat_ms;
+    n->callback = callback;
+    n->data = data;
+    n->active = TRUE;
+    place(w, index);
+    return make_id(w, index);
+}
+
+bool S2D_wheelCancelTimer(S2D_TimerWheel* w, S2D_timerID id){
+    int index = node_of(w, id);
+    if (index == NIL) return FALSE;
+    // a running timer is not linked anywhere, freeing it stops it from repeating
+    if (w->nodes[index].list != NIL) list_unlink(w, index);
+    node_free(w, index);
+    return TRUE;
+}
+
+int S2D_wheelTimerCount(const S2D_TimerWheel* w){
+    return w->count;
+}
+
+int S2D_wheelTimeUntilNext(const S2D_TimerWheel* w){
+    if (w->count == 0) return -1;
+    int base = (int)(w->tick & (WHEEL0_SLOTS - 1));
+    // timers of the innermost wheel are due at the tick of their slot, the outer wheels
+    // are not searched, the next cascade is a lower bound for their timers
+    int ticks = WHEEL0_SLOTS - base;
+    for (int k = 0; k < WHEEL0_SLOTS; k++){
+        if (w->lists[(base + k) & (WHEEL0_SLOTS - 1)].head != NIL){
+            ticks = k;
+            break;
+        }
+    }
+    // tick number w->tick is processed once a full millisecond has accumulated
+    Uint64 ns = (Uint64)(ticks + 1) * 1000000 - w->remainder_ns;
+    return (int)((ns + 999999) / 1000000);
+}
+
+int S2D_advanceTimerWheel(S2D_TimerWheel* w, Uint64 elapsed_ns){
+    w->remainder_ns += elapsed_ns;
+    Uint64 ticks = w->remainder_ns / 1000000;
+    w->remainder_ns %= 1000000;
+    int fired = 0;
+    for (; ticks > 0; ticks--){
+        if (w->count == 0){
+            // nothing to cascade or fire, the wheels can jump ahead
+            w->tick += ticks;
+            break;
+        }
+        int slot = (int)(w->tick & (WHEEL0_SLOTS - 1));
+        for (int wheel = 1; slot == 0 && wheel < WHEEL_COUNT && cascade(w, wheel) == 0; wheel++);
+
+        timer_list* due = &w->lists[slot];
+        timer_list* expired = &w->lists[EXPIRED_LIST];
+        *expired = *due;
+        due->head = due->tail = NIL;
+        for (int i = expired->head; i != NIL; i = w->nodes[i].next) w->nodes[i].list = EXPIRED_LIST;
+        Uint64 now = w->tick++;
+
+        while (expired->head != NIL){
+            int index = expired->head;
+            list_unlink(w, index);
+            S2D_timerID id = make_id(w, index);
+            Uint16 generation = w->nodes[index].generation;
+            w->nodes[index].callback(id, w->nodes[index].data);
+            fired++;
+            // the callback may have grown the pool or cancelled this timer
+            timer_node* n = &w->nodes[index];
+            if (!n->active || n->generation != generation) continue;
+            if (n->repeat_ms == 0){
+                node_free(w, index);
+            } else {
+                n->deadline = now + n->repeat_ms;
+                place(w, index);
+            }
+        }
+    }
+    return fired;
+}
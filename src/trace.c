@@ -0,0 +1,181 @@
+#include "internal.h"
+#include <stdio.h>
+
+/*
+    Trace span recorder producing Chrome Trace Event JSON (chrome://tracing, ui.perfetto.dev)
+
+    Every thread that records a span gets its own ring buffer, which is linked into a global
+    list the first time the thread records. The recording thread is the only writer of head and
+    the flushing thread the only writer of tail, so recording never takes a lock.
+    When a buffer is full new events are dropped and counted rather than overwriting unread ones.
+    Head and tail count events unbounded and wrap around as Uint32, the capacity is a power of two
+    so the ring index stays valid across the wrap.
+*/
+
+#define TRACE_DEFAULT_CAPACITY (1<<16)
+#define TRACE_MAX_CAPACITY (1<<30)
+
+typedef struct {
+    const char* name;
+    Uint64 counter;
+    char phase;
+} trace_event;
+
+typedef struct trace_buffer {
+    struct trace_buffer* next;
+    SDL_threadID tid;
+    Uint32 capacity;        // a power of two
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    SDL_atomic_t dropped;
+    trace_event* events;
+} trace_buffer;
+
+SDL_atomic_t g_trace_enabled;
+
+static _Thread_local trace_buffer* t_buffer;
+static trace_buffer* g_buffers;
+static SDL_SpinLock g_flush_lock;
+static FILE* g_trace_file;
+static bool g_first_event;
+static bool g_atexit_registered = FALSE;
+static Uint32 g_capacity = TRACE_DEFAULT_CAPACITY;
+static Uint64 g_counter_start;
+static double g_us_per_count;
+
+static trace_buffer* trace_thread_buffer(){
+    trace_buffer* buf = t_buffer;
+    if (buf != NULL) return buf;
+
+    buf = malloc(sizeof(trace_buffer));
+    if (buf == NULL) return NULL;
+    buf->events = malloc(sizeof(trace_event) * g_capacity);
+    if (buf->events == NULL){
+        free(buf);
+        return NULL;
+    }
+    buf->tid = SDL_ThreadID();
+    buf->capacity = g_capacity;
+    SDL_AtomicSet(&buf->head, 0);
+    SDL_AtomicSet(&buf->tail, 0);
+    SDL_AtomicSet(&buf->dropped, 0);
+
+    // lock free push onto the global buffer list, buffers live until process exit
+    do {
+        buf->next = SDL_AtomicGetPtr((void**) &g_buffers);
+    } while (!SDL_AtomicCASPtr((void**) &g_buffers, buf->next, buf));
+
+    t_buffer = buf;
+    return buf;
+}
+
+void trace_push(const char* name, char phase){
+    trace_buffer* buf = trace_thread_buffer();
+    if (buf == NULL) return;
+
+    Uint32 head = (Uint32) SDL_AtomicGet(&buf->head);
+    Uint32 tail = (Uint32) SDL_AtomicGet(&buf->tail);
+    if (head - tail >= buf->capacity){
+        SDL_AtomicAdd(&buf->dropped, 1);
+        return;
+    }
+    trace_event* ev = &buf->events[head & (buf->capacity - 1)];
+    ev->name = name;
+    ev->phase = phase;
+    ev->counter = SDL_GetPerformanceCounter();
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&buf->head, (int)(head + 1));
+}
+
+// writes a span name as a JSON string body, escaping quotes, backslashes and control characters
+static void trace_write_name(const char* name){
+    for (const unsigned char* c = (const unsigned char*) name; *c != '\0'; c++){
+        if (*c == '"' || *c == '\\') fprintf(g_trace_file, "\\%c", *c);
+        else if (*c < 0x20) fprintf(g_trace_file, "\\u%04x", *c);
+        else fputc(*c, g_trace_file);
+    }
+}
+
+static void trace_write_buffer(trace_buffer* buf){
+    Uint32 head = (Uint32) SDL_AtomicGet(&buf->head);
+    Uint32 tail = (Uint32) SDL_AtomicGet(&buf->tail);
+    SDL_MemoryBarrierAcquire();
+
+    for (; tail != head; tail++){
+        trace_event* ev = &buf->events[tail & (buf->capacity - 1)];
+        double ts = (double)(ev->counter - g_counter_start) * g_us_per_count;
+        fprintf(g_trace_file, "%s\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f", 
+            g_first_event ? "" : ",", ev->phase, (unsigned long) buf->tid, ts);
+        if (ev->name != NULL){
+            fputs(",\"name\":\"", g_trace_file);
+            trace_write_name(ev->name);
+            fputs("\",\"cat\":\"s2d\"", g_trace_file);
+        }
+        fputc('}', g_trace_file);
+        g_first_event = FALSE;
+    }
+    SDL_AtomicSet(&buf->tail, (int) tail);
+}
+
+int S2D_traceFlush(){
+    SDL_AtomicLock(&g_flush_lock);
+    if (g_trace_file == NULL){
+        SDL_AtomicUnlock(&g_flush_lock);
+        return ERROR_TRACE;
+    }
+    trace_buffer* buf = SDL_AtomicGetPtr((void**) &g_buffers);
+    for (; buf != NULL; buf = buf->next){
+        trace_write_buffer(buf);
+    }
+    int retcode = fflush(g_trace_file) != 0 ? ERROR_TRACE : 0;
+    SDL_AtomicUnlock(&g_flush_lock);
+    return retcode;
+}
+
+void S2D_traceStop(){
+    if (g_trace_file == NULL) return;
+    SDL_AtomicSet(&g_trace_enabled, 0);
+    S2D_traceFlush();
+
+    SDL_AtomicLock(&g_flush_lock);
+    trace_buffer* buf = SDL_AtomicGetPtr((void**) &g_buffers);
+    for (; buf != NULL; buf = buf->next){
+        int dropped = SDL_AtomicSet(&buf->dropped, 0);
+        if (dropped > 0) fprintf(stderr, "S2D trace: thread %lu dropped %d events, buffer full\n", (unsigned long) buf->tid, dropped);
+    }
+    fputs("\n]\n", g_trace_file);
+    fclose(g_trace_file);
+    g_trace_file = NULL;
+    SDL_AtomicUnlock(&g_flush_lock);
+}
+
+int S2D_traceStart(const char* path, int events_per_thread){
+    if (g_trace_file != NULL) return ERROR_TRACE;
+    g_trace_file = fopen(path, "w");
+    if (g_trace_file == NULL) return ERROR_TRACE;
+
+    // capacity only applies to threads that have not recorded yet, rounded up to a power of two
+    if (events_per_thread > 0){
+        g_capacity = 1;
+        while (g_capacity < (Uint32) SDL_min(events_per_thread, TRACE_MAX_CAPACITY)) g_capacity <<= 1;
+    }
+    g_counter_start = SDL_GetPerformanceCounter();
+    g_us_per_count = 1e6 / (double) SDL_GetPerformanceFrequency();
+    g_first_event = TRUE;
+    fputc('[', g_trace_file);
+
+    if (!g_atexit_registered){
+        atexit(S2D_traceStop);
+        g_atexit_registered = TRUE;
+    }
+    SDL_AtomicSet(&g_trace_enabled, 1);
+    return 0;
+}
+
+void S2D_traceBegin(const char* name){
+    TRACE_BEGIN(name);
+}
+
+void S2D_traceEnd(){
+    TRACE_END();
+}
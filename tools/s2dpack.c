@@ -0,0 +1,169 @@
+/*
+    Builds an asset pack for S2D_mountPack, the format is described in src/assetpack.c
+    The paths are stored as given on the command line, load assets with the same relative paths.
+
+    compile: gcc s2dpack.c -o s2dpack
+    usage: ./s2dpack assets.pak image.png font.ttf ...
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACK_VERSION 1
+#define PACK_HEADER_SIZE 32
+#define PACK_SLOT_SIZE 32
+#define DATA_ALIGN 16
+
+typedef struct {
+    const char* name;
+    size_t name_len;
+    uint64_t hash;
+    uint32_t name_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+    int duplicate;
+} entry;
+
+static const char* normalize_start(const char* path){
+    while (path[0] == '.' && (path[1] == '/' || path[1] == '\\')) path += 2;
+    return path;
+}
+
+static uint64_t path_hash(const char* path, size_t len){
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++){
+        h ^= (uint8_t)(path[i] == '\\' ? '/' : path[i]);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void put32(uint8_t* p, uint32_t v){
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> 8*i);
+}
+
+static void put64(uint8_t* p, uint64_t v){
+    put32(p, (uint32_t) v);
+    put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t get32(const uint8_t* p){
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static int file_size(const char* path, uint64_t* size){
+    FILE* f = fopen(path, "rb");
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0){
+        if (f != NULL) fclose(f);
+        return -1;
+    }
+    long len = ftell(f);
+    fclose(f);
+    if (len < 0) return -1;
+    *size = (uint64_t) len;
+    return 0;
+}
+
+static int copy_file(FILE* out, const char* path){
+    char buf[1 << 16];
+    size_t n;
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) return -1;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0){
+        if (fwrite(buf, 1, n, out) != n){
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char** argv){
+    if (argc < 3){
+        fprintf(stderr, "usage: %s pack_file asset...\n", argv[0]);
+        return 1;
+    }
+    int count = argc - 2;
+    uint32_t slot_count = 1;
+    while (slot_count < 2u * count) slot_count <<= 1;
+
+    entry* entries = calloc(count, sizeof(entry));
+    uint8_t* slots = calloc(slot_count, PACK_SLOT_SIZE);
+    if (entries == NULL || slots == NULL){
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // names follow the slot table, data follows the names
+    uint64_t offset = PACK_HEADER_SIZE + (uint64_t) slot_count * PACK_SLOT_SIZE;
+    for (int i = 0; i < count; i++){
+        entry* e = &entries[i];
+        e->name = normalize_start(argv[i + 2]);
+        e->name_len = strlen(e->name);
+        e->hash = path_hash(e->name, e->name_len);
+        if (e->name_len == 0 || file_size(argv[i + 2], &e->data_size) != 0){
+            fprintf(stderr, "cannot read %s\n", argv[i + 2]);
+            return 1;
+        }
+        // duplicate paths keep the first occurrence
+        for (int j = 0; j < i; j++) e->duplicate |= entries[j].name_len == e->name_len && memcmp(entries[j].name, e->name, e->name_len) == 0;
+        if (e->duplicate) continue;
+        e->name_offset = (uint32_t) offset;
+        offset += e->name_len;
+    }
+    for (int i = 0; i < count; i++){
+        if (entries[i].duplicate) continue;
+        offset = (offset + DATA_ALIGN - 1) & ~(uint64_t)(DATA_ALIGN - 1);
+        entries[i].data_offset = offset;
+        offset += entries[i].data_size;
+    }
+
+    int unique = 0;
+    for (int i = 0; i < count; i++){
+        entry* e = &entries[i];
+        if (e->duplicate) continue;
+        unique++;
+
+        uint32_t s = (uint32_t) e->hash & (slot_count - 1);
+        while (get32(slots + (size_t) s * PACK_SLOT_SIZE + 12) != 0) s = (s + 1) & (slot_count - 1);
+        uint8_t* slot = slots + (size_t) s * PACK_SLOT_SIZE;
+        put64(slot, e->hash);
+        put32(slot + 8, e->name_offset);
+        put32(slot + 12, (uint32_t) e->name_len);
+        put64(slot + 16, e->data_offset);
+        put64(slot + 24, e->data_size);
+    }
+
+    uint8_t header[PACK_HEADER_SIZE] = "S2DPACK";
+    put32(header + 8, PACK_VERSION);
+    put32(header + 12, slot_count);
+    put32(header + 16, (uint32_t) unique);
+    put32(header + 20, 0);
+    put64(header + 24, offset);
+
+    FILE* out = fopen(argv[1], "wb");
+    if (out == NULL){
+        fprintf(stderr, "cannot create %s\n", argv[1]);
+        return 1;
+    }
+    int ok = fwrite(header, 1, sizeof(header), out) == sizeof(header)
+        && fwrite(slots, PACK_SLOT_SIZE, slot_count, out) == slot_count;
+    for (int i = 0; ok && i < count; i++) ok = entries[i].duplicate || fwrite(entries[i].name, 1, entries[i].name_len, out) == entries[i].name_len;
+    for (int i = 0; ok && i < count; i++){
+        if (entries[i].duplicate) continue;
+        static const uint8_t zeros[DATA_ALIGN];
+        long pad = (long) entries[i].data_offset - ftell(out);
+        ok = pad >= 0 && fwrite(zeros, 1, (size_t) pad, out) == (size_t) pad && copy_file(out, argv[i + 2]) == 0;
+    }
+    if (fclose(out) != 0 || !ok){
+        fprintf(stderr, "failed writing %s\n", argv[1]);
+        return 1;
+    }
+    printf("packed %d assets into %s, %llu bytes\n", unique, argv[1], (unsigned long long) offset);
+    free(entries);
+    free(slots);
+    return 0;
+}